@@ -0,0 +1,294 @@
+/**
+ * @file base_placement.h
+ * @brief 作業姿勢群に対するベース設置位置の探索
+ */
+#pragma once
+#include <robot/reachability.h>
+#include <robot/numerical_ik.h>
+#include <atomic>
+#include <algorithm>
+
+namespace kinematics
+{
+
+/**
+ * @brief ベース設置位置の探索クラス
+ * @details ベース姿勢 posI を位置(x,y,z)と鉛直軸まわりの向きyawの格子で探索し、
+ *          作業姿勢のうち到達できる割合（被覆率）が最大のものを求める。
+ *          - 粗い格子の全候補を到達可能性マップ（ベース座標系で構築したもの）で評価する。
+ *            作業姿勢を候補のベース座標系へ変換してO(1)で引くため、候補毎の評価は
+ *            作業姿勢数回の参照で済み、候補をワーカープールで分担する。
+ *          - 上位keep個の周囲を格子間隔を半分にして評価することをlevels回繰り返す。
+ *          - 最終的な上位verify個を数値逆運動学（角度制約内、複数の初期値）で検証し、
+ *            作業姿勢をワーカープールで分担する。マップは方向区分の粗い近似のため、
+ *            検証した被覆率で最良を選ぶ。
+ *          マップを与えない場合は全ての評価を逆運動学で行う（低速）。
+ * @tparam N 軸数（回転関節のみ）
+ */
+template <typename T, int N=Naxis>
+class base_placement
+{
+    public:
+        /**
+         * @brief 探索結果
+         */
+        struct result
+        {
+            pose<T> base;                   ///< ベース姿勢
+            T coverage = 0;                 ///< 逆運動学で検証した被覆率
+            T estimate = 0;                 ///< マップによる被覆率（マップなしでは検証値）
+            std::vector<char> reached;      ///< 作業姿勢毎の到達
+            std::vector<joint<T,N>> q;      ///< 作業姿勢毎の関節解（到達したもの）
+        };
+
+        robot_model<T,N> rm;        ///< ロボットモデル
+        joint_limit<T,N> lim;       ///< 角度制約（逆運動学の初期値の範囲、有限値）
+        const reach_map<T> *map;    ///< 到達可能性マップ（ベース座標系、nullptrで逆運動学のみ）
+        thread_pool *pool;          ///< ワーカープール（nullptrで呼び出しスレッドのみ）
+        aabb<T> region;             ///< ベース位置の探索範囲
+        T yaw_min = -M_PI;          ///< 向きの探索範囲[rad]
+        T yaw_max = M_PI;           ///< 向きの探索範囲[rad]（全周では端点を重複させない）
+        std::array<int, 4> grid = {{9, 9, 1, 8}};  ///< 粗い格子の点数（x, y, z, yaw）
+        int levels = 3;             ///< 細分化の回数
+        int keep = 4;               ///< 細分化する上位候補数
+        int verify = 3;             ///< 逆運動学で検証する上位候補数
+        int restarts = 8;           ///< 作業姿勢毎の逆運動学の初期値の数
+        pose<T> tool;               ///< ツール座標系（マップもこのツールで構築すること）
+
+        long evaluated = 0;         ///< 直前の探索で評価した候補数
+        long ik_calls = 0;          ///< 直前の探索の逆運動学の回数
+
+        /**
+         * @brief 生成
+         * @param [in] rm_ ロボットモデル
+         * @param [in] lim_ 角度制約（有限値）
+         * @param [in] map_ 到達可能性マップ
+         * @param [in] pool_ ワーカープール
+         */
+        base_placement(const robot_model<T,N>& rm_, const joint_limit<T,N>& lim_, const reach_map<T> *map_=nullptr, thread_pool *pool_=nullptr)
+         : rm(rm_), lim(lim_), map(map_), pool(pool_)
+        {
+            for(int i=0; i<N; i++)
+            {
+                assert(rm_.type[i]==REVOLUTE);
+                assert(std::isfinite(lim_.qmin.val[i]) && std::isfinite(lim_.qmax.val[i]));
+            }
+        }
+
+        /**
+         * @brief 探索
+         * @param [in] tasks 作業姿勢（基準座標系のツール姿勢）
+         * @return 最良のベース姿勢
+         */
+        result operator()(const std::vector<pose<T>>& tasks)
+        {
+            this->evaluated = 0;
+            this->ik_calls = 0;
+            this->make_solvers();
+
+            // 粗い格子
+            const T lo[4] = {this->region.lo.x, this->region.lo.y, this->region.lo.z, this->yaw_min};
+            const T hi[4] = {this->region.hi.x, this->region.hi.y, this->region.hi.z, this->yaw_max};
+            const bool full = (this->yaw_max - this->yaw_min >= 2*M_PI - 1e-9);
+            std::array<T, 4> step;
+            std::vector<cand> cs;
+            for(int d=0; d<4; d++)
+            {
+                int n = std::max(this->grid[d], 1);
+                int div = (d==3 && full) ? n : n-1;
+                step[d] = (div>0) ? (hi[d] - lo[d])/div : 0;
+            }
+            for(int a=0; a<std::max(this->grid[0], 1); a++)
+                for(int b=0; b<std::max(this->grid[1], 1); b++)
+                    for(int c=0; c<std::max(this->grid[2], 1); c++)
+                        for(int e=0; e<std::max(this->grid[3], 1); e++)
+                        {
+                            cand x;
+                            x.v = {{lo[0] + step[0]*a, lo[1] + step[1]*b, lo[2] + step[2]*c, lo[3] + step[3]*e}};
+                            cs.push_back(x);
+                        }
+            this->score(cs, tasks);
+
+            // 上位の周囲を細分化
+            for(int l=0; l<this->levels; l++)
+            {
+                this->top(cs, this->keep);
+                for(int d=0; d<4; d++) step[d] *= 0.5;
+                std::vector<cand> next;
+                for(const cand& c : cs)
+                {
+                    for(int k=0; k<81; k++)
+                    {
+                        cand x = c;
+                        bool moved = false;
+                        for(int d=0, r=k; d<4; d++, r/=3)
+                        {
+                            int o = r%3 - 1;
+                            if(o==0 || step[d]==0) continue;
+                            x.v[d] = c.v[d] + o*step[d];
+                            moved = true;
+                            if(d<3) x.v[d] = std::min(std::max(x.v[d], lo[d]), hi[d]);
+                            else if(!full) x.v[d] = std::min(std::max(x.v[d], lo[d]), hi[d]);
+                        }
+                        if(moved) next.push_back(x);
+                    }
+                }
+                this->score(next, tasks);
+                cs.insert(cs.end(), next.begin(), next.end());
+            }
+
+            // 上位を逆運動学で検証
+            this->top(cs, this->map ? this->verify : 1);
+            result best;
+            best.coverage = -1;
+            for(const cand& c : cs)
+            {
+                result r;
+                r.base = this->base(c);
+                r.estimate = c.score;
+                r.coverage = this->check(r.base, tasks, &r.reached, &r.q);
+                if(r.coverage > best.coverage) best = r;
+            }
+            return best;
+        }
+
+        /**
+         * @brief 候補のベース姿勢の被覆率（逆運動学、作業姿勢をワーカープールで分担）
+         * @param [out] reached 作業姿勢毎の到達（nullptrで省略）
+         * @param [out] q 作業姿勢毎の関節解（nullptrで省略）
+         */
+        T check(const pose<T>& base, const std::vector<pose<T>>& tasks, std::vector<char> *reached=nullptr, std::vector<joint<T,N>> *q=nullptr)
+        {
+            this->make_solvers();
+            int n = tasks.size();
+            if(reached) reached->assign(n, 0);
+            if(q) q->assign(n, joint<T,N>());
+            std::atomic<int> hit(0);
+            std::atomic<long> calls(0);
+            auto job = [&](int b, int e, int worker)
+            {
+                numerical_ik<T>& ik = this->solver[worker];
+                ik.posI = base;
+                T th[N];
+                int h = 0;
+                long c = 0;
+                for(int k=b; k<e; k++)
+                {
+                    for(int s=0; s<this->restarts; s++)
+                    {
+                        for(int i=0; i<N; i++)
+                        {
+                            T u = (s==0) ? (T)0.5 : (T)counter_uniform(s, k, i);
+                            th[i] = this->lim.qmin.val[i] + (this->lim.qmax.val[i] - this->lim.qmin.val[i])*u;
+                        }
+                        c++;
+                        if(ik(tasks[k], th, 1.0)==IK_SUCCESS)
+                        {
+                            h++;
+                            if(reached) (*reached)[k] = 1;
+                            if(q) for(int i=0; i<N; i++) (*q)[k].val[i] = th[i];
+                            break;
+                        }
+                    }
+                }
+                hit += h;
+                calls += c;
+            };
+            if(this->pool) this->pool->parallel_for(n, job);
+            else           job(0, n, 0);
+            this->ik_calls += calls;
+            return n ? (T)hit/n : 0;
+        }
+
+        /**
+         * @brief 候補のベース姿勢の被覆率（到達可能性マップ）
+         */
+        T estimate(const pose<T>& base, const std::vector<pose<T>>& tasks) const
+        {
+            assert(this->map);
+            vec4<T> ic = base.q.conj();
+            int hit = 0;
+            for(const auto& t : tasks)
+            {
+                pose<T> rel(rotate(ic, t.p - base.p), ic*t.q);
+                hit += this->map->reachable(rel);
+            }
+            return tasks.empty() ? 0 : (T)hit/tasks.size();
+        }
+
+    private:
+        /**
+         * @brief 候補（x, y, z, yaw）と評価値
+         */
+        struct cand
+        {
+            std::array<T, 4> v;
+            T score = 0;
+        };
+
+        std::vector<numerical_ik<T>> solver;    ///< ワーカー毎の逆運動学
+        uint64_t solver_key = 0;                ///< 逆運動学を生成したモデル・制約・ツールの指紋
+
+        pose<T> base(const cand& c) const
+        {
+            return pose<T>(vec3<T>(c.v[0], c.v[1], c.v[2]), vec4<T>(vec3<T>(0, 0, 1), c.v[3]));
+        }
+
+        /**
+         * @brief ワーカー毎の逆運動学の生成（モデル・制約・ツール・ワーカー数が変わった場合のみ）
+         */
+        void make_solvers()
+        {
+            int nw = this->pool ? this->pool->size() : 1;
+            uint64_t key = reach_fingerprint(this->rm, this->lim, this->tool, 0);
+            if((int)this->solver.size()==nw && key==this->solver_key) return;
+            std::vector<vec3<T>> pos(this->rm.pos.begin(), this->rm.pos.end());
+            std::vector<vec3<T>> alfa(this->rm.alfa.begin(), this->rm.alfa.end());
+            numerical_ik<T> proto(pos, alfa, pose<T>(), this->tool);
+            proto.set_limit(std::vector<T>(this->lim.qmin.val.begin(), this->lim.qmin.val.end()),
+                            std::vector<T>(this->lim.qmax.val.begin(), this->lim.qmax.val.end()));
+            proto.tol_p = 1e-4;
+            proto.tol_r = 1e-3;
+            proto.max_iter = 50;
+            this->solver.assign(nw, proto);
+            this->solver_key = key;
+        }
+
+        /**
+         * @brief 候補の評価（マップは候補を、逆運動学は作業姿勢を分担）
+         */
+        void score(std::vector<cand>& cs, const std::vector<pose<T>>& tasks)
+        {
+            this->evaluated += cs.size();
+            if(!this->map)
+            {
+                for(auto& c : cs) c.score = this->check(this->base(c), tasks);
+                return;
+            }
+            auto job = [&](int b, int e, int)
+            {
+                for(int k=b; k<e; k++) cs[k].score = this->estimate(this->base(cs[k]), tasks);
+            };
+            if(this->pool) this->pool->parallel_for(cs.size(), job, 1);
+            else           job(0, cs.size(), 0);
+        }
+
+        /**
+         * @brief 評価値の上位n個（重複を除く）
+         */
+        static void top(std::vector<cand>& cs, int n)
+        {
+            std::stable_sort(cs.begin(), cs.end(), [](const cand& a, const cand& b){ return a.score > b.score; });
+            std::vector<cand> ret;
+            for(const cand& c : cs)
+            {
+                if((int)ret.size()>=n) break;
+                bool dup = false;
+                for(const cand& r : ret) if(r.v==c.v) dup = true;
+                if(!dup) ret.push_back(c);
+            }
+            cs.swap(ret);
+        }
+};
+
+}
@@ -0,0 +1,175 @@
+/**
+ * @file batch_ik.h
+ * @brief 多数の目標姿勢に対する並列逆運動学
+ */
+#pragma once
+#include <robot/numerical_ik.h>
+#include <robot/thread_pool.h>
+
+namespace kinematics
+{
+
+/**
+ * @brief 一括逆運動学の結果（SoA配置）
+ * @details q[i][k]は目標kに対する関節iの解
+ */
+template <typename T>
+class ik_buffer
+{
+    public:
+        std::vector<std::vector<T>> q;  ///< 関節解 [軸][目標]
+        std::vector<unsigned int> flg1; ///< SFLG1::val
+        std::vector<unsigned int> flg2; ///< SFLG2::val
+        std::vector<unsigned char> status; ///< IK_STATUS
+        std::vector<T> err;             ///< 最良偏差ノルム
+
+        ik_buffer(){}
+
+        ik_buffer(int naxis, int n)
+        {
+            this->resize(naxis, n);
+        }
+
+        /**
+         * @brief 要素数変更（縮小時は再確保しない）
+         */
+        void resize(int naxis, int n)
+        {
+            this->q.resize(naxis);
+            for(auto &x : this->q) x.resize(n);
+            this->flg1.resize(n);
+            this->flg2.resize(n);
+            this->status.resize(n);
+            this->err.resize(n);
+        }
+
+        /**
+         * @brief 目標数
+         */
+        int size() const
+        {
+            return this->status.size();
+        }
+
+        /**
+         * @brief 目標kの関節解を取得
+         */
+        joint<T> get(int k) const
+        {
+            joint<T> ret;
+            for(int i=0; i<std::min((int)this->q.size(), (int)ret.val.size()); i++)
+                ret[i] = this->q[i][k];
+            return ret;
+        }
+};
+
+/**
+ * @brief 並列一括逆運動学クラス
+ * @details ワーカー毎にnumerical_ikを持ち、目標配列をチャンク単位で分配する。
+ *          各目標は共通の初期値seedから解き、結果はik_bufferにSoAで格納する。
+ *          6軸ではFlgChkによる回転フラグ、標準アーム(posB/alfaB)では形態フラグも格納する。
+ */
+template <typename T>
+class batch_ik
+{
+    public:
+        std::vector<T> seed;    ///< 初期値
+        double budget = 1e-3;   ///< 目標あたりの時間予算[s]
+
+        /**
+         * @brief 生成
+         * @param [in] proto 設定済みソルバ（ワーカー数だけ複製）
+         * @param [in] nthread ワーカー数 0でハードウェアスレッド数
+         */
+        batch_ik(const numerical_ik<T>& proto, int nthread=0)
+         : pool(nthread)
+        {
+            this->solver.assign(this->pool.size(), proto);
+            this->work.assign(this->pool.size(), std::vector<T>(proto.size()));
+            this->seed.assign(proto.size(), 0);
+        }
+
+        /**
+         * @brief 6軸アーム用に生成
+         */
+        batch_ik(int nthread=0)
+         : batch_ik(numerical_ik<T>(posB(), alfaB()), nthread)
+        {}
+
+        /**
+         * @brief 軸数
+         */
+        int size() const
+        {
+            return this->seed.size();
+        }
+
+        /**
+         * @brief ワーカー毎のソルバ（設定変更用）
+         */
+        numerical_ik<T>& operator[](int n)
+        {
+            return this->solver[n];
+        }
+
+        /**
+         * @brief 一括求解
+         * @param [in] target 目標姿勢配列
+         * @param [in] n 目標数
+         * @param [out] out 結果（要素数n以上に確保済みであること）
+         * @return 収束した目標数
+         */
+        int operator()(const pose<T> target[], int n, ik_buffer<T>& out)
+        {
+            assert(out.size()>=n && out.q.size()==size());
+            std::atomic<int> nsuccess(0);
+            this->pool.parallel_for(n, [&](int b, int e, int id)
+            {
+                numerical_ik<T>& ik = this->solver[id];
+                robot_model<T> rm;
+                if(size()==Naxis) rm.set(ik.pos, ik.alfa);
+                T *q = &this->work[id][0];
+                int ok = 0;
+                for(int k=b; k<e; k++)
+                {
+                    std::copy(this->seed.begin(), this->seed.end(), q);
+                    IK_STATUS st = ik(target[k], q, this->budget);
+                    for(int i=0; i<size(); i++) out.q[i][k] = q[i];
+                    out.status[k] = st;
+                    out.err[k] = ik.err;
+                    if(st==IK_SUCCESS) ok++;
+
+                    if(size()==Naxis)
+                    {
+                        joint<T> jnt;
+                        std::copy(q, q+Naxis, jnt.val.begin());
+                        SFLG flg = FlgChk(rm, jnt);
+                        out.flg1[k] = flg.flg1.val;
+                        out.flg2[k] = flg.flg2.val;
+                    }
+                    else
+                    {
+                        out.flg1[k] = out.flg2[k] = 0;
+                    }
+                }
+                nsuccess += ok;
+            });
+            return nsuccess;
+        }
+
+        /**
+         * @brief 一括求解（std::vector版）
+         */
+        int operator()(const std::vector<pose<T>>& target, ik_buffer<T>& out)
+        {
+            if(out.size()<target.size()) out.resize(size(), target.size());
+            return (*this)(target.data(), target.size(), out);
+        }
+
+    private:
+        thread_pool pool;                       ///< ワーカープール
+        std::vector<numerical_ik<T>> solver;    ///< ワーカー毎のソルバ
+        std::vector<std::vector<T>> work;       ///< ワーカー毎の関節作業領域
+};
+
+}
@@ -0,0 +1,499 @@
+/**
+ * @file bvh.h
+ * @brief 環境障害物（直方体・三角形メッシュ）の境界ボリューム階層
+ */
+#pragma once
+#include <robot/self_collision.h>
+
+namespace kinematics
+{
+
+/**
+ * @brief 障害物の種別
+ */
+enum PRIM_TYPE
+{
+    PRIM_BOX = 0,   ///< 直方体（OBB）
+    PRIM_TRIANGLE,  ///< 三角形
+};
+
+/**
+ * @brief 環境障害物の静的BVHクラス
+ * @details 直方体（CubeMarkerと同じ中心姿勢と辺長）と三角形を登録し、
+ *          build()で包含箱の2分木を構築する。節点は深さ優先順の連続配列で、
+ *          左の子は直後の節点、右の子はnextで参照する（葉はnextが先頭要素、countが要素数）。
+ *          要素も葉の順に並べ替えて連続に保持する。
+ *          構築は要素の包含箱計算と上位分割後の部分木をワーカープールで並列に行う。
+ *          カプセルとの干渉判定（最初の干渉で打ち切り）と最短距離（下界による枝刈り）を持つ。
+ */
+template <typename T>
+class bvh
+{
+    public:
+        /**
+         * @brief 障害物要素
+         */
+        struct primitive
+        {
+            PRIM_TYPE type;     ///< 種別
+            int id;             ///< 登録番号
+            vec3<T> v[3];       ///< 直方体：中心・半辺長 三角形：頂点
+            vec4<T> q;          ///< 直方体の姿勢
+        };
+
+        /**
+         * @brief 節点
+         */
+        struct node
+        {
+            aabb<T> box;    ///< 包含箱
+            int next;       ///< 内部：右の子 葉：先頭要素
+            int count;      ///< 内部：0 葉：要素数
+        };
+
+        std::vector<node> nodes;        ///< 節点（深さ優先順）
+        std::vector<primitive> prim;    ///< 要素（葉の順）
+        int leaf_size = 4;              ///< 葉の要素数上限
+
+        /**
+         * @brief 直方体の登録（build()が必要）
+         * @param [in] p0 中心の位置・姿勢
+         * @param [in] size 辺長
+         * @return 登録番号
+         */
+        int add(const pose<T>& p0, const vec3<T>& size)
+        {
+            primitive p;
+            p.type = PRIM_BOX;
+            p.id = this->src.size();
+            p.v[0] = p0.p;
+            p.v[1] = size*0.5;
+            p.q = p0.q;
+            this->src.push_back(p);
+            return p.id;
+        }
+
+        /**
+         * @brief 三角形の登録（build()が必要）
+         * @return 登録番号
+         */
+        int add(const vec3<T>& a, const vec3<T>& b, const vec3<T>& c)
+        {
+            primitive p;
+            p.type = PRIM_TRIANGLE;
+            p.id = this->src.size();
+            p.v[0] = a;
+            p.v[1] = b;
+            p.v[2] = c;
+            this->src.push_back(p);
+            return p.id;
+        }
+
+        /**
+         * @brief 三角形メッシュの登録（build()が必要）
+         * @param [in] vtx 頂点（メッシュ座標系）
+         * @param [in] tri 三角形の頂点番号（3個ずつ）
+         * @param [in] P メッシュ座標系の位置・姿勢
+         * @return 先頭の登録番号
+         */
+        int add(const std::vector<vec3<T>>& vtx, const std::vector<int>& tri, const pose<T>& P=pose<T>())
+        {
+            assert(tri.size()%3==0);
+            int ret = this->src.size();
+            for(int i=0; i+2<tri.size(); i+=3)
+                this->add(transform(P, vtx[tri[i]]), transform(P, vtx[tri[i+1]]), transform(P, vtx[tri[i+2]]));
+            return ret;
+        }
+
+        /**
+         * @brief 登録数
+         */
+        int size() const
+        {
+            return this->src.size();
+        }
+
+        /**
+         * @brief 構築
+         * @param [in] pool ワーカープール（nullptrで呼び出しスレッドのみ）
+         */
+        void build(thread_pool *pool=nullptr)
+        {
+            int n = this->src.size();
+            this->nodes.clear();
+            this->prim.clear();
+            if(n==0) return;
+
+            this->bnd.resize(n);
+            this->cen.resize(n);
+            this->idx.resize(n);
+            auto job = [&](int b, int e, int)
+            {
+                for(int i=b; i<e; i++)
+                {
+                    this->bnd[i] = this->bounds(this->src[i]);
+                    this->cen[i] = this->bnd[i].center();
+                    this->idx[i] = i;
+                }
+            };
+            if(pool) pool->parallel_for(n, job);
+            else     job(0, n, 0);
+
+            // 上位の分割（部分木数がワーカー数の4倍程度になるまで）
+            int nsub = pool ? 4*pool->size() : 1;
+            this->top.clear();
+            this->task.clear();
+            this->split_top(0, n, 1, nsub);
+
+            // 部分木を並列に構築
+            std::vector<std::vector<node>> sub(this->task.size());
+            auto job2 = [&](int b, int e, int)
+            {
+                for(int k=b; k<e; k++)
+                    this->build_sub(this->task[k].first, this->task[k].second, sub[k]);
+            };
+            if(pool) pool->parallel_for(this->task.size(), job2, 1);
+            else     job2(0, this->task.size(), 0);
+
+            // 深さ優先順に連結
+            this->assemble(0, sub);
+            this->prim.resize(n);
+            for(int i=0; i<n; i++) this->prim[i] = this->src[this->idx[i]];
+        }
+
+        /**
+         * @brief 要素の包含箱
+         */
+        static aabb<T> bounds(const primitive& p)
+        {
+            aabb<T> ret;
+            if(p.type==PRIM_TRIANGLE)
+            {
+                for(int k=0; k<3; k++) ret.grow(p.v[k]);
+                return ret;
+            }
+            const vec3<T>& h = p.v[1];
+            vec3<T> ex = rotate(p.q, vec3<T>(h.x, 0, 0));
+            vec3<T> ey = rotate(p.q, vec3<T>(0, h.y, 0));
+            vec3<T> ez = rotate(p.q, vec3<T>(0, 0, h.z));
+            vec3<T> r(std::abs(ex.x)+std::abs(ey.x)+std::abs(ez.x),
+                      std::abs(ex.y)+std::abs(ey.y)+std::abs(ez.y),
+                      std::abs(ex.z)+std::abs(ey.z)+std::abs(ez.z));
+            ret.grow(p.v[0] - r);
+            ret.grow(p.v[0] + r);
+            return ret;
+        }
+
+        /**
+         * @brief 要素とカプセル軸（線分）の最短距離の2乗
+         */
+        static T distance2(const primitive& p, const capsule<T>& c)
+        {
+            if(p.type==PRIM_TRIANGLE)
+                return segment_triangle_distance2(c.a, c.b, p.v[0], p.v[1], p.v[2]);
+            vec4<T> qi = p.q.conj();
+            return segment_box_distance2(rotate(qi, c.a - p.v[0]), rotate(qi, c.b - c.a), p.v[1]);
+        }
+
+        /**
+         * @brief カプセルとの干渉判定
+         * @param [in] c カプセル（基準座標系）
+         * @param [in] margin 干渉とみなす距離
+         * @param [out] id 干渉した要素の登録番号（nullptrで省略）
+         * @retval true 干渉あり
+         */
+        bool collide(const capsule<T>& c, T margin=0, int *id=nullptr) const
+        {
+            if(this->nodes.empty()) return false;
+            aabb<T> cb = kinematics::bounds(c);
+            cb.lo = cb.lo - margin;
+            cb.hi = cb.hi + margin;
+            T lim = std::max(c.r + margin, (T)0);
+            T lim2 = lim*lim;
+            vec3<T> d = c.b - c.a;
+
+            int st[64];
+            int sp = 0;
+            st[sp++] = 0;
+            while(sp>0)
+            {
+                int i = st[--sp];
+                const node& nd = this->nodes[i];
+                if(!nd.box.overlap(cb)) continue;
+                if(segment_box_distance2(c.a - nd.box.center(), d, nd.box.half()) > lim2) continue;
+                if(nd.count>0)
+                {
+                    for(int k=nd.next; k<nd.next+nd.count; k++)
+                    {
+                        if(distance2(this->prim[k], c) <= lim2)
+                        {
+                            if(id) *id = this->prim[k].id;
+                            return true;
+                        }
+                    }
+                }
+                else
+                {
+                    assert(sp+2 <= 64);
+                    st[sp++] = nd.next;
+                    st[sp++] = i+1;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * @brief 包含箱との重なり判定（要素の包含箱で判定するため保守的）
+         * @param [in] b 軸平行包含箱（基準座標系）
+         * @param [out] id 重なった要素の登録番号（nullptrで省略）
+         * @retval false 箱内に障害物なし
+         */
+        bool overlap(const aabb<T>& b, int *id=nullptr) const
+        {
+            if(this->nodes.empty() || b.lo.x > b.hi.x) return false;
+            int st[64];
+            int sp = 0;
+            st[sp++] = 0;
+            while(sp>0)
+            {
+                int i = st[--sp];
+                const node& nd = this->nodes[i];
+                if(!nd.box.overlap(b)) continue;
+                if(nd.count>0)
+                {
+                    for(int k=nd.next; k<nd.next+nd.count; k++)
+                    {
+                        if(bounds(this->prim[k]).overlap(b))
+                        {
+                            if(id) *id = this->prim[k].id;
+                            return true;
+                        }
+                    }
+                }
+                else
+                {
+                    assert(sp+2 <= 64);
+                    st[sp++] = nd.next;
+                    st[sp++] = i+1;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * @brief カプセルとの最短距離（貫通時は-半径が下限）
+         * @param [in] c カプセル（基準座標系）
+         * @param [out] id 最近要素の登録番号（nullptrで省略）
+         * @return 最短距離 障害物なしでINFINITY
+         */
+        T distance(const capsule<T>& c, int *id=nullptr) const
+        {
+            if(this->nodes.empty()) return INFINITY;
+            vec3<T> d = c.b - c.a;
+            T best = INFINITY;
+
+            int st[64];
+            T lb[64];
+            int sp = 0;
+            st[sp] = 0;
+            lb[sp++] = 0;
+            while(sp>0)
+            {
+                sp--;
+                if(lb[sp] >= best) continue;
+                const node& nd = this->nodes[st[sp]];
+                int i = st[sp];
+                if(nd.count>0)
+                {
+                    for(int k=nd.next; k<nd.next+nd.count; k++)
+                    {
+                        T d2 = distance2(this->prim[k], c);
+                        if(d2 < best)
+                        {
+                            best = d2;
+                            if(id) *id = this->prim[k].id;
+                        }
+                    }
+                }
+                else
+                {
+                    // 近い子を後に積んで先に調べる
+                    int ch[2] = {i+1, nd.next};
+                    T l[2];
+                    for(int k=0; k<2; k++)
+                    {
+                        const aabb<T>& b = this->nodes[ch[k]].box;
+                        l[k] = segment_box_distance2(c.a - b.center(), d, b.half());
+                    }
+                    int f = (l[0] < l[1]) ? 1 : 0;
+                    assert(sp+2 <= 64);
+                    st[sp] = ch[f];   lb[sp++] = l[f];
+                    st[sp] = ch[1-f]; lb[sp++] = l[1-f];
+                }
+            }
+            return sqrt(best) - c.r;
+        }
+
+        /**
+         * @brief ロボットのリンク形状との干渉判定
+         * @param [in] robot リンク形状
+         * @param [in] pa リンク座標系（to_pose_arrayの出力）
+         * @param [in] margin 干渉とみなす距離
+         * @param [out] link 干渉したリンク番号（nullptrで省略）
+         * @param [out] id 干渉した要素の登録番号（nullptrで省略）
+         */
+        template <int N, typename C>
+        bool collide(const self_collision<T,N>& robot, const C& pa, T margin=0, int *link=nullptr, int *id=nullptr) const
+        {
+            for(int k=0; k<=N; k++)
+            {
+                for(const auto& c : robot.shapes(k))
+                {
+                    capsule<T> w{transform<T>(pa[k], c.a), transform<T>(pa[k], c.b), c.r};
+                    if(this->collide(w, margin, id))
+                    {
+                        if(link) *link = k;
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        /**
+         * @brief ロボットのリンク形状との最短距離
+         * @param [out] link 最近リンク番号（nullptrで省略）
+         * @param [out] id 最近要素の登録番号（nullptrで省略）
+         */
+        template <int N, typename C>
+        T distance(const self_collision<T,N>& robot, const C& pa, int *link=nullptr, int *id=nullptr) const
+        {
+            T ret = INFINITY;
+            for(int k=0; k<=N; k++)
+            {
+                for(const auto& c : robot.shapes(k))
+                {
+                    capsule<T> w{transform<T>(pa[k], c.a), transform<T>(pa[k], c.b), c.r};
+                    int i;
+                    T d = this->distance(w, &i);
+                    if(d < ret)
+                    {
+                        ret = d;
+                        if(link) *link = k;
+                        if(id) *id = i;
+                    }
+                }
+            }
+            return ret;
+        }
+
+    private:
+        std::vector<primitive> src;                 ///< 登録順の要素
+        std::vector<aabb<T>> bnd;                   ///< 要素の包含箱（登録順）
+        std::vector<vec3<T>> cen;                   ///< 要素の包含箱中心（登録順）
+        std::vector<int> idx;                       ///< 葉の順の登録番号
+
+        /**
+         * @brief 上位の分割
+         */
+        struct top_node
+        {
+            int left, right;    ///< 子（部分木では-1）
+            int task;           ///< 部分木番号（内部では-1）
+        };
+        std::vector<top_node> top;
+        std::vector<std::pair<int,int>> task;      ///< 部分木の要素範囲
+
+        /**
+         * @brief 範囲[b,e)を中心の最長軸の中央値で分割
+         * @return 分割位置
+         */
+        int split(int b, int e)
+        {
+            aabb<T> cb;
+            for(int i=b; i<e; i++) cb.grow(this->cen[this->idx[i]]);
+            vec3<T> ext = cb.hi - cb.lo;
+            int axis = (ext.x>=ext.y && ext.x>=ext.z) ? 0 : (ext.y>=ext.z) ? 1 : 2;
+            int m = (b+e)/2;
+            const std::vector<vec3<T>>& c = this->cen;
+            std::nth_element(this->idx.begin()+b, this->idx.begin()+m, this->idx.begin()+e,
+                [&](int i, int j){ return (axis==0) ? c[i].x<c[j].x : (axis==1) ? c[i].y<c[j].y : c[i].z<c[j].z; });
+            return m;
+        }
+
+        int split_top(int b, int e, int width, int nsub)
+        {
+            int id = this->top.size();
+            this->top.push_back(top_node{-1, -1, -1});
+            if(e-b <= this->leaf_size || width >= nsub)
+            {
+                this->top[id].task = this->task.size();
+                this->task.push_back(std::make_pair(b, e));
+                return id;
+            }
+            int m = this->split(b, e);
+            int l = this->split_top(b, m, 2*width, nsub);
+            int r = this->split_top(m, e, 2*width, nsub);
+            this->top[id].left = l;
+            this->top[id].right = r;
+            return id;
+        }
+
+        /**
+         * @brief 部分木の構築（節点番号はoutの先頭基準）
+         */
+        int build_sub(int b, int e, std::vector<node>& out)
+        {
+            int id = out.size();
+            out.push_back(node());
+            node nd;
+            if(e-b <= this->leaf_size)
+            {
+                for(int i=b; i<e; i++) nd.box.grow(this->bnd[this->idx[i]]);
+                nd.next = b;
+                nd.count = e-b;
+                out[id] = nd;
+                return id;
+            }
+            int m = this->split(b, e);
+            int l = this->build_sub(b, m, out);
+            int r = this->build_sub(m, e, out);
+            nd.box = out[l].box;
+            nd.box.grow(out[r].box);
+            nd.next = r;
+            nd.count = 0;
+            out[id] = nd;
+            return id;
+        }
+
+        /**
+         * @brief 上位分割と部分木の連結
+         */
+        void assemble(int t, const std::vector<std::vector<node>>& sub)
+        {
+            const top_node& tn = this->top[t];
+            if(tn.task>=0)
+            {
+                int off = this->nodes.size();
+                for(node nd : sub[tn.task])
+                {
+                    if(nd.count==0) nd.next += off;
+                    this->nodes.push_back(nd);
+                }
+                return;
+            }
+            int id = this->nodes.size();
+            this->nodes.push_back(node());
+            this->assemble(tn.left, sub);
+            int r = this->nodes.size();
+            this->assemble(tn.right, sub);
+            node nd;
+            nd.box = this->nodes[id+1].box;
+            nd.box.grow(this->nodes[r].box);
+            nd.next = r;
+            nd.count = 0;
+            this->nodes[id] = nd;
+        }
+};
+
+}
@@ -0,0 +1,348 @@
+/**
+ * @file cartesian_path.h
+ * @brief 直交空間の直線補間と逆運動学の逐次生成
+ */
+#pragma once
+#include <robot/numerical_ik.h>
+#include <robot/trajectory.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace kinematics
+{
+
+/**
+ * @brief 直交空間の直線補間経路
+ * @details 経由姿勢間を位置は線形、姿勢は球面線形に補間する。
+ *          区間毎の係数（変位・回転角・1/sin）は生成時に求め、
+ *          経路パラメータは巡航時間（位置・姿勢のうち遅い方）で正規化して
+ *          台形速度で時間配分する。
+ */
+template <typename T>
+class cartesian_path
+{
+    public:
+        /**
+         * @brief 補間区間
+         */
+        struct segment
+        {
+            vec3<T> p0;     ///< 始点位置
+            vec3<T> dp;     ///< 位置変位
+            vec4<T> q0;     ///< 始点姿勢
+            vec4<T> q1;     ///< 終点姿勢（近回り側の符号）
+            T theta;        ///< クォータニオン間の角度（回転角の1/2）
+            T isin;         ///< 1/sin(theta)（回転なしで0）
+            T u0;           ///< 区間開始の経路パラメータ
+            T len;          ///< 区間の経路パラメータ長（巡航時間）
+        };
+
+        std::vector<segment> seg;   ///< 補間区間
+        profile1d<T> law;           ///< 経路パラメータの時間則
+
+        /**
+         * @brief 経路計画
+         * @param [in] wp 経由姿勢（2個以上）
+         * @param [in] vlin 並進速度上限[m/s]
+         * @param [in] vrot 回転速度上限[rad/s]
+         * @param [in] tacc 加減速時間[s]
+         * @return 所要時間[s]
+         */
+        T operator()(const std::vector<pose<T>>& wp, T vlin, T vrot, T tacc)
+        {
+            assert(wp.size()>=2 && vlin>0 && vrot>0 && tacc>0);
+            this->seg.resize(wp.size()-1);
+            T u = 0;
+            for(int i=0; i+1<wp.size(); i++)
+            {
+                segment& s = this->seg[i];
+                s.p0 = wp[i].p;
+                s.dp = wp[i+1].p - wp[i].p;
+                s.q0 = wp[i].q;
+                s.q1 = wp[i+1].q;
+                T dot = s.q0.x*s.q1.x + s.q0.y*s.q1.y + s.q0.z*s.q1.z + s.q0.w*s.q1.w;
+                if(dot<0) { s.q1 = -s.q1; dot = -dot; }
+                s.theta = acos(std::min(dot, (T)1));
+                s.isin = (s.theta>1e-9) ? 1/sin(s.theta) : 0;
+                s.u0 = u;
+                s.len = std::max(s.dp.nrm()/vlin, 2*s.theta/vrot);
+                u += s.len;
+            }
+            this->hint = 0;
+            return this->law.plan(0, u, 0, 0, 1, 1/tacc);
+        }
+
+        /**
+         * @brief 所要時間[s]
+         */
+        T duration() const
+        {
+            return this->law.time();
+        }
+
+        /**
+         * @brief 時刻tの姿勢
+         */
+        pose<T> operator()(T t)
+        {
+            T u, du, ddu;
+            this->law.eval(t, u, du, ddu, this->lhint);
+
+            // 時刻は単調増加が主なので前回区間から探索
+            int i = this->hint;
+            int n = this->seg.size();
+            while(i>0 && u<this->seg[i].u0) i--;
+            while(i<n-1 && u>=this->seg[i+1].u0) i++;
+            this->hint = i;
+
+            const segment& s = this->seg[i];
+            T r = (s.len>0) ? std::min(std::max((u-s.u0)/s.len, (T)0), (T)1) : 1;
+            pose<T> ret;
+            ret.p = s.p0 + s.dp*r;
+            if(s.isin==0)
+            {
+                ret.q = s.q1;
+            }
+            else
+            {
+                T a = sin((1-r)*s.theta)*s.isin;
+                T b = sin(r*s.theta)*s.isin;
+                ret.q = vec4<T>(a*s.q0.x + b*s.q1.x, a*s.q0.y + b*s.q1.y, a*s.q0.z + b*s.q1.z, a*s.q0.w + b*s.q1.w);
+            }
+            return ret;
+        }
+
+    private:
+        int hint = 0;   ///< 区間探索の開始番号
+        int lhint = 0;  ///< 時間則の区間探索の開始番号
+};
+
+/**
+ * @brief 逐次生成の状態
+ */
+enum STREAM_STATUS
+{
+    STREAM_OK = 0,      ///< 正常
+    STREAM_END,         ///< 経路終了
+    STREAM_UNDERRUN,    ///< 先行計算が間に合っていない
+    STREAM_IK_FAILED,   ///< 逆運動学の失敗
+    STREAM_LIMIT,       ///< 角度制約外
+    STREAM_OVERSPEED,   ///< 関節速度超過（特異点近傍など）
+};
+
+/**
+ * @brief 直線補間の逐次逆運動学クラス
+ * @details 制御周期毎の目標姿勢に対し、前周期の解からウォームスタートした
+ *          数値逆運動学を先行スレッドで計算し、リングバッファ経由で出力する。
+ *          先行量（lookahead周期）だけ前に失敗（逆運動学・角度制約・関節速度）を検出でき、
+ *          出力側はfailure()で失敗周期を事前に知ることができる。
+ *          出力側は計算を待たず（next()は待ち合わせない）、確保も発生しない。
+ * @tparam N 軸数
+ */
+template <typename T, int N=Naxis>
+class cartesian_stream
+{
+    public:
+        /**
+         * @brief 制御周期毎の結果
+         */
+        struct tick
+        {
+            T t;                    ///< 時刻
+            pose<T> target;         ///< 目標姿勢
+            joint<T,N> q;           ///< 関節角
+            STREAM_STATUS status;   ///< 状態
+            unsigned int mask;      ///< 制約外の軸マスク
+        };
+
+        cartesian_path<T> path;     ///< 補間経路
+        joint_limit<T,N> lim;       ///< 角度・速度制約
+        T dt;                       ///< 制御周期[s]
+        double budget = 100e-6;     ///< 1周期の逆運動学の時間予算[s]（時間切れは先行量の余裕まで延長）
+
+        /**
+         * @brief 生成
+         * @param [in] ik_ 逆運動学（軸数N）
+         * @param [in] lim_ 角度・速度制約
+         * @param [in] dt_ 制御周期[s]
+         * @param [in] lookahead 先行周期数
+         * @param [in] pipelined trueで先行スレッドを使用 falseでnext()内で計算
+         */
+        cartesian_stream(const numerical_ik<T>& ik_, const joint_limit<T,N>& lim_, T dt_, int lookahead=16, bool pipelined=true)
+         : ik(ik_), ring(lookahead+1)
+        {
+            assert(ik_.size()==N && dt_>0 && lookahead>0);
+            this->lim = lim_;
+            this->dt = dt_;
+            this->pipelined = pipelined;
+            this->nticks = 0;
+            this->head = 0;
+            this->tail = 0;
+            this->fail = -1;
+            this->quit = false;
+            this->ended = false;
+        }
+
+        ~cartesian_stream()
+        {
+            this->halt();
+        }
+
+        cartesian_stream(const cartesian_stream&) = delete;
+        cartesian_stream& operator=(const cartesian_stream&) = delete;
+
+        /**
+         * @brief 経路の開始
+         * @param [in] wp 経由姿勢（先頭は現在の手先姿勢）
+         * @param [in] q0 現在関節角
+         * @param [in] vlin 並進速度上限[m/s]
+         * @param [in] vrot 回転速度上限[rad/s]
+         * @param [in] tacc 加減速時間[s]
+         * @return 周期数
+         */
+        int start(const std::vector<pose<T>>& wp, const joint<T,N>& q0, T vlin, T vrot, T tacc)
+        {
+            this->halt();
+            T Tp = this->path(wp, vlin, vrot, tacc);
+            this->nticks = (int)ceil(Tp/this->dt - 1e-9) + 1;
+            this->qprev = q0;
+            this->head = 0;
+            this->tail = 0;
+            this->fail = -1;
+            this->quit = false;
+            this->ended = false;
+            if(this->pipelined)
+                this->worker = std::thread(&cartesian_stream::produce, this);
+            return this->nticks;
+        }
+
+        /**
+         * @brief 次の周期の結果を取得
+         * @param [out] out 結果
+         * @return 状態（STREAM_UNDERRUNでは出力なし）
+         */
+        STREAM_STATUS next(tick& out)
+        {
+            int k = this->tail.load(std::memory_order_relaxed);
+            if(k>=this->nticks || this->ended) return STREAM_END;
+            if(!this->pipelined) this->fill(k+this->ring.size()-1);
+            if(this->head.load(std::memory_order_acquire) <= k) return STREAM_UNDERRUN;
+
+            out = this->ring[k % this->ring.size()];
+            if(out.status!=STREAM_OK) this->ended = true;     // 失敗以降は出力しない
+            {
+                std::lock_guard<std::mutex> lock(this->mtx);
+                this->tail.store(k+1, std::memory_order_release);
+            }
+            this->cv.notify_one();
+            return out.status;
+        }
+
+        /**
+         * @brief 先行計算で検出した最初の失敗周期
+         * @return 周期番号 失敗なしで-1
+         */
+        int failure() const
+        {
+            return this->fail.load(std::memory_order_acquire);
+        }
+
+        /**
+         * @brief 先行計算の停止
+         */
+        void halt()
+        {
+            if(!this->worker.joinable()) return;
+            {
+                std::lock_guard<std::mutex> lock(this->mtx);
+                this->quit = true;
+            }
+            this->cv.notify_one();
+            this->worker.join();
+        }
+
+    private:
+        numerical_ik<T> ik;             ///< 逆運動学（先行側のみ使用）
+        std::vector<tick> ring;         ///< リングバッファ
+        bool pipelined;                 ///< 先行スレッドの使用
+        int nticks;                     ///< 周期数
+        joint<T,N> qprev;               ///< 前周期の解
+        std::atomic<int> head;          ///< 計算済み周期数
+        std::atomic<int> tail;          ///< 出力済み周期数
+        std::atomic<int> fail;          ///< 最初の失敗周期
+        bool quit;                      ///< 停止要求
+        bool ended;                     ///< 失敗の出力済み（出力側のみ使用）
+        std::thread worker;             ///< 先行スレッド
+        std::mutex mtx;
+        std::condition_variable cv;
+
+        /**
+         * @brief 周期kの計算
+         */
+        void solve(int k, tick& tk)
+        {
+            tk.t = std::min(k*this->dt, this->path.duration());
+            tk.target = this->path(tk.t);
+            tk.q = this->qprev;
+            IK_STATUS st = this->ik(tk.target, &tk.q.val[0], this->budget);
+            if(st==IK_TIMEOUT)
+            {
+                // 時間切れ（先行スレッドの中断など）は、周期kが出力されるまでの余裕の範囲で最良解から続行
+                int ahead = k - this->tail.load(std::memory_order_acquire);
+                if(ahead>0) st = this->ik(tk.target, &tk.q.val[0], ahead*this->dt);
+            }
+
+            joint<T,N> dq = tk.q - this->qprev;
+            unsigned int mv = 0;
+            for(int i=0; i<N; i++)
+                mv |= (unsigned int)(std::abs(dq.val[i]) > this->lim.vmax.val[i]*this->dt) << i;
+            unsigned int mq = this->lim.check(tk.q);
+
+            tk.mask = mq | mv;
+            if(st!=IK_SUCCESS)  tk.status = STREAM_IK_FAILED;
+            else if(mq)         tk.status = STREAM_LIMIT;
+            else if(mv)         tk.status = STREAM_OVERSPEED;
+            else                tk.status = STREAM_OK;
+            this->qprev = tk.q;
+        }
+
+        /**
+         * @brief 周期kまで計算（呼び出しスレッド）
+         */
+        void fill(int k)
+        {
+            int h = this->head.load(std::memory_order_relaxed);
+            for(; h<=k && h<this->nticks && this->fail<0; h++)
+            {
+                tick& tk = this->ring[h % this->ring.size()];
+                this->solve(h, tk);
+                if(tk.status!=STREAM_OK) this->fail = h;
+                this->head.store(h+1, std::memory_order_release);
+            }
+        }
+
+        /**
+         * @brief 先行スレッド
+         */
+        void produce()
+        {
+            int R = this->ring.size();
+            for(int h=0; h<this->nticks; h++)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(this->mtx);
+                    this->cv.wait(lock, [&]{ return this->quit || h - this->tail.load() < R; });
+                    if(this->quit) return;
+                }
+                tick& tk = this->ring[h % R];
+                this->solve(h, tk);
+                if(tk.status!=STREAM_OK) this->fail.store(h, std::memory_order_release);
+                this->head.store(h+1, std::memory_order_release);
+                if(tk.status!=STREAM_OK) return;
+            }
+        }
+};
+
+}
@@ -0,0 +1,214 @@
+/**
+ * @file ccd.h
+ * @brief 関節補間区間の連続干渉判定（保守的前進法）
+ */
+#pragma once
+#include <robot/bvh.h>
+
+namespace kinematics
+{
+
+/**
+ * @brief 関節補間区間の連続干渉判定クラス
+ * @details 区間 q(s) = q0 + (q1-q0)s (0<=s<=1) を保守的前進法で判定する。
+ *          リンクkの点の移動量は、関節i（i<k）の変化量とリンクkの形状から
+ *          関節i中心までの距離の上限 r[i][k] の積和で抑えられる（直動関節は係数1）。
+ *          現在の姿勢で求めたリンク毎の障害物距離・リンク対の距離を、区間全体の
+ *          移動量の上限で割った分だけsを進めても干渉しないため、
+ *          障害物から遠い区間は少ない順運動学の回数で判定できる。
+ *          リンク対(i,j)の相対位置は関節i～j-1のみで決まるため、その関節の移動量のみ用いる。
+ * @tparam N 軸数
+ */
+template <typename T, int N=Naxis>
+class continuous_check
+{
+    public:
+        static const int Nlink = N+1;   ///< リンク数（ベースを含む）
+
+        self_collision<T,N> robot;  ///< リンク形状・干渉許可（自己干渉）
+        const bvh<T> *env;          ///< 障害物（nullptrで自己干渉のみ）
+        bool self = true;           ///< 自己干渉の判定
+        T margin = 0;               ///< 干渉とみなす距離
+        T tol = 1e-3;               ///< 前進を打ち切る距離（margin+tol以下で干渉とみなす）
+        int fk_count = 0;           ///< 直前の判定の順運動学回数
+
+        /**
+         * @brief 生成
+         * @param [in] robot_ リンク形状（build()済み）
+         * @param [in] env_ 障害物（build()済み、判定中は保持すること）
+         */
+        continuous_check(const self_collision<T,N>& robot_, const bvh<T> *env_=nullptr) : robot(robot_)
+        {
+            this->env = env_;
+
+            // リンク座標系の形状の原点からの距離の上限
+            std::array<T, N+1> rho;
+            for(int k=0; k<Nlink; k++)
+            {
+                rho[k] = -INFINITY;
+                for(const auto& c : this->robot.shapes(k))
+                    rho[k] = std::max(rho[k], std::max(c.a.nrm(), c.b.nrm()) + c.r);
+            }
+
+            // 関節i（リンクi+1の原点）からリンクkの形状までの距離の上限
+            const robot_model<T,N>& rm = this->robot.rm;
+            for(int i=0; i<N; i++)
+            {
+                T len = 0;
+                for(int k=0; k<Nlink; k++)
+                {
+                    if(k>i+1) len += rm.pos[k-1].nrm();
+                    if(k<=i || rho[k]==-INFINITY) this->rad[i][k] = 0;
+                    else if(rm.type[i]==PRISMATIC) this->rad[i][k] = 1;
+                    else                           this->rad[i][k] = len + rho[k];
+                }
+            }
+        }
+
+        /**
+         * @brief 区間の判定
+         * @param [in] q0 始点
+         * @param [in] q1 終点
+         * @param [out] s 干渉時の区間パラメータ（nullptrで省略）
+         * @retval true 干渉あり（margin+tol以内への接近を含む）
+         */
+        bool operator()(const joint<T,N>& q0, const joint<T,N>& q1, T *s=nullptr)
+        {
+            joint<T,N> dq;
+            for(int m=0; m<N; m++) dq.val[m] = q1.val[m] - q0.val[m];
+
+            // 区間全体のリンクの移動量の上限（リンク対は関節i以降のみ）
+            // 回転関節の係数には途中の直動関節の伸び（端点の大きい方）を加える
+            const robot_model<T,N>& rm = this->robot.rm;
+            std::array<std::array<T, N+1>, N+1> B;
+            for(int i=0; i<Nlink; i++)
+            {
+                for(int k=0; k<Nlink; k++)
+                {
+                    T b = 0;
+                    for(int m=i; m<k; m++)
+                    {
+                        T r = this->rad[m][k];
+                        if(rm.type[m]==REVOLUTE && r>0)
+                            for(int p=m+1; p<k; p++)
+                                if(rm.type[p]==PRISMATIC) r += std::max(std::abs(q0.val[p]), std::abs(q1.val[p]));
+                        b += std::abs(dq.val[m])*r;
+                    }
+                    B[i][k] = b;
+                }
+            }
+
+            this->fk_count = 0;
+            T u = 0;
+            while(true)
+            {
+                joint<T,N> q;
+                for(int m=0; m<N; m++) q.val[m] = q0.val[m] + dq.val[m]*u;
+                this->place(to_pose_array(rm, q));
+                this->fk_count++;
+
+                T step = INFINITY;
+                if(this->env)
+                {
+                    for(int k=0; k<Nlink; k++)
+                    {
+                        if(this->off[k]==this->off[k+1]) continue;
+                        T d = this->env_distance(k) - this->margin;
+                        if(d <= this->tol) return this->hit(u, s);
+                        if(B[0][k]>0) step = std::min(step, d/B[0][k]);
+                    }
+                }
+                if(this->self)
+                {
+                    for(const auto& pr : this->robot.pair_list())
+                    {
+                        int i = pr.first, j = pr.second;
+                        T d = this->pair_distance(i, j) - this->margin;
+                        if(d <= this->tol) return this->hit(u, s);
+                        if(B[i][j]>0) step = std::min(step, d/B[i][j]);
+                    }
+                }
+                if(u>=1) return false;
+                u = std::min(u + step, (T)1);
+            }
+        }
+
+        /**
+         * @brief 経由点列の判定
+         * @param [in] wp 経由点
+         * @param [in] n 経由点数
+         * @param [out] s 干渉時の区間パラメータ（nullptrで省略）
+         * @return 最初に干渉した区間番号 干渉なしで-1
+         * @note fk_countは全区間の合計
+         */
+        int operator()(const joint<T,N> wp[], int n, T *s=nullptr)
+        {
+            int total = 0;
+            for(int i=0; i+1<n; i++)
+            {
+                bool ret = (*this)(wp[i], wp[i+1], s);
+                total += this->fk_count;
+                if(ret)
+                {
+                    this->fk_count = total;
+                    return i;
+                }
+            }
+            this->fk_count = total;
+            return -1;
+        }
+
+        /**
+         * @brief 関節iの変化に対するリンクkの移動量係数
+         */
+        T radius(int i, int k) const
+        {
+            return this->rad[i][k];
+        }
+
+    private:
+        std::array<std::array<T, N+1>, N> rad;  ///< 移動量係数 rad[関節][リンク]
+        std::vector<capsule<T>> cap;            ///< 基準座標系の形状
+        std::array<int, N+2> off;               ///< リンク毎の形状の開始位置
+
+        bool hit(T u, T *s) const
+        {
+            if(s) *s = u;
+            return true;
+        }
+
+        /**
+         * @brief 全リンクの形状を基準座標系へ
+         */
+        template <typename C>
+        void place(const C& pa)
+        {
+            this->cap.clear();
+            for(int k=0; k<Nlink; k++)
+            {
+                this->off[k] = this->cap.size();
+                for(const auto& c : this->robot.shapes(k))
+                    this->cap.push_back(capsule<T>{transform<T>(pa[k], c.a), transform<T>(pa[k], c.b), c.r});
+            }
+            this->off[Nlink] = this->cap.size();
+        }
+
+        T env_distance(int k) const
+        {
+            T ret = INFINITY;
+            for(int a=this->off[k]; a<this->off[k+1]; a++)
+                ret = std::min(ret, this->env->distance(this->cap[a]));
+            return ret;
+        }
+
+        T pair_distance(int i, int j) const
+        {
+            T ret = INFINITY;
+            for(int a=this->off[i]; a<this->off[i+1]; a++)
+                for(int b=this->off[j]; b<this->off[j+1]; b++)
+                    ret = std::min(ret, distance(this->cap[a], this->cap[b]));
+            return ret;
+        }
+};
+
+}
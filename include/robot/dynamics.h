@@ -0,0 +1,163 @@
+/**
+ * @file dynamics.h
+ * @brief 逆動力学（再帰ニュートン・オイラー法）
+ */
+#pragma once
+#include <robot/robot.h>
+#include <robot/geometry.h>
+#include <robot/thread_pool.h>
+#include <atomic>
+
+namespace kinematics
+{
+
+/**
+ * @brief 逆動力学クラス（再帰ニュートン・オイラー法）
+ * @details 関節角・角速度・角加速度から関節トルク（直動関節では力）を求める。
+ *          リンクの姿勢は同周期で計算済みのFK座標系（to_pose_array）をそのまま使い、
+ *          速度・加速度とリンクに働く力は基準座標系で表す。
+ *          - 前進: 根元から角速度ω・角加速度α・関節原点の加速度aを伝播
+ *            （ベースの加速度を-gとして重力を含める）
+ *          - 後退: 先端から力fとモーメントnを集計し、関節軸成分をトルクとする
+ *          慣性テンソルはリンク座標系で持ち、角速度を座標変換して積をとる。
+ *          作業領域は軸数で決まる固定長配列のみで、確保は発生しない。
+ * @tparam N 軸数
+ */
+template <typename T, int N=Naxis>
+class inverse_dynamics
+{
+    public:
+        robot_model<T,N> rm;    ///< ロボットモデル（慣性パラメータ・重力を含む）
+
+        /**
+         * @brief 生成
+         * @param [in] rm_ ロボットモデル
+         */
+        inverse_dynamics(const robot_model<T,N>& rm_=robot_model<T,N>()) : rm(rm_) {}
+
+        /**
+         * @brief 関節トルク（順運動学を含む）
+         * @param [in] q 関節角
+         * @param [in] qd 関節角速度
+         * @param [in] qdd 関節角加速度
+         * @param [in] posI ベース姿勢（重力は基準座標系）
+         * @return 関節トルク[Nm]（直動関節は力[N]）
+         */
+        joint<T,N> operator()(const joint<T,N>& q, const joint<T,N>& qd, const joint<T,N>& qdd, const pose<T>& posI=pose<T>()) const
+        {
+            return (*this)(to_pose_array(this->rm, q, posI), qd, qdd);
+        }
+
+        /**
+         * @brief 計算済みFK座標系から関節トルク
+         * @param [in] pa 同周期で計算済みのFK座標系(to_pose_array) 要素数は軸数+1以上
+         * @param [in] qd 関節角速度
+         * @param [in] qdd 関節角加速度
+         * @param [in] gravity falseで重力項を除く
+         * @return 関節トルク[Nm]（直動関節は力[N]）
+         */
+        template <typename C>
+        joint<T,N> operator()(const C& pa, const joint<T,N>& qd, const joint<T,N>& qdd, bool gravity=true) const
+        {
+            assert((int)pa.size() > N);
+            std::array<vec3<T>, N> z, f, n, rc;
+
+            // 前進（根元から速度・加速度）
+            vec3<T> w, dw;
+            vec3<T> a = gravity ? -this->rm.gravity : vec3<T>();
+            for(int i=0; i<N; i++)
+            {
+                const vec4<T>& R = pa[i+1].q;
+                const vec3<T> r = pa[i+1].p - pa[i].p;
+                z[i] = rotate(R, this->rm.alfa[i]);
+                a = a + dw % r + w % (w % r);
+                if(this->rm.type[i]==PRISMATIC)
+                {
+                    a = a + w % z[i]*(2*qd.val[i]) + z[i]*qdd.val[i];
+                }
+                else
+                {
+                    dw = dw + z[i]*qdd.val[i] + w % z[i]*qd.val[i];
+                    w = w + z[i]*qd.val[i];
+                }
+
+                // 重心の加速度と慣性力・慣性モーメント
+                const link_inertia<T>& in = this->rm.inertia[i];
+                vec4<T> Rt = R.conj();
+                rc[i] = rotate(R, in.c);
+                vec3<T> ac = a + dw % rc[i] + w % (w % rc[i]);
+                vec3<T> wl = rotate(Rt, w), dwl = rotate(Rt, dw);
+                f[i] = ac*in.m;
+                n[i] = rotate(R, in.mul(dwl) + wl % in.mul(wl));
+            }
+
+            // 後退（先端から力・モーメント）
+            joint<T,N> tau;
+            vec3<T> fn, nn;         // 子リンクから受ける力・モーメント
+            for(int i=N-1; i>=0; i--)
+            {
+                vec3<T> r = (i<N-1) ? pa[i+2].p - pa[i+1].p : vec3<T>();
+                nn = n[i] + nn + rc[i] % f[i] + r % fn;
+                fn = f[i] + fn;
+                tau.val[i] = (this->rm.type[i]==PRISMATIC) ? z[i]*fn : z[i]*nn;
+            }
+            return tau;
+        }
+
+        /**
+         * @brief 重力補償トルク
+         */
+        template <typename C>
+        joint<T,N> gravity(const C& pa) const
+        {
+            joint<T,N> zero;
+            return (*this)(pa, zero, zero);
+        }
+
+        /**
+         * @brief 軌道の一括計算とトルク制約判定
+         * @details 要素毎に順運動学と逆動力学を計算し、要素をワーカープールで分担する。
+         * @param [in] q 関節角 q[軸][要素]
+         * @param [in] qd 関節角速度 qd[軸][要素]
+         * @param [in] qdd 関節角加速度 qdd[軸][要素]
+         * @param [in] num 要素数
+         * @param [out] tau 関節トルク tau[軸][要素]（nullptrで省略）
+         * @param [in] lim トルク制約（tmax、nullptrで判定しない）
+         * @param [out] out 要素毎のトルク制約外の軸マスク（nullptrで省略）
+         * @param [in] pool ワーカープール（nullptrで呼び出しスレッドのみ）
+         * @return 最初にトルク制約外となる要素の番号 制約内（判定なし）で-1
+         */
+        int batch(const T* const q[], const T* const qd[], const T* const qdd[], int num, T* const tau[]=nullptr,
+                  const joint_limit<T,N> *lim=nullptr, unsigned int out[]=nullptr, thread_pool *pool=nullptr) const
+        {
+            std::atomic<int> first(num);
+            auto job = [&](int b, int e, int)
+            {
+                for(int k=b; k<e; k++)
+                {
+                    joint<T,N> x, v, a;
+                    for(int i=0; i<N; i++)
+                    {
+                        x.val[i] = q[i][k];
+                        v.val[i] = qd[i][k];
+                        a.val[i] = qdd[i][k];
+                    }
+                    joint<T,N> t = (*this)(x, v, a);
+                    if(tau) for(int i=0; i<N; i++) tau[i][k] = t.val[i];
+                    if(!lim) continue;
+                    unsigned int m = joint_limit<T,N>::mask(t, -joint<T,N>(lim->tmax), lim->tmax);
+                    if(out) out[k] = m;
+                    if(m)
+                    {
+                        int cur = first.load();
+                        while(k < cur && !first.compare_exchange_weak(cur, k));
+                    }
+                }
+            };
+            if(pool) pool->parallel_for(num, job);
+            else     job(0, num, 0);
+            return (first.load() < num) ? first.load() : -1;
+        }
+};
+
+}
@@ -0,0 +1,279 @@
+/**
+ * @file geometry.h
+ * @brief 干渉判定用の幾何要素と距離計算
+ */
+#pragma once
+#include <kinematics/kinematics.h>
+#include <algorithm>
+
+namespace kinematics
+{
+
+/**
+ * @brief 単位クォータニオンによるベクトル回転（正規化なし）
+ */
+template <typename T>
+inline vec3<T> rotate(const vec4<T>& q, const vec3<T>& v)
+{
+    vec3<T> u(q.x, q.y, q.z);
+    vec3<T> t = (u % v)*2.0;
+    return v + t*q.w + (u % t);
+}
+
+/**
+ * @brief 座標変換 x -> P.p + P.q x（正規化なし）
+ */
+template <typename T>
+inline vec3<T> transform(const pose<T>& P, const vec3<T>& x)
+{
+    return P.p + rotate(P.q, x);
+}
+
+/**
+ * @brief 球
+ */
+template <typename T>
+struct sphere
+{
+    vec3<T> c;  ///< 中心
+    T r;        ///< 半径
+};
+
+/**
+ * @brief カプセル（線分の膨張、a==bで球）
+ */
+template <typename T>
+struct capsule
+{
+    vec3<T> a;  ///< 線分始点
+    vec3<T> b;  ///< 線分終点
+    T r;        ///< 半径
+};
+
+/**
+ * @brief 線分間の最短距離の2乗
+ * @details C. Ericson, "Real-Time Collision Detection" 5.1.9
+ * @param [in] p1,q1 線分1
+ * @param [in] p2,q2 線分2
+ * @param [out] s 線分1上の最近点パラメータ[0,1]（nullptrで省略）
+ * @param [out] t 線分2上の最近点パラメータ[0,1]（nullptrで省略）
+ */
+template <typename T>
+T segment_distance2(const vec3<T>& p1, const vec3<T>& q1, const vec3<T>& p2, const vec3<T>& q2, T *s_=nullptr, T *t_=nullptr)
+{
+    const T eps = 1e-15;
+    vec3<T> d1 = q1 - p1;
+    vec3<T> d2 = q2 - p2;
+    vec3<T> r = p1 - p2;
+    T a = d1*d1, e = d2*d2, f = d2*r;
+    T s, t;
+    if(a<=eps && e<=eps)
+    {
+        s = t = 0;
+    }
+    else if(a<=eps)
+    {
+        s = 0;
+        t = std::min(std::max(f/e, (T)0), (T)1);
+    }
+    else
+    {
+        T c = d1*r;
+        if(e<=eps)
+        {
+            t = 0;
+            s = std::min(std::max(-c/a, (T)0), (T)1);
+        }
+        else
+        {
+            T b = d1*d2;
+            T den = a*e - b*b;
+            s = (den>0) ? std::min(std::max((b*f - c*e)/den, (T)0), (T)1) : 0;
+            t = (b*s + f)/e;
+            if(t<0)      { t = 0; s = std::min(std::max(-c/a, (T)0), (T)1); }
+            else if(t>1) { t = 1; s = std::min(std::max((b-c)/a, (T)0), (T)1); }
+        }
+    }
+    if(s_) *s_ = s;
+    if(t_) *t_ = t;
+    vec3<T> d = r + d1*s - d2*t;
+    return d*d;
+}
+
+/**
+ * @brief カプセル間の距離（貫通で負）
+ */
+template <typename T>
+inline T distance(const capsule<T>& c1, const capsule<T>& c2)
+{
+    return sqrt(segment_distance2(c1.a, c1.b, c2.a, c2.b)) - c1.r - c2.r;
+}
+
+/**
+ * @brief 軸平行包含箱
+ */
+template <typename T>
+struct aabb
+{
+    vec3<T> lo = vec3<T>(INFINITY, INFINITY, INFINITY);     ///< 下限
+    vec3<T> hi = vec3<T>(-INFINITY, -INFINITY, -INFINITY);  ///< 上限
+
+    /**
+     * @brief 点を含むよう拡大
+     */
+    void grow(const vec3<T>& x)
+    {
+        lo = vec3<T>(std::min(lo.x, x.x), std::min(lo.y, x.y), std::min(lo.z, x.z));
+        hi = vec3<T>(std::max(hi.x, x.x), std::max(hi.y, x.y), std::max(hi.z, x.z));
+    }
+
+    /**
+     * @brief 箱を含むよう拡大
+     */
+    void grow(const aabb<T>& b)
+    {
+        grow(b.lo);
+        grow(b.hi);
+    }
+
+    /**
+     * @brief 重なり判定
+     */
+    bool overlap(const aabb<T>& b) const
+    {
+        return lo.x<=b.hi.x && b.lo.x<=hi.x && lo.y<=b.hi.y && b.lo.y<=hi.y && lo.z<=b.hi.z && b.lo.z<=hi.z;
+    }
+
+    vec3<T> center() const { return (lo + hi)*0.5; }
+    vec3<T> half() const { return (hi - lo)*0.5; }
+};
+
+/**
+ * @brief カプセルの包含箱
+ */
+template <typename T>
+inline aabb<T> bounds(const capsule<T>& c)
+{
+    aabb<T> ret;
+    ret.grow(c.a);
+    ret.grow(c.b);
+    ret.lo = ret.lo - c.r;
+    ret.hi = ret.hi + c.r;
+    return ret;
+}
+
+/**
+ * @brief 線分と原点中心の軸平行箱の最短距離の2乗
+ * @details 距離の2乗は線分パラメータsについて区分2次の凸関数で、
+ *          各軸の面を横切るs（最大6個）で区切った区間毎に厳密に最小化する。
+ * @param [in] p 線分始点（箱座標系）
+ * @param [in] d 線分の方向（終点-始点）
+ * @param [in] h 箱の半辺長
+ */
+template <typename T>
+T segment_box_distance2(const vec3<T>& p, const vec3<T>& d, const vec3<T>& h)
+{
+    const T P[3] = {p.x, p.y, p.z};
+    const T D[3] = {d.x, d.y, d.z};
+    const T H[3] = {h.x, h.y, h.z};
+    T brk[8];
+    int n = 0;
+    brk[n++] = 0;
+    for(int k=0; k<3; k++)
+    {
+        T pk = P[k], dk = D[k], hk = H[k];
+        if(dk==0) continue;
+        for(T sg : {(T)-1, (T)1})
+        {
+            T s = (sg*hk - pk)/dk;
+            if(0<s && s<1) brk[n++] = s;
+        }
+    }
+    brk[n++] = 1;
+    for(int i=1; i<n; i++)      // 挿入ソート（最大8個）
+        for(int j=i; j>0 && brk[j]<brk[j-1]; j--) std::swap(brk[j], brk[j-1]);
+
+    T ret = INFINITY;
+    for(int i=0; i+1<n; i++)
+    {
+        T s0 = brk[i], s1 = brk[i+1];
+        T sm = 0.5*(s0+s1);
+        // 区間内で有効な面の2次式 A s^2 + B s + C
+        T A = 0, B = 0, C = 0;
+        for(int k=0; k<3; k++)
+        {
+            T pk = P[k], dk = D[k], hk = H[k];
+            T x = pk + dk*sm;
+            T o;
+            if(x > hk)       o = pk - hk;
+            else if(x < -hk) o = pk + hk;
+            else continue;
+            A += dk*dk;
+            B += 2*o*dk;
+            C += o*o;
+        }
+        T s = (A>0) ? std::min(std::max(-B/(2*A), s0), s1) : s0;
+        ret = std::min(ret, std::max((A*s + B)*s + C, (T)0));
+    }
+    return ret;
+}
+
+/**
+ * @brief 三角形上の最近点
+ * @details C. Ericson, "Real-Time Collision Detection" 5.1.5
+ */
+template <typename T>
+vec3<T> closest_point_triangle(const vec3<T>& p, const vec3<T>& a, const vec3<T>& b, const vec3<T>& c)
+{
+    vec3<T> ab = b - a, ac = c - a, ap = p - a;
+    T d1 = ab*ap, d2 = ac*ap;
+    if(d1<=0 && d2<=0) return a;
+    vec3<T> bp = p - b;
+    T d3 = ab*bp, d4 = ac*bp;
+    if(d3>=0 && d4<=d3) return b;
+    T vc = d1*d4 - d3*d2;
+    if(vc<=0 && d1>=0 && d3<=0) return a + ab*(d1/(d1-d3));
+    vec3<T> cp = p - c;
+    T d5 = ab*cp, d6 = ac*cp;
+    if(d6>=0 && d5<=d6) return c;
+    T vb = d5*d2 - d1*d6;
+    if(vb<=0 && d2>=0 && d6<=0) return a + ac*(d2/(d2-d6));
+    T va = d3*d6 - d5*d4;
+    if(va<=0 && (d4-d3)>=0 && (d5-d6)>=0) return b + (c-b)*((d4-d3)/((d4-d3)+(d5-d6)));
+    T den = 1/(va+vb+vc);
+    return a + ab*(vb*den) + ac*(vc*den);
+}
+
+/**
+ * @brief 線分と三角形の最短距離の2乗
+ * @details 交差しなければ最短は線分端点か三角形の辺で生じる
+ */
+template <typename T>
+T segment_triangle_distance2(const vec3<T>& p, const vec3<T>& q, const vec3<T>& a, const vec3<T>& b, const vec3<T>& c)
+{
+    // 交差判定（Moller-Trumbore）
+    vec3<T> d = q - p;
+    vec3<T> e1 = b - a, e2 = c - a;
+    vec3<T> h = d % e2;
+    T det = e1*h;
+    if(std::abs(det) > 1e-15)
+    {
+        T f = 1/det;
+        vec3<T> s = p - a;
+        T u = f*(s*h);
+        vec3<T> r = s % e1;
+        T v = f*(d*r);
+        T t = f*(e2*r);
+        if(u>=0 && v>=0 && u+v<=1 && t>=0 && t<=1) return 0;
+    }
+
+    vec3<T> x0 = p - closest_point_triangle(p, a, b, c);
+    vec3<T> x1 = q - closest_point_triangle(q, a, b, c);
+    T ret = std::min(x0*x0, x1*x1);
+    ret = std::min(ret, segment_distance2(p, q, a, b));
+    ret = std::min(ret, segment_distance2(p, q, b, c));
+    ret = std::min(ret, segment_distance2(p, q, c, a));
+    return ret;
+}
+
+}
@@ -0,0 +1,130 @@
+/**
+ * @file ik_select.h
+ * @brief 形態フラグと関節距離による逆運動学解の選択
+ */
+#pragma once
+#include <robot/robot.h>
+
+namespace kinematics
+{
+
+/**
+ * @brief 逆運動学解の選択クラス
+ * @details 分岐解（最大8個）それぞれについて、各軸の2pi回転違いの解を
+ *          角度制約内で現在角に最も近いものへ閉形式で展開し、
+ *          要求形態(SFLG1/SFLG2)と一致するもののうち重み付き距離最小の解を選ぶ。
+ *          距離は軸毎に独立な重み付き二乗和のため、軸毎の回転数選択で最適になる。
+ *          候補数に比例する固定回数の演算のみで、確保は発生しない。
+ * @tparam N 軸数
+ */
+template <typename T, int N=Naxis>
+class ik_select
+{
+    public:
+        static const int Nmax = 8;  ///< 分岐解の最大数
+
+        joint<T,N> qmin;  ///< 角度下限[rad]
+        joint<T,N> qmax;  ///< 角度上限[rad]
+        joint<T,N> wgt;   ///< 距離の重み
+
+        /**
+         * @brief 生成
+         * @param [in] qmin_ 角度下限[rad]
+         * @param [in] qmax_ 角度上限[rad]
+         */
+        ik_select(joint<T,N> qmin_, joint<T,N> qmax_)
+        {
+            this->qmin = qmin_;
+            this->qmax = qmax_;
+            this->wgt.val.fill(1);
+            for(int i=0; i<N; i++) assert(qmin_[i]<=qmax_[i]);
+        }
+
+        /**
+         * @brief 候補解の回転違いを展開
+         * @param [in] cand 候補解
+         * @param [in] cur 現在関節角
+         * @param [out] out 展開後の解
+         * @param [in] flg2 要求回転数（nullptrで現在角に最も近い回転数）
+         * @retval false 角度制約を満たす回転数がない
+         */
+        bool expand(joint<T,N> cand, joint<T,N> cur, joint<T,N>& out, const SFLG2 *flg2=nullptr) const
+        {
+            const T P2 = 2.0*M_PI;
+            int n[N];
+            if(flg2) decode_flg2(flg2->val, n, N);
+            for(int i=0; i<N; i++)
+            {
+                T a = cand[i] - P2*round(cand[i]/P2);      // [-pi,pi]
+                if(flg2)
+                {
+                    out[i] = a + P2*n[i];
+                    if(out[i] < qmin.val[i] || qmax.val[i] < out[i]) return false;
+                }
+                else
+                {
+                    T kmin = ceil ((qmin.val[i] - a)/P2);
+                    T kmax = floor((qmax.val[i] - a)/P2);
+                    if(kmin > kmax) return false;
+                    T k = round((cur[i] - a)/P2);
+                    k = std::min(std::max(k, kmin), kmax);
+                    out[i] = a + P2*k;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * @brief 重み付き二乗距離
+         */
+        T distance(joint<T,N> a, joint<T,N> b) const
+        {
+            T ret = 0;
+            for(int i=0; i<N; i++)
+            {
+                T d = a[i] - b[i];
+                ret += this->wgt.val[i]*d*d;
+            }
+            return ret;
+        }
+
+        /**
+         * @brief 解の選択
+         * @param [in] cand 分岐解配列（NaNを含む解は無効）
+         * @param [in] n 分岐解数（Nmax以下）
+         * @param [in] cur 現在関節角
+         * @param [out] out 選択した解
+         * @param [in] flg1 要求形態（nullptrで任意）
+         * @param [in] flg2 要求回転数（nullptrで任意）
+         * @param [out] cost 選択した解の重み付き二乗距離
+         * @return 選択した分岐解の番号 該当なしで-1
+         */
+        int operator()(const joint<T,N> cand[], int n, joint<T,N> cur, joint<T,N>& out,
+                       const SFLG1 *flg1=nullptr, const SFLG2 *flg2=nullptr, T *cost=nullptr) const
+        {
+            assert(0<=n && n<=Nmax);
+            int ret = -1;
+            T best = INFINITY;
+            for(int k=0; k<n; k++)
+            {
+                joint<T,N> c = cand[k];
+                if(!c.isnum()) continue;
+
+                joint<T,N> q;
+                if(!this->expand(c, cur, q, flg2)) continue;
+                if(flg1 && FlgChk(q).flg1.val != flg1->val) continue;
+
+                T d = this->distance(q, cur);
+                if(d < best)
+                {
+                    best = d;
+                    out = q;
+                    ret = k;
+                }
+            }
+            if(cost) *cost = best;
+            return ret;
+        }
+};
+
+}
@@ -0,0 +1,216 @@
+/**
+ * @file interval.h
+ * @brief 区間演算と関節範囲の順運動学（リンクの包含箱）
+ */
+#pragma once
+#include <robot/bvh.h>
+#include <limits>
+
+namespace kinematics
+{
+
+/**
+ * @brief 閉区間 [lo, hi]
+ * @details vec3の要素型として使用できる（vec3<interval<T>>で位置の範囲）。
+ *          丸め誤差で範囲を取りこぼさないよう、演算結果の端点は相対epsilonだけ外側へ広げる。
+ */
+template <typename T>
+struct interval
+{
+    T lo;   ///< 下限
+    T hi;   ///< 上限
+
+    interval() : lo(0), hi(0) {}
+    interval(T v) : lo(v), hi(v) {}
+    interval(T lo_, T hi_) : lo(lo_), hi(hi_) {}
+
+    T width() const { return hi - lo; }
+    T mid() const { return 0.5*(lo + hi); }
+    bool contains(T v) const { return lo<=v && v<=hi; }
+
+    /**
+     * @brief 端点を外側へ丸めた区間
+     */
+    static interval outward(T lo_, T hi_)
+    {
+        // 0は厳密なので広げない（非正規化数の演算を避ける）
+        const T eps = std::numeric_limits<T>::epsilon();
+        return interval(lo_ - std::abs(lo_)*eps, hi_ + std::abs(hi_)*eps);
+    }
+
+    friend interval operator+(const interval& a, const interval& b) { return outward(a.lo + b.lo, a.hi + b.hi); }
+    friend interval operator-(const interval& a, const interval& b) { return outward(a.lo - b.hi, a.hi - b.lo); }
+    friend interval operator-(const interval& a) { return interval(-a.hi, -a.lo); }
+    friend interval operator*(const interval& a, const interval& b)
+    {
+        T p0 = a.lo*b.lo, p1 = a.lo*b.hi, p2 = a.hi*b.lo, p3 = a.hi*b.hi;
+        return outward(std::min(std::min(p0, p1), std::min(p2, p3)), std::max(std::max(p0, p1), std::max(p2, p3)));
+    }
+    interval& operator+=(const interval& b) { return *this = *this + b; }
+
+    /**
+     * @brief 正弦（ADLでのみ参照され、スカラのsinを隠さない）
+     */
+    friend interval sin(const interval& a)
+    {
+        // 極値 pi/2 + 2k pi, -pi/2 + 2k pi
+        return extremum(a, std::sin(a.lo), std::sin(a.hi), M_PI/2);
+    }
+
+    /**
+     * @brief 余弦
+     */
+    friend interval cos(const interval& a)
+    {
+        // 極値 2k pi, pi + 2k pi
+        return extremum(a, std::cos(a.lo), std::cos(a.hi), 0);
+    }
+
+    private:
+        /**
+         * @brief 周期2piの正弦波形の区間（最大値の位相ph、最小値はph+pi）
+         */
+        static interval extremum(const interval& a, T f0, T f1, T ph)
+        {
+            if(a.width() >= 2*M_PI) return interval(-1, 1);
+            interval ret = outward(std::min(f0, f1), std::max(f0, f1));
+            if(std::ceil((a.lo - ph)/(2*M_PI)) <= std::floor((a.hi - ph)/(2*M_PI)))                 ret.hi = 1;
+            if(std::ceil((a.lo - ph - M_PI)/(2*M_PI)) <= std::floor((a.hi - ph - M_PI)/(2*M_PI)))   ret.lo = -1;
+            ret.lo = std::max(ret.lo, (T)-1);
+            ret.hi = std::min(ret.hi, (T)1);
+            return ret;
+        }
+};
+
+/**
+ * @brief 区間の共通部分（空でないこと）
+ */
+template <typename T>
+inline interval<T> intersect(const interval<T>& a, const interval<T>& b)
+{
+    return interval<T>(std::max(a.lo, b.lo), std::min(a.hi, b.hi));
+}
+
+/**
+ * @brief 位置・姿勢の範囲（回転行列の要素毎の区間）
+ */
+template <typename T>
+struct interval_frame
+{
+    vec3<interval<T>> p;                    ///< 原点位置
+    std::array<vec3<interval<T>>, 3> R;     ///< 回転行列の行
+
+    /**
+     * @brief 点の変換 p + R x
+     */
+    vec3<interval<T>> operator()(const vec3<interval<T>>& x) const
+    {
+        return this->p + vec3<interval<T>>(this->R[0]*x, this->R[1]*x, this->R[2]*x);
+    }
+
+    /**
+     * @brief 位置の範囲の包含箱
+     */
+    static aabb<T> box(const vec3<interval<T>>& x)
+    {
+        aabb<T> ret;
+        ret.lo = vec3<T>(x.x.lo, x.y.lo, x.z.lo);
+        ret.hi = vec3<T>(x.x.hi, x.y.hi, x.z.hi);
+        return ret;
+    }
+};
+
+/**
+ * @brief 関節範囲の順運動学
+ * @details to_pose_arrayと同じ座標系列を区間で求める。
+ *          関節の回転は軸まわりの回転行列 I + sin K + (1-cos) K^2 の要素を区間で評価し、
+ *          行列積で伝播する（要素は[-1,1]に制限）。範囲が狭いほど包含箱は厳密に近づく。
+ * @param [in] rm ロボットモデル
+ * @param [in] qlo 関節の下限
+ * @param [in] qhi 関節の上限
+ * @param [in] posI ベース姿勢
+ * @return 各リンク座標系の範囲（N+1個）
+ */
+template <typename T, int N>
+std::array<interval_frame<T>, N+1> to_interval_frames(const robot_model<T,N>& rm, const joint<T,N>& qlo, const joint<T,N>& qhi, const pose<T>& posI=pose<T>())
+{
+    typedef interval<T> I;
+    std::array<interval_frame<T>, N+1> ret;
+
+    // ベース（点）
+    interval_frame<T>& f0 = ret[0];
+    f0.p = vec3<I>(posI.p.x, posI.p.y, posI.p.z);
+    for(int r=0; r<3; r++)
+    {
+        vec3<T> e;
+        (&e.x)[r] = 1;
+        vec3<T> c = rotate(posI.q.conj(), e);     // R の r 行目 = R^T e_r
+        f0.R[r] = vec3<I>(c.x, c.y, c.z);
+    }
+
+    const I unit(-1, 1);
+    for(int i=0; i<N; i++)
+    {
+        const interval_frame<T>& a = ret[i];
+        interval_frame<T>& b = ret[i+1];
+        I q(qlo.val[i], qhi.val[i]);
+        vec3<I> pos(rm.pos[i].x, rm.pos[i].y, rm.pos[i].z);
+        const vec3<T>& k = rm.alfa[i];
+        if(rm.type[i]==PRISMATIC)
+        {
+            b.R = a.R;
+            b.p = a(pos + vec3<I>(k.x*q, k.y*q, k.z*q));
+            continue;
+        }
+
+        // 関節の回転行列 J = I + s K + (1-c)(k k^T - I)
+        I s = sin(q), c1 = I(1) - cos(q);
+        const T kv[3] = {k.x, k.y, k.z};
+        const T K[3][3] = {{0, -k.z, k.y}, {k.z, 0, -k.x}, {-k.y, k.x, 0}};
+        I J[3][3];
+        for(int r=0; r<3; r++)
+            for(int m=0; m<3; m++)
+                J[r][m] = I(r==m ? 1 : 0) + s*I(K[r][m]) + c1*I(kv[r]*kv[m] - (r==m ? 1 : 0));
+
+        b.p = a(pos);
+        for(int r=0; r<3; r++)
+        {
+            const vec3<I>& row = a.R[r];
+            b.R[r] = vec3<I>(intersect(row.x*J[0][0] + row.y*J[1][0] + row.z*J[2][0], unit),
+                             intersect(row.x*J[0][1] + row.y*J[1][1] + row.z*J[2][1], unit),
+                             intersect(row.x*J[0][2] + row.y*J[1][2] + row.z*J[2][2], unit));
+        }
+    }
+    return ret;
+}
+
+/**
+ * @brief 関節範囲でリンク形状が占め得る包含箱
+ * @param [in] robot リンク形状
+ * @param [in] qlo 関節の下限
+ * @param [in] qhi 関節の上限
+ * @param [in] posI ベース姿勢
+ * @return リンク毎の包含箱（形状のないリンクは空の箱）
+ */
+template <typename T, int N>
+std::array<aabb<T>, N+1> link_bounds(const self_collision<T,N>& robot, const joint<T,N>& qlo, const joint<T,N>& qhi, const pose<T>& posI=pose<T>())
+{
+    typedef interval<T> I;
+    std::array<interval_frame<T>, N+1> fr = to_interval_frames(robot.rm, qlo, qhi, posI);
+    std::array<aabb<T>, N+1> ret;
+    for(int k=0; k<=N; k++)
+    {
+        for(const auto& c : robot.shapes(k))
+        {
+            // カプセルは両端点の範囲の凸包を半径だけ膨張した領域に含まれる
+            aabb<T> b = interval_frame<T>::box(fr[k](vec3<I>(c.a.x, c.a.y, c.a.z)));
+            b.grow(interval_frame<T>::box(fr[k](vec3<I>(c.b.x, c.b.y, c.b.z))));
+            b.lo = b.lo - c.r;
+            b.hi = b.hi + c.r;
+            ret[k].grow(b);
+        }
+    }
+    return ret;
+}
+
+}
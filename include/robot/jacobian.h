@@ -0,0 +1,285 @@
+/**
+ * @file jacobian.h
+ * @brief ヤコビ行列と減衰最小二乗解
+ */
+#pragma once
+#include <robot/robot.h>
+
+namespace kinematics
+{
+
+/**
+ * @brief 並進速度・角速度の組（ツイスト）
+ */
+template <typename T>
+class twist
+{
+    public:
+        vec3<T> v;  ///< 並進速度（基準座標系）
+        vec3<T> w;  ///< 角速度（基準座標系）
+
+        twist(){}
+
+        twist(const vec3<T> v_, const vec3<T> w_)
+        {
+            this->v = v_;
+            this->w = w_;
+        }
+
+        /**
+         * @brief 要素アクセス [vx, vy, vz, wx, wy, wz]
+         */
+        T& operator[](int n)
+        {
+            assert(0<=n && n<6);
+            return (n<3) ? this->v[n] : this->w[n-3];
+        }
+
+        twist<T> operator+(const twist<T>& obj) const
+        {
+            return twist<T>(this->v+obj.v, this->w+obj.w);
+        }
+
+        twist<T> operator-(const twist<T>& obj) const
+        {
+            return twist<T>(this->v-obj.v, this->w-obj.w);
+        }
+
+        twist<T> operator*(T k) const
+        {
+            return twist<T>(this->v*k, this->w*k);
+        }
+
+        /**
+         * @brief ノルム
+         */
+        T nrm() const
+        {
+            return sqrt(this->v*this->v + this->w*this->w);
+        }
+};
+
+template <typename T>
+std::ostream& operator<<(std::ostream& stream, const twist<T>& obj)
+{
+    return( stream << "v = " << obj.v << "  w = " << obj.w );
+}
+
+/**
+ * @brief クォータニオンの回転ベクトル（回転軸×回転角）
+ * @note 回転角範囲[0, pi]
+ */
+template <typename T>
+vec3<T> rotvec(vec4<T> q)
+{
+    if(q.w<0) q = -q;
+    vec3<T> u(q.x, q.y, q.z);
+    T s = u.nrm();
+    if(s<1e-12) return u*2.0;       // 微小回転
+    return u*(2.0*atan2(s, q.w)/s);
+}
+
+/**
+ * @brief 現在姿勢(cur)から目標姿勢(target)への偏差
+ * @return 位置偏差と回転ベクトル（基準座標系）
+ */
+template <typename T>
+twist<T> pose_error(const pose<T>& target, const pose<T>& cur)
+{
+    vec4<T> dq = target.q * cur.q.conj();
+    return twist<T>(target.p - cur.p, rotvec(dq));
+}
+
+/**
+ * @brief 6x6対称正定値行列の連立一次方程式 A*x=b（コレスキー分解）
+ * @param [in,out] A 係数行列（下三角が分解結果で上書きされる）
+ * @param [in,out] b 右辺（解で上書き）
+ * @retval false 正定値でない
+ */
+template <typename T>
+bool chol6(T A[6][6], T b[6])
+{
+    for(int j=0; j<6; j++)
+    {
+        T d = A[j][j];
+        for(int k=0; k<j; k++) d -= A[j][k]*A[j][k];
+        if(!(d>0)) return false;
+        A[j][j] = sqrt(d);
+        for(int i=j+1; i<6; i++)
+        {
+            T s = A[i][j];
+            for(int k=0; k<j; k++) s -= A[i][k]*A[j][k];
+            A[i][j] = s / A[j][j];
+        }
+    }
+    for(int i=0; i<6; i++)      // 前進代入
+    {
+        for(int k=0; k<i; k++) b[i] -= A[i][k]*b[k];
+        b[i] /= A[i][i];
+    }
+    for(int i=5; i>=0; i--)     // 後退代入
+    {
+        for(int k=i+1; k<6; k++) b[i] -= A[k][i]*b[k];
+        b[i] /= A[i][i];
+    }
+    return true;
+}
+
+/**
+ * @brief 直列リンクの幾何ヤコビ行列
+ * @details 回転関節の列iは回転軸w_iと、手先位置に対する並進成分v_i = w_i x (p_end - p_i)。
+ *          直動関節の列iは並進成分v_i = 直動軸、回転成分w_i = 0。
+ */
+template <typename T>
+class jacobian
+{
+    public:
+        std::vector<vec3<T>> alfa;  ///< 関節軸（リンク座標系）
+        std::vector<JOINT_TYPE> type; ///< 関節種別
+        std::vector<vec3<T>> v;     ///< 並進成分（基準座標系）
+        std::vector<vec3<T>> w;     ///< 回転成分（基準座標系）
+
+        /**
+         * @brief 回転軸を指定して生成（以降の演算で確保は発生しない）
+         */
+        jacobian(std::vector<vec3<T>> alfa_ = alfaB())
+        {
+            assert(alfa_.size()>0);
+            this->alfa = alfa_;
+            this->type.assign(alfa_.size(), REVOLUTE);
+            this->v.resize(alfa_.size());
+            this->w.resize(alfa_.size());
+        }
+
+        /**
+         * @brief ロボットモデルから生成
+         */
+        template <int N>
+        jacobian(const robot_model<T,N>& rm)
+        {
+            this->alfa.assign(rm.alfa.begin(), rm.alfa.end());
+            this->type.assign(rm.type.begin(), rm.type.end());
+            this->v.resize(N);
+            this->w.resize(N);
+        }
+
+        /**
+         * @brief 軸数
+         */
+        int size() const
+        {
+            return this->alfa.size();
+        }
+
+        /**
+         * @brief 計算済みFK座標系からヤコビ行列を更新
+         * @param [in] pa 座標系配列(to_pose_array, pose_array::pa) 要素数は軸数+1以上
+         * @note 関節iの回転軸はpa[i+1]原点を通る。末尾要素を手先とする
+         */
+        template <typename C>
+        void operator()(const C& pa)
+        {
+            (*this)(pa, pa.back().p);
+        }
+
+        /**
+         * @brief 計算済みFK座標系と手先位置からヤコビ行列を更新
+         * @param [in] pa 座標系配列 要素数は軸数+1以上
+         * @param [in] pe 手先位置（ツール先端など、基準座標系）
+         */
+        template <typename C>
+        void operator()(const C& pa, const vec3<T>& pe)
+        {
+            int n = this->size();
+            assert(pa.size() > n);
+            for(int i=0; i<n; i++)
+            {
+                vec4<T> q = pa[i+1].q;
+                vec3<T> axis = q.Trans(this->alfa[i], false);
+                if(this->type[i]==PRISMATIC)
+                {
+                    this->v[i] = axis;
+                    this->w[i] = vec3<T>();
+                }
+                else
+                {
+                    this->w[i] = axis;
+                    this->v[i] = axis % (pe - pa[i+1].p);
+                }
+            }
+        }
+
+        /**
+         * @brief 関節速度から手先ツイスト
+         */
+        twist<T> operator*(const T qd[]) const
+        {
+            twist<T> ret;
+            for(int i=0; i<this->size(); i++)
+            {
+                ret.v = ret.v + this->v[i]*qd[i];
+                ret.w = ret.w + this->w[i]*qd[i];
+            }
+            return ret;
+        }
+
+        /**
+         * @brief J*W*J^T（Wは対角重み、nullptrで単位行列）
+         */
+        void JWJt(T A[6][6], const T wgt[]=nullptr) const
+        {
+            for(int r=0; r<6; r++)
+                for(int c=0; c<6; c++) A[r][c] = 0;
+
+            for(int i=0; i<this->size(); i++)
+            {
+                T col[6] = {v[i].x, v[i].y, v[i].z, w[i].x, w[i].y, w[i].z};
+                T k = wgt ? wgt[i] : 1;
+                for(int r=0; r<6; r++)
+                    for(int c=0; c<=r; c++) A[r][c] += k*col[r]*col[c];
+            }
+            for(int r=0; r<6; r++)
+                for(int c=r+1; c<6; c++) A[r][c] = A[c][r];
+        }
+
+        /**
+         * @brief 減衰最小二乗解 qd = W*J^T*(J*W*J^T + lambda^2*I)^-1 * e
+         * @param [in] e 手先ツイスト（または姿勢偏差）
+         * @param [in] lambda 減衰係数
+         * @param [out] qd 関節速度（軸数分）
+         * @param [in] wgt 関節重み（大きいほど動きやすい、nullptrで均等）
+         * @retval false 分解失敗（qdは0）
+         */
+        bool dls(twist<T> e, T lambda, T qd[], const T wgt[]=nullptr) const
+        {
+            T A[6][6];
+            this->JWJt(A, wgt);
+            for(int r=0; r<6; r++) A[r][r] += lambda*lambda;
+
+            T y[6] = {e.v.x, e.v.y, e.v.z, e.w.x, e.w.y, e.w.z};
+            bool ok = chol6(A, y);
+            for(int i=0; i<this->size(); i++)
+            {
+                T k = wgt ? wgt[i] : 1;
+                qd[i] = ok ? k*(this->v[i].x*y[0] + this->v[i].y*y[1] + this->v[i].z*y[2]
+                              + this->w[i].x*y[3] + this->w[i].y*y[4] + this->w[i].z*y[5]) : 0;
+            }
+            return ok;
+        }
+
+        /**
+         * @brief 可操作度 sqrt(det(J*J^T))
+         * @details J*J^Tのコレスキー分解の対角要素の積（6軸未満など特異では0）
+         */
+        T manipulability() const
+        {
+            T A[6][6], b[6] = {0, 0, 0, 0, 0, 0};
+            this->JWJt(A);
+            if(!chol6(A, b)) return 0;
+            T ret = 1;
+            for(int r=0; r<6; r++) ret *= A[r][r];
+            return ret;
+        }
+};
+
+}
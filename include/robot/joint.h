@@ -5,19 +5,42 @@
 #pragma once
 #include <kinematics/kinematics.h>
 #include <initializer_list>
-#define Naxis (6)
+#define Naxis (6)   ///< 標準アームの軸数（jointの既定軸数）
 
 namespace kinematics
 {
+/**
+ * @brief 軸番号0～N-1の展開ループ
+ * @details unroll<0,N>::run(f)でf(0)～f(N-1)をコンパイル時に展開して呼ぶ
+ */
+template <int I, int N>
+struct unroll
+{
+    template <typename F>
+    static void run(F& f)
+    {
+        f(I);
+        unroll<I+1, N>::run(f);
+    }
+};
+
+template <int N>
+struct unroll<N, N>
+{
+    template <typename F>
+    static void run(F&){}
+};
+
 /**
  * @brief ジョイント関節クラス
+ * @tparam N 軸数
  */
-template <typename T>
+template <typename T, int N=Naxis>
 class joint
 {
     public:
         T err = 1e-9;
-        std::array<T, Naxis> val;
+        std::array<T, N> val;
 
         joint()
         {
@@ -26,6 +49,7 @@ class joint
 
         joint(std::initializer_list<T> _val)
         {
+            val.fill(0);
             auto ite = _val.begin();
             for(auto &x : val)
             {
@@ -38,7 +62,7 @@ class joint
          * @brief 代入
          */
         template<typename U>
-        joint<T> operator=(const joint<U>& obj)
+        joint<T,N> operator=(const joint<U,N>& obj)
         {
             this->val = obj.val;
             return(*this);
@@ -49,19 +73,19 @@ class joint
          */
         T& operator[](int n)
         {
-            n = (n>=0) ? (n) : (this->val.size()+n);           
-            assert(0<=n && n<this->val.size());
+            n = (n>=0) ? (n) : (N+n);           
+            assert(0<=n && n<N);
             return val[n];
         }
 
-        joint<T> operator+()
+        joint<T,N> operator+()
         {
         	return(*this);
         }
 
-        joint<T> operator-()
+        joint<T,N> operator-()
         {
-            joint<T> ret = (*this);
+            joint<T,N> ret = (*this);
             for (T &v : ret.val) v = -v;
         	return(ret);
         }
@@ -70,9 +94,9 @@ class joint
          * @brief 各要素の一致判定（数値誤差をerrだけ許容）
          */
         template<typename U>
-        bool operator==(const joint<U>& obj)
+        bool operator==(const joint<U,N>& obj)
         {
-            for(int i=0; i<this->val.size(); i++)
+            for(int i=0; i<N; i++)
             {
                 if( std::abs(this->val[i]-obj.val[i]) > this->err)
                     return false;
@@ -80,34 +104,34 @@ class joint
             return true;
         }
 
-        joint<T> operator+(const joint<T>& obj)
+        joint<T,N> operator+(const joint<T,N>& obj)
         {
-            joint<T> ret = (*this);
-            for(int i=0; i<this->val.size(); i++)
+            joint<T,N> ret = (*this);
+            for(int i=0; i<N; i++)
                 ret.val[i] = ret.val[i] + obj.val[i];
             return(ret);
         }
 
-        joint<T> operator-(const joint<T>& obj)
+        joint<T,N> operator-(const joint<T,N>& obj)
         {
-            joint<T> ret = (*this);
-            for(int i=0; i<this->val.size(); i++)
+            joint<T,N> ret = (*this);
+            for(int i=0; i<N; i++)
                 ret.val[i] = ret.val[i] - obj.val[i];
             return(ret);
         }
 
-        joint<T> operator*(const joint<T>& obj)
+        joint<T,N> operator*(const joint<T,N>& obj)
         {
-            joint<T> ret = (*this);
-            for(int i=0; i<this->val.size(); i++)
+            joint<T,N> ret = (*this);
+            for(int i=0; i<N; i++)
                 ret.val[i] = ret.val[i] * obj.val[i];
             return(ret);
         }
 
-        joint<T> operator/(const joint<T>& obj)
+        joint<T,N> operator/(const joint<T,N>& obj)
         {
-            joint<T> ret = (*this);
-            for(int i=0; i<this->val.size(); i++)
+            joint<T,N> ret = (*this);
+            for(int i=0; i<N; i++)
                 ret.val[i] = ret.val[i] / obj.val[i];
             return(ret);
         }
@@ -150,9 +174,9 @@ class joint
         /**
          * @brief 要素毎の符号関数
          */
-        joint<T> sign()
+        joint<T,N> sign()
         {
-            joint<T> ret = (*this);
+            joint<T,N> ret = (*this);
             for(T &x : ret.val)
             {
                 if(std::abs(x)>err)
@@ -166,9 +190,9 @@ class joint
         /**
          * @brief 要素毎の絶対値関数
          */
-        joint<T> abs()
+        joint<T,N> abs()
         {
-            joint<T> ret = (*this);
+            joint<T,N> ret = (*this);
             for(T &x : ret.val)
             {
                 if(x<0) x = -x;
@@ -179,109 +203,112 @@ class joint
         /**
          * @brief 飽和関数
          * @param [out] out_of_range 制約外判定
+         * @note NaNの軸は飽和せずNaNのまま返し、制約外とする
          */
-        joint<T> sat(const joint<T> _min, const joint<T> _max, joint<T> *out_of_range=nullptr)
+        joint<T,N> sat(const joint<T,N>& _min, const joint<T,N>& _max, joint<T,N> *out_of_range=nullptr)
         {
             if(out_of_range) out_of_range->val.fill(1);   // 制約範囲外で初期化
 
-            joint<T> ret = (*this);
-            for(int i=0; i<this->val.size(); i++)
+            joint<T,N> ret = (*this);
+            for(int i=0; i<N; i++)
             {
                 assert(_min.val[i]<=_max.val[i]);
 
                 if     (ret.val[i] < _min.val[i]){ ret.val[i] = _min.val[i]; }
                 else if(ret.val[i] > _max.val[i]){ ret.val[i] = _max.val[i]; }
-                else if(out_of_range) { out_of_range->val[i] = 0; }
+                else if(out_of_range && ret.val[i]==ret.val[i]) { out_of_range->val[i] = 0; }
             }
             return ret;
         }
 
         /**
-         * @brief 制約内判定
+         * @brief 制約内判定（NaNは制約外）
          */
-        bool in_range(const joint<T> _min, const joint<T> _max)
+        bool in_range(const joint<T,N>& _min, const joint<T,N>& _max)
         {
-            for(int i=0; i<this->val.size(); i++)
+            for(int i=0; i<N; i++)
             {
                 assert(_min.val[i]<=_max.val[i]);
-                if(this->val[i] < _min.val[i]){ return false; }
-                if(this->val[i] > _max.val[i]){ return false; }
+                if(!(this->val[i] >= _min.val[i] && this->val[i] <= _max.val[i])){ return false; }
             }
             return true;
         }
 
 };
 
-template <typename T>
-std::ostream& operator<<(std::ostream& stream, const joint<T>& obj)
+template <typename T, int N>
+std::ostream& operator<<(std::ostream& stream, const joint<T,N>& obj)
 {
-    char cData[512];
-    joint<T> tmp = obj;
-    sprintf(cData,"[%+5.2f, %+5.2f, %+5.2f, %+5.2f, %+5.2f, %+5.2f]",
-                    tmp[0], tmp[1], tmp[2], tmp[3], tmp[4], tmp[5]);
-    return( stream << cData);
+    char cData[32];
+    stream << "[";
+    for(int i=0; i<N; i++)
+    {
+        sprintf(cData, (i==0) ? "%+5.2f" : ", %+5.2f", (double)obj.val[i]);
+        stream << cData;
+    }
+    return( stream << "]");
 }
 
-template <typename T, typename U>
-joint<T> operator+(const joint<T>& obj, U k)
+template <typename T, int N, typename U>
+joint<T,N> operator+(const joint<T,N>& obj, U k)
 {
-    joint<T> ret = obj;
+    joint<T,N> ret = obj;
     for(auto &x : ret.val) x = x + k;
     return ret;
 }
 
-template <typename T, typename U>
-joint<T> operator+(U k, const joint<T>& obj)
+template <typename T, int N, typename U>
+joint<T,N> operator+(U k, const joint<T,N>& obj)
 {
-    joint<T> ret = obj;
+    joint<T,N> ret = obj;
     for(auto &x : ret.val) x = k + x;
     return ret;
 }
 
-template <typename T, typename U>
-joint<T> operator-(const joint<T>& obj, U k)
+template <typename T, int N, typename U>
+joint<T,N> operator-(const joint<T,N>& obj, U k)
 {
-    joint<T> ret = obj;
+    joint<T,N> ret = obj;
     for(auto &x : ret.val) x = x - k;
     return ret;
 }
 
-template <typename T, typename U>
-joint<T> operator-(U k, const joint<T>& obj)
+template <typename T, int N, typename U>
+joint<T,N> operator-(U k, const joint<T,N>& obj)
 {
-    joint<T> ret = obj;
+    joint<T,N> ret = obj;
     for(auto &x : ret.val) x = k - x;
     return ret;
 }
 
-template <typename T, typename U>
-joint<T> operator*(const joint<T>& obj, U k)
+template <typename T, int N, typename U>
+joint<T,N> operator*(const joint<T,N>& obj, U k)
 {
-    joint<T> ret = obj;
+    joint<T,N> ret = obj;
     for(auto &x : ret.val) x = x * k;
     return ret;
 }
 
-template <typename T, typename U>
-joint<T> operator*(U k, const joint<T>& obj)
+template <typename T, int N, typename U>
+joint<T,N> operator*(U k, const joint<T,N>& obj)
 {
-    joint<T> ret = obj;
+    joint<T,N> ret = obj;
     for(auto &x : ret.val) x = k * x;
     return ret;
 }
 
-template <typename T, typename U>
-joint<T> operator/(const joint<T>& obj, U k)
+template <typename T, int N, typename U>
+joint<T,N> operator/(const joint<T,N>& obj, U k)
 {
-    joint<T> ret = obj;
+    joint<T,N> ret = obj;
     for(auto &x : ret.val) x = x / k;
     return ret;
 }
 
-template <typename T, typename U>
-joint<T> operator/(U k, const joint<T>& obj)
+template <typename T, int N, typename U>
+joint<T,N> operator/(U k, const joint<T,N>& obj)
 {
-    joint<T> ret = obj;
+    joint<T,N> ret = obj;
     for(auto &x : ret.val) x = k / x;
     return ret;
 }
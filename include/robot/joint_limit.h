@@ -0,0 +1,185 @@
+/**
+ * @file joint_limit.h
+ * @brief 関節制約テーブル
+ */
+#pragma once
+#include <robot/joint.h>
+
+namespace kinematics
+{
+
+/**
+ * @brief 関節制約テーブル（角度・速度・加速度・トルク）
+ * @details 判定結果は制約外の軸をビットで表したマスク（bit i = 軸i）。NaNは制約外とする。
+ *          一括処理は軸毎の配列(SoA)を入力とし、要素方向のループは分岐を含まない。
+ * @tparam N 軸数
+ */
+template <typename T, int N=Naxis>
+class joint_limit
+{
+    public:
+        joint<T,N> qmin;    ///< 角度下限[rad]
+        joint<T,N> qmax;    ///< 角度上限[rad]
+        joint<T,N> vmax;    ///< 速度上限[rad/s]（下限は-vmax）
+        joint<T,N> amax;    ///< 加速度上限[rad/s^2]（下限は-amax）
+        joint<T,N> tmax;    ///< トルク上限[Nm]（下限は-tmax）
+
+        /**
+         * @brief 生成（制約なし）
+         */
+        joint_limit()
+        {
+            static_assert(N<=32, "mask holds up to 32 axes");
+            this->qmin.val.fill(-INFINITY);
+            this->qmax.val.fill(INFINITY);
+            this->vmax.val.fill(INFINITY);
+            this->amax.val.fill(INFINITY);
+            this->tmax.val.fill(INFINITY);
+        }
+
+        /**
+         * @brief 生成
+         * @param [in] qmin_ 角度下限[rad]
+         * @param [in] qmax_ 角度上限[rad]
+         * @param [in] vmax_ 速度上限[rad/s]
+         * @param [in] amax_ 加速度上限[rad/s^2]
+         * @param [in] tmax_ トルク上限[Nm]
+         */
+        joint_limit(const joint<T,N>& qmin_, const joint<T,N>& qmax_,
+                    const joint<T,N>& vmax_=joint<T,N>()+INFINITY, const joint<T,N>& amax_=joint<T,N>()+INFINITY,
+                    const joint<T,N>& tmax_=joint<T,N>()+INFINITY)
+        {
+            static_assert(N<=32, "mask holds up to 32 axes");
+            this->qmin = qmin_;
+            this->qmax = qmax_;
+            this->vmax = vmax_;
+            this->amax = amax_;
+            this->tmax = tmax_;
+            for(int i=0; i<N; i++)
+                assert(qmin.val[i]<=qmax.val[i] && vmax.val[i]>=0 && amax.val[i]>=0 && tmax.val[i]>=0);
+        }
+
+        /**
+         * @brief 範囲判定マスク
+         */
+        static unsigned int mask(const joint<T,N>& x, const joint<T,N>& lo, const joint<T,N>& hi)
+        {
+            unsigned int ret = 0;
+            for(int i=0; i<N; i++)
+                ret |= (unsigned int)!((x.val[i] >= lo.val[i]) & (x.val[i] <= hi.val[i])) << i;
+            return ret;
+        }
+
+        /**
+         * @brief 角度制約判定
+         * @return 制約外の軸マスク（0で制約内）
+         */
+        unsigned int check(const joint<T,N>& q) const
+        {
+            return mask(q, this->qmin, this->qmax);
+        }
+
+        /**
+         * @brief 角度・速度・加速度制約判定
+         * @return 制約外の軸マスク（いずれかの制約外）
+         */
+        unsigned int check(const joint<T,N>& q, const joint<T,N>& v, const joint<T,N>& a) const
+        {
+            joint<T,N> vmin = -joint<T,N>(this->vmax);
+            joint<T,N> amin = -joint<T,N>(this->amax);
+            return mask(q, this->qmin, this->qmax) | mask(v, vmin, this->vmax) | mask(a, amin, this->amax);
+        }
+
+        /**
+         * @brief 角度制約の一括判定
+         * @param [in] q 軸毎の角度配列 q[軸][要素]
+         * @param [in] num 要素数
+         * @param [out] out 要素毎の制約外軸マスク
+         */
+        void check(const T* const q[], int num, unsigned int out[]) const
+        {
+            batch(q, num, out, &this->qmin.val[0], &this->qmax.val[0], nullptr, false);
+        }
+
+        /**
+         * @brief 速度制約の一括判定（判定結果をoutに論理和）
+         */
+        void check_vel(const T* const v[], int num, unsigned int out[]) const
+        {
+            batch(v, num, out, nullptr, &this->vmax.val[0], nullptr, true);
+        }
+
+        /**
+         * @brief 加速度制約の一括判定（判定結果をoutに論理和）
+         */
+        void check_acc(const T* const a[], int num, unsigned int out[]) const
+        {
+            batch(a, num, out, nullptr, &this->amax.val[0], nullptr, true);
+        }
+
+        /**
+         * @brief トルク制約の一括判定（判定結果をoutに論理和）
+         */
+        void check_tau(const T* const tau[], int num, unsigned int out[]) const
+        {
+            batch(tau, num, out, nullptr, &this->tmax.val[0], nullptr, true);
+        }
+
+        /**
+         * @brief 角度の一括飽和
+         * @param [in,out] q 軸毎の角度配列 q[軸][要素]
+         * @param [in] num 要素数
+         * @param [out] out 要素毎の飽和した軸マスク（nullptrで省略）
+         * @note NaNは飽和せずNaNのまま残し、outでは制約外とする（失敗した解を制約内の値に見せない）
+         */
+        void sat(T* const q[], int num, unsigned int out[]=nullptr) const
+        {
+            if(out) batch(q, num, out, &this->qmin.val[0], &this->qmax.val[0], nullptr, false);
+            batch(q, num, nullptr, &this->qmin.val[0], &this->qmax.val[0], q, false);
+        }
+
+        /**
+         * @brief 速度の一括飽和
+         */
+        void sat_vel(T* const v[], int num, unsigned int out[]=nullptr) const
+        {
+            if(out) batch(v, num, out, nullptr, &this->vmax.val[0], nullptr, false);
+            batch(v, num, nullptr, nullptr, &this->vmax.val[0], v, false);
+        }
+
+    private:
+        /**
+         * @brief 一括判定・飽和
+         * @param [in] x 軸毎の入力配列
+         * @param [out] out 軸マスク（nullptrで判定しない）
+         * @param [in] lo 下限（nullptrで-hi）
+         * @param [in] hi 上限
+         * @param [out] y 飽和結果（nullptrで飽和しない）
+         * @param [in] accumulate trueでoutに論理和
+         */
+        static void batch(const T* const x[], int num, unsigned int out[], const T lo[], const T hi[], T* const y[], bool accumulate)
+        {
+            if(out && !accumulate)
+                for(int k=0; k<num; k++) out[k] = 0;
+
+            for(int i=0; i<N; i++)
+            {
+                const T *xi = x[i];
+                const T l = lo ? lo[i] : -hi[i];
+                const T h = hi[i];
+                if(out)
+                {
+                    for(int k=0; k<num; k++)
+                        out[k] |= (unsigned int)!((xi[k] >= l) & (xi[k] <= h)) << i;
+                }
+                if(y)
+                {
+                    T *yi = y[i];
+                    for(int k=0; k<num; k++)      // NaNはmax/minの第1引数として通過する
+                        yi[k] = std::min(std::max(xi[k], l), h);
+                }
+            }
+        }
+};
+
+}
@@ -0,0 +1,210 @@
+/**
+ * @file kdtree.h
+ * @brief 関節空間の逐次挿入k-d木（最近傍探索）
+ */
+#pragma once
+#include <robot/joint.h>
+#include <vector>
+#include <algorithm>
+
+namespace kinematics
+{
+
+/**
+ * @brief 関節空間のk-d木
+ * @details 点を挿入順に連続配列へ保持し（番号は挿入順）、分割軸は深さ毎に巡回する。
+ *          逐次挿入は葉への追加のみで、点数が2倍になる毎に中央値分割で木を
+ *          再構築して偏り（直線上に連続して追加される点など）を解消する（償却O(log n)）。
+ *          距離はユークリッド距離。
+ * @tparam N 軸数
+ */
+template <typename T, int N=Naxis>
+class kd_tree
+{
+    public:
+        /**
+         * @brief 全削除
+         */
+        void clear()
+        {
+            this->nodes.clear();
+            this->next_rebuild = 64;
+        }
+
+        /**
+         * @brief 点数
+         */
+        int size() const
+        {
+            return this->nodes.size();
+        }
+
+        /**
+         * @brief 点の参照
+         */
+        const joint<T,N>& operator[](int i) const
+        {
+            return this->nodes[i].q;
+        }
+
+        /**
+         * @brief 点の挿入
+         * @return 点の番号
+         */
+        int insert(const joint<T,N>& q)
+        {
+            int id = this->nodes.size();
+            node nd;
+            nd.q = q;
+            nd.child[0] = nd.child[1] = -1;
+            if(id==0)
+            {
+                nd.axis = 0;
+                this->root = 0;
+                this->nodes.push_back(nd);
+                return id;
+            }
+            int i = this->root;
+            while(true)
+            {
+                node& p = this->nodes[i];
+                int side = (q.val[p.axis] < p.q.val[p.axis]) ? 0 : 1;
+                if(p.child[side]<0)
+                {
+                    p.child[side] = id;
+                    nd.axis = (p.axis+1)%N;
+                    break;
+                }
+                i = p.child[side];
+            }
+            this->nodes.push_back(nd);
+            if(this->size() >= this->next_rebuild)
+            {
+                this->rebuild();
+                this->next_rebuild *= 2;
+            }
+            return id;
+        }
+
+        /**
+         * @brief 中央値分割による再構築（点の番号は変わらない）
+         */
+        void rebuild()
+        {
+            int n = this->nodes.size();
+            if(n==0) return;
+            std::vector<int> idx(n);
+            for(int i=0; i<n; i++) idx[i] = i;
+            this->root = this->build(idx, 0, n, 0);
+        }
+
+        /**
+         * @brief 最近傍探索
+         * @param [in] q 問い合わせ点
+         * @param [out] d2 二乗距離（nullptrで省略）
+         * @return 最近傍の番号 空で-1
+         */
+        int nearest(const joint<T,N>& q, T *d2=nullptr) const
+        {
+            if(this->nodes.empty()) return -1;
+            int best = -1;
+            T bd = INFINITY;
+            std::vector<std::pair<int,T>> st;     // 節点と下界
+            st.reserve(64);
+            st.push_back(std::make_pair(this->root, (T)0));
+            while(!st.empty())
+            {
+                int i = st.back().first;
+                T l = st.back().second;
+                st.pop_back();
+                if(l >= bd) continue;
+                const node& nd = this->nodes[i];
+                T d = dist2(nd.q, q);
+                if(d < bd)
+                {
+                    bd = d;
+                    best = i;
+                }
+                T diff = q.val[nd.axis] - nd.q.val[nd.axis];
+                int near = (diff < 0) ? 0 : 1;
+                // 遠い側を先に積み、近い側を先に調べる
+                if(nd.child[1-near]>=0) st.push_back(std::make_pair(nd.child[1-near], std::max(l, diff*diff)));
+                if(nd.child[near]>=0)   st.push_back(std::make_pair(nd.child[near], l));
+            }
+            if(d2) *d2 = bd;
+            return best;
+        }
+
+        /**
+         * @brief 半径内の点
+         * @param [in] q 問い合わせ点
+         * @param [in] r 半径
+         * @param [out] out 点の番号（追加）
+         */
+        void radius(const joint<T,N>& q, T r, std::vector<int>& out) const
+        {
+            if(this->nodes.empty()) return;
+            T r2 = r*r;
+            std::vector<int> st;
+            st.reserve(64);
+            st.push_back(this->root);
+            while(!st.empty())
+            {
+                int i = st.back();
+                st.pop_back();
+                const node& nd = this->nodes[i];
+                if(dist2(nd.q, q) <= r2) out.push_back(i);
+                T diff = q.val[nd.axis] - nd.q.val[nd.axis];
+                if(nd.child[0]>=0 && diff <= r)  st.push_back(nd.child[0]);
+                if(nd.child[1]>=0 && diff >= -r) st.push_back(nd.child[1]);
+            }
+        }
+
+        /**
+         * @brief ユークリッド距離の2乗
+         */
+        static T dist2(const joint<T,N>& a, const joint<T,N>& b)
+        {
+            T ret = 0;
+            for(int i=0; i<N; i++)
+            {
+                T d = a.val[i] - b.val[i];
+                ret += d*d;
+            }
+            return ret;
+        }
+
+    private:
+        struct node
+        {
+            joint<T,N> q;   ///< 点
+            int child[2];   ///< 子（分割軸の値が小さい側・大きい側）
+            int axis;       ///< 分割軸
+        };
+        std::vector<node> nodes;    ///< 節点（挿入順）
+        int root = 0;               ///< 根の番号
+        int next_rebuild = 64;      ///< 次に再構築する点数
+
+        /**
+         * @brief 範囲[b,e)の中央値分割
+         * @return 部分木の根
+         */
+        int build(std::vector<int>& idx, int b, int e, int depth)
+        {
+            if(b>=e) return -1;
+            int axis = depth%N;
+            int m = (b+e)/2;
+            std::nth_element(idx.begin()+b, idx.begin()+m, idx.begin()+e,
+                [&](int i, int j){ return this->nodes[i].q.val[axis] < this->nodes[j].q.val[axis]; });
+            node& nd = this->nodes[idx[m]];
+            nd.axis = axis;
+            int id = idx[m];
+            int l = this->build(idx, b, m, depth+1);
+            int r = this->build(idx, m+1, e, depth+1);
+            this->nodes[id].child[0] = l;
+            this->nodes[id].child[1] = r;
+            return id;
+        }
+};
+
+}
@@ -0,0 +1,205 @@
+/**
+ * @file mapped_file.h
+ * @brief ヘッダ付き連続配列のファイル保存とmmap読み込み
+ */
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace kinematics
+{
+
+/**
+ * @brief ファイル形式の識別（ヘッダの先頭に置く）
+ */
+struct file_tag
+{
+    char magic[4];      ///< 形式名
+    uint32_t version;   ///< 形式の版
+    uint32_t elem;      ///< 配列の要素サイズ
+
+    /**
+     * @brief 設定
+     */
+    void set(const char m[4], uint32_t ver, uint32_t size)
+    {
+        memcpy(this->magic, m, 4);
+        this->version = ver;
+        this->elem = size;
+    }
+
+    /**
+     * @brief 一致
+     */
+    bool match(const char m[4], uint32_t ver, uint32_t size) const
+    {
+        return memcmp(this->magic, m, 4)==0 && this->version==ver && this->elem==size;
+    }
+};
+
+/**
+ * @brief 構築した配列またはmmapで読み込んだ配列
+ * @details ファイルはヘッダH（先頭にfile_tag tag）の直後に要素Eの配列を置く。
+ *          読み込みはmmapで共有し、書き込む場合はwritable()で複製する。
+ */
+template <typename E>
+class mapped_array
+{
+    public:
+        mapped_array() {}
+
+        ~mapped_array()
+        {
+            this->release();
+        }
+
+        mapped_array(const mapped_array&) = delete;
+        mapped_array& operator=(const mapped_array&) = delete;
+
+        /**
+         * @brief 配列の先頭（空でnullptr）
+         */
+        const E* data() const
+        {
+            return this->ptr;
+        }
+
+        /**
+         * @brief 要素数
+         */
+        size_t size() const
+        {
+            return this->num;
+        }
+
+        /**
+         * @brief 空の判定
+         */
+        bool empty() const
+        {
+            return this->ptr==nullptr;
+        }
+
+        /**
+         * @brief mmapで読み込んだ配列か
+         */
+        bool mapped() const
+        {
+            return this->map!=nullptr;
+        }
+
+        /**
+         * @brief 書き込み可能な配列の確保
+         * @return 配列の先頭
+         */
+        E* assign(size_t n, const E& v)
+        {
+            this->release();
+            this->grid.assign(n, v);
+            this->num = n;
+            this->ptr = &this->grid[0];
+            return &this->grid[0];
+        }
+
+        /**
+         * @brief mmap領域を書き込み可能な配列へ複製
+         * @return 配列の先頭
+         */
+        E* writable()
+        {
+            if(this->map)
+            {
+                this->grid.assign(this->ptr, this->ptr + this->num);
+                munmap(this->map, this->map_size);
+                this->map = nullptr;
+                this->map_size = 0;
+                this->ptr = &this->grid[0];
+            }
+            return &this->grid[0];
+        }
+
+        /**
+         * @brief 解放
+         */
+        void release()
+        {
+            if(this->map) munmap(this->map, this->map_size);
+            this->map = nullptr;
+            this->map_size = 0;
+            this->ptr = nullptr;
+            this->num = 0;
+            this->grid.clear();
+        }
+
+        /**
+         * @brief ファイルへ保存
+         * @param [in] path ファイル
+         * @param [in] hd ヘッダ
+         * @retval false 書き込み失敗
+         */
+        template <typename H>
+        bool save(const std::string& path, const H& hd) const
+        {
+            if(!this->ptr) return false;
+            FILE *fp = fopen(path.c_str(), "wb");
+            if(!fp) return false;
+            bool ok = fwrite(&hd, sizeof(hd), 1, fp)==1 && fwrite(this->ptr, sizeof(E), this->num, fp)==this->num;
+            ok = (fclose(fp)==0) && ok;
+            return ok;
+        }
+
+        /**
+         * @brief ファイルの読み込み（mmap、読み込み専用で共有）
+         * @param [in] path ファイル
+         * @param [in] magic 形式名
+         * @param [in] version 形式の版
+         * @param [out] hd ヘッダ
+         * @param [in] count ヘッダから要素数を返す関数（0で形式不一致）
+         * @retval false 読み込み失敗・形式不一致（配列は空になる）
+         */
+        template <typename H, typename F>
+        bool load(const std::string& path, const char magic[4], uint32_t version, H& hd, F count)
+        {
+            this->release();
+            int fd = open(path.c_str(), O_RDONLY);
+            if(fd<0) return false;
+            struct stat st;
+            if(fstat(fd, &st)!=0 || st.st_size < (off_t)sizeof(H))
+            {
+                close(fd);
+                return false;
+            }
+            void *m = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+            if(m==MAP_FAILED) return false;
+
+            memcpy(&hd, m, sizeof(H));
+            size_t n = hd.tag.match(magic, version, sizeof(E)) ? count(hd) : 0;
+            if(n==0 || (size_t)st.st_size != sizeof(H) + n*sizeof(E))
+            {
+                munmap(m, st.st_size);
+                return false;
+            }
+            this->map = m;
+            this->map_size = st.st_size;
+            this->num = n;
+            this->ptr = (const E*)((const char*)m + sizeof(H));
+            return true;
+        }
+
+    private:
+        std::vector<E> grid;        ///< 構築した配列
+        const E *ptr = nullptr;     ///< 配列（gridまたはmmap領域）
+        size_t num = 0;             ///< 要素数
+        void *map = nullptr;        ///< mmap領域
+        size_t map_size = 0;        ///< mmap領域のサイズ
+};
+
+}
@@ -0,0 +1,200 @@
+/**
+ * @file numerical_ik.h
+ * @brief 任意直列リンクの数値逆運動学（Levenberg-Marquardt）
+ */
+#pragma once
+#include <robot/jacobian.h>
+#include <robot/pose_array.h>
+#include <chrono>
+
+namespace kinematics
+{
+
+/**
+ * @brief 逆運動学の結果
+ */
+enum IK_STATUS
+{
+    IK_SUCCESS = 0,     ///< 収束
+    IK_TIMEOUT,         ///< 時間切れ（最良解を出力）
+    IK_NOT_CONVERGED,   ///< 反復上限（最良解を出力）
+    IK_OUT_OF_RANGE,    ///< 角度制約外
+    IK_NO_SOLUTION,     ///< 解なし（到達不能など）
+};
+
+/**
+ * @brief 任意直列リンクの数値逆運動学クラス
+ * @details pose_arrayと同じ相対位置(pos)・回転軸(alfa)で定義したリンクに対し、
+ *          前回解からのウォームスタートでLM法（適応的な減衰最小二乗）を反復する。
+ *          作業領域は生成時に確保し、求解中に確保は発生しない。
+ */
+template <typename T>
+class numerical_ik
+{
+    public:
+        typedef std::chrono::steady_clock clock;
+
+        std::vector<vec3<T>> pos;   ///< 相対位置
+        std::vector<vec3<T>> alfa;  ///< リンク回転軸
+        pose<T> posI;               ///< ベース座標系
+        pose<T> tool;               ///< 末端リンクに対するツール座標系
+        std::vector<T> qmin;        ///< 角度下限[rad]
+        std::vector<T> qmax;        ///< 角度上限[rad]
+        std::vector<T> wgt;         ///< 関節重み（大きいほど動きやすい）
+        T tol_p = 1e-6;             ///< 位置収束判定[m]
+        T tol_r = 1e-6;             ///< 姿勢収束判定[rad]
+        T wrot = 1.0;               ///< 姿勢偏差の重み[m/rad]
+        T lambda0 = 1e-3;           ///< 減衰係数初期値
+        int max_iter = 100;         ///< 反復上限
+
+        int iter;                   ///< 直近の反復回数
+        T err;                      ///< 直近の最良偏差ノルム
+
+        /**
+         * @brief リンク構造を指定して生成
+         * @param [in] pos_ 相対位置
+         * @param [in] alfa_ リンク回転軸
+         * @param [in] posI_ ベース座標系
+         * @param [in] tool_ ツール座標系（末端リンク座標系表現）
+         */
+        numerical_ik(const std::vector<vec3<T>>& pos_, const std::vector<vec3<T>>& alfa_, pose<T> posI_=pose<T>(), pose<T> tool_=pose<T>())
+         : J(alfa_)
+        {
+            int n = pos_.size();
+            assert(n==alfa_.size() && n>0);
+            this->pos = pos_;
+            this->alfa = alfa_;
+            this->posI = posI_;
+            this->tool = tool_;
+            this->qmin.assign(n, -INFINITY);
+            this->qmax.assign(n,  INFINITY);
+            this->wgt.assign(n, 1);
+            this->q.resize(n);
+            this->dq.resize(n);
+            this->qbest.resize(n);
+            this->fk(this->pos, this->alfa, &this->q[0], this->posI);
+        }
+
+        /**
+         * @brief 軸数
+         */
+        int size() const
+        {
+            return this->pos.size();
+        }
+
+        /**
+         * @brief 角度制約の設定
+         */
+        void set_limit(const std::vector<T>& qmin_, const std::vector<T>& qmax_)
+        {
+            assert(qmin_.size()==size() && qmax_.size()==size());
+            for(int i=0; i<size(); i++) assert(qmin_[i]<=qmax_[i]);
+            std::copy(qmin_.begin(), qmin_.end(), this->qmin.begin());
+            std::copy(qmax_.begin(), qmax_.end(), this->qmax.begin());
+        }
+
+        /**
+         * @brief 順運動学（ツール座標系）
+         */
+        pose<T> forward(const T theta[])
+        {
+            this->fk(this->pos, this->alfa, theta, this->posI);
+            return this->fk.pa.back() * this->tool;
+        }
+
+        /**
+         * @brief 逆運動学（期限付き）
+         * @param [in] target 目標ツール姿勢（基準座標系）
+         * @param [in,out] theta 初期値（前回解） / 最良解
+         * @param [in] deadline 求解期限
+         * @return 求解結果
+         */
+        IK_STATUS operator()(const pose<T>& target, T theta[], clock::time_point deadline)
+        {
+            int n = size();
+            T lambda = this->lambda0;
+            for(int i=0; i<n; i++) q[i] = std::min(std::max(theta[i], qmin[i]), qmax[i]);
+
+            twist<T> e = this->error(target, &q[0]);
+            this->err = this->norm(e);
+            std::copy(q.begin(), q.end(), qbest.begin());
+
+            IK_STATUS ret = IK_NOT_CONVERGED;
+            for(this->iter=0; this->iter<this->max_iter; this->iter++)
+            {
+                if(this->converged(e)) { ret = IK_SUCCESS; break; }
+                if(clock::now() >= deadline) { ret = IK_TIMEOUT; break; }
+
+                // 最良解まわりで線形化
+                this->J(this->fk.pa, this->tcp);
+                e.w = e.w*this->wrot;
+                for(int i=0; i<n; i++) this->J.w[i] = this->J.w[i]*this->wrot;
+                this->J.dls(e, lambda, &dq[0], &wgt[0]);
+
+                for(int i=0; i<n; i++)
+                    q[i] = std::min(std::max(qbest[i]+dq[i], qmin[i]), qmax[i]);
+
+                twist<T> e1 = this->error(target, &q[0]);
+                T err1 = this->norm(e1);
+                if(err1 < this->err)
+                {
+                    // 受理して減衰を弱める
+                    std::copy(q.begin(), q.end(), qbest.begin());
+                    this->err = err1;
+                    e = e1;
+                    lambda = std::max(lambda*0.1, (T)1e-9);
+                }
+                else
+                {
+                    // 棄却して減衰を強める
+                    e = this->error(target, &qbest[0]);
+                    lambda = lambda*4.0;
+                }
+            }
+            if(ret==IK_NOT_CONVERGED && this->converged(e)) ret = IK_SUCCESS;
+
+            std::copy(qbest.begin(), qbest.end(), theta);
+            return ret;
+        }
+
+        /**
+         * @brief 逆運動学（時間予算付き）
+         * @param [in] budget 求解に使える時間[s]
+         */
+        IK_STATUS operator()(const pose<T>& target, T theta[], double budget)
+        {
+            auto deadline = clock::now() + std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(budget));
+            return (*this)(target, theta, deadline);
+        }
+
+    private:
+        pose_array<T> fk;       ///< 順運動学作業領域
+        jacobian<T> J;          ///< ヤコビ行列作業領域
+        vec3<T> tcp;            ///< ツール先端位置
+        std::vector<T> q;       ///< 試行解
+        std::vector<T> dq;      ///< 更新量
+        std::vector<T> qbest;   ///< 最良解
+
+        /**
+         * @brief 順運動学とツール姿勢偏差
+         */
+        twist<T> error(const pose<T>& target, const T theta[])
+        {
+            pose<T> end = this->forward(theta);
+            this->tcp = end.p;
+            return pose_error(target, end);
+        }
+
+        T norm(const twist<T>& e) const
+        {
+            return sqrt(e.v*e.v + this->wrot*this->wrot*(e.w*e.w));
+        }
+
+        bool converged(const twist<T>& e) const
+        {
+            return e.v.nrm()<=this->tol_p && e.w.nrm()<=this->tol_r;
+        }
+};
+
+}
@@ -0,0 +1,369 @@
+/**
+ * @file path_smoother.h
+ * @brief 関節経路の短絡・平滑化（一括有効判定）
+ */
+#pragma once
+#include <robot/spline.h>
+#include <robot/thread_pool.h>
+#include <random>
+#include <memory>
+
+namespace kinematics
+{
+
+/**
+ * @brief 関節経路の短絡・平滑化クラス
+ * @details サンプリング計画の折れ線経路を次の順で後処理する。
+ *          - 短絡: 1回に複数の候補（2点を直線で結ぶ通常の短絡と、1軸のみを区間内で
+ *            線形にする部分短絡）を生成し、全候補の判定点を1つの配列に並べて
+ *            ワーカープールで一括判定する（無効点が見つかった候補の残りは省略）。
+ *            有効な候補を短縮量の大きい順に、区間が重ならないものだけ適用する。
+ *          - 平滑化: 経由点を制御点とする一様3次Bスプライン（端点は3重で静止）を
+ *            分解能毎に評価して一括判定し、無効な区間の制御点を3重にして
+ *            折れ線（判定済み）へ近づけることを全区間が有効になるまで繰り返す。
+ *            結果は分解能毎の評価点列（判定済み）で置き換える。
+ *          判定関数はrrt_connectと同じく valid(q, worker) で、ワーカー間で並行に呼ばれる。
+ *          処理毎に判定回数・適用した短絡の数と、処理前後の経路長・所要時間の見積もりを記録する。
+ * @tparam N 軸数
+ */
+template <typename T, int N=Naxis>
+class path_smoother
+{
+    public:
+        /**
+         * @brief 状態の有効判定 valid(q, worker)
+         */
+        typedef std::function<bool(const joint<T,N>&, int)> valid_t;
+
+        valid_t valid;              ///< 有効判定（ワーカー間で並行に呼ばれる）
+        thread_pool *pool;          ///< ワーカープール（nullptrで呼び出しスレッドのみ）
+        T resolution = 0.02;        ///< 判定の分解能[rad]（軸毎の最大変化量）
+        int rounds = 30;            ///< 短絡の回数（1回あたりbatch個の候補）
+        int batch = 16;             ///< 1回の候補数
+        int patience = 3;           ///< 短絡を打ち切る連続した改善なしの回数
+        T min_gain = 0.01;          ///< 候補とする短縮量（経路長に対する比）
+        T partial = 0.5;            ///< 部分短絡の候補の割合
+        unsigned int seed = 1;      ///< 乱数の種（処理毎に進む）
+        joint<T,N> vmax;            ///< 所要時間の見積もりに使う速度上限[rad/s]
+
+        long checks = 0;            ///< 直前の処理の判定回数
+        int applied = 0;            ///< 直前の処理で適用した短絡の数
+        T length_before = 0;        ///< 直前の処理前の経路長
+        T length_after = 0;         ///< 直前の処理後の経路長
+        T time_before = 0;          ///< 直前の処理前の所要時間の見積もり（duration()）
+        T time_after = 0;           ///< 直前の処理後の所要時間の見積もり（duration()）
+
+        /**
+         * @brief 生成
+         * @param [in] valid_ 有効判定
+         * @param [in] pool_ ワーカープール
+         */
+        path_smoother(const valid_t& valid_, thread_pool *pool_=nullptr)
+        {
+            this->valid = valid_;
+            this->pool = pool_;
+            this->vmax.val.fill(1);
+        }
+
+        /**
+         * @brief 短絡と平滑化
+         * @param [in,out] path 経由点列（各区間は分解能で判定済みであること）
+         * @retval true 平滑化まで完了 false 短絡のみ（平滑化できなかった）
+         */
+        bool operator()(std::vector<joint<T,N>>& path)
+        {
+            T len = length(path), t = this->duration(path);
+            long c = 0;
+            this->shortcut(path);
+            c += this->checks;
+            bool ret = this->smooth(path);
+            this->checks += c;
+            this->length_before = len;
+            this->time_before = t;
+            return ret;
+        }
+
+        /**
+         * @brief 短絡
+         * @param [in,out] path 経由点列
+         * @return 適用した短絡の数
+         */
+        int shortcut(std::vector<joint<T,N>>& path)
+        {
+            this->checks = 0;
+            this->applied = 0;
+            this->measure(path, false);
+            std::mt19937 rng(this->seed++);
+            std::vector<candidate> cand;
+            std::vector<joint<T,N>> sample;
+            std::vector<int> owner;
+            for(int r=0, idle=0; r<this->rounds && idle<this->patience && path.size()>2; r++)
+            {
+                // 候補の生成（短縮しないものは除く）
+                cand.clear();
+                int n = path.size();
+                T gmin = std::max(this->min_gain*length(path), this->resolution*(T)1e-3);
+                std::uniform_int_distribution<int> I(0, n-1), A(0, N-1);
+                std::uniform_real_distribution<T> U(0, 1);
+                for(int k=0; k<this->batch; k++)
+                {
+                    int i = I(rng), j = I(rng);
+                    if(i>j) std::swap(i, j);
+                    if(j-i<2) continue;
+                    candidate c;
+                    c.i = i;
+                    c.j = j;
+                    if(U(rng) < this->partial) this->make_partial(path, i, j, A(rng), c.pts);
+                    else                       c.pts = {path[i], path[j]};
+                    c.gain = length(&path[i], j-i+1) - length(&c.pts[0], c.pts.size());
+                    if(c.gain > gmin) cand.push_back(c);
+                }
+                if(cand.empty())
+                {
+                    idle++;
+                    continue;
+                }
+
+                // 全候補の判定点を一括判定
+                sample.clear();
+                owner.clear();
+                for(int k=0; k<(int)cand.size(); k++)
+                    for(size_t s=0; s+1<cand[k].pts.size(); s++)
+                        this->discretize(cand[k].pts[s], cand[k].pts[s+1], k, sample, owner);
+                std::vector<char> bad = this->check(sample, owner, cand.size());
+
+                // 短縮量の大きい順に重ならないものを適用（後ろの区間から置換）
+                std::vector<int> order;
+                for(int k=0; k<(int)cand.size(); k++) if(!bad[k]) order.push_back(k);
+                std::sort(order.begin(), order.end(), [&](int a, int b){ return cand[a].gain > cand[b].gain; });
+                std::vector<int> used;
+                for(int k : order)
+                {
+                    bool overlap = false;
+                    for(int u : used)
+                        if(cand[k].i < cand[u].j && cand[u].i < cand[k].j) overlap = true;
+                    if(!overlap) used.push_back(k);
+                }
+                std::sort(used.begin(), used.end(), [&](int a, int b){ return cand[a].i > cand[b].i; });
+                for(int k : used)
+                {
+                    const candidate& c = cand[k];
+                    path.erase(path.begin()+c.i, path.begin()+c.j+1);
+                    path.insert(path.begin()+c.i, c.pts.begin(), c.pts.end());
+                }
+                this->applied += used.size();
+                idle = used.empty() ? idle+1 : 0;
+            }
+            this->measure(path, true);
+            return this->applied;
+        }
+
+        /**
+         * @brief 平滑化
+         * @param [in,out] path 経由点列（各区間は分解能で判定済みであること）
+         * @retval true 成功 false 失敗（pathは変更しない）
+         */
+        bool smooth(std::vector<joint<T,N>>& path)
+        {
+            this->checks = 0;
+            this->measure(path, false);
+            this->measure(path, true);
+            int n = path.size();
+            if(n<2) return true;
+
+            // 制御点の重複度（端点は3重で始点・終点を通り静止）
+            std::vector<int> mult(n, 1);
+            mult[0] = mult[n-1] = 3;
+            std::vector<joint<T,N>> ctrl, sample;
+            std::vector<int> wp, owner;
+            joint_spline<T,N> sp;
+            for(int it=0; it<=n; it++)
+            {
+                ctrl.clear();
+                wp.clear();
+                for(int w=0; w<n; w++)
+                    for(int m=0; m<mult[w]; m++)
+                    {
+                        ctrl.push_back(path[w]);
+                        wp.push_back(w);
+                    }
+                sp.bspline(0, 1, &ctrl[0], ctrl.size());
+
+                // 区間毎の評価点（区間の速度は制御点の差の凸結合で、移動量は差の最大値以下）
+                sample.clear();
+                owner.clear();
+                for(int s=0; s<sp.size(); s++)
+                {
+                    T dmax = 0;
+                    for(int j=0; j<N; j++)
+                        for(int k=s; k<s+3; k++) dmax = std::max(dmax, std::abs(ctrl[k+1].val[j] - ctrl[k].val[j]));
+                    int m = std::max(1, (int)ceil(dmax/this->resolution));
+                    for(int k=(s==0 ? 0 : 1); k<=m; k++)
+                    {
+                        sample.push_back(sp(s + (T)k/m));
+                        owner.push_back(s);
+                    }
+                }
+                std::vector<char> bad = this->check(sample, owner, sp.size());
+
+                // 無効な区間の中央の制御点（既に3重なら全制御点）を3重に
+                bool ok = true, changed = false;
+                for(int s=0; s<sp.size(); s++)
+                {
+                    if(!bad[s]) continue;
+                    ok = false;
+                    bool inner = (mult[wp[s+1]]<3 || mult[wp[s+2]]<3);
+                    for(int k=(inner ? s+1 : s); k<=(inner ? s+2 : s+3); k++)
+                    {
+                        if(mult[wp[k]]<3) changed = true;
+                        mult[wp[k]] = 3;
+                    }
+                }
+                if(ok)
+                {
+                    sample.front() = path.front();
+                    sample.back() = path.back();
+                    path.swap(sample);
+                    this->measure(path, true);
+                    return true;
+                }
+                if(!changed) break;     // 折れ線に一致しても無効（分解能未満の接触）
+            }
+            return false;
+        }
+
+        /**
+         * @brief 経路長（ユークリッド距離の和）
+         */
+        static T length(const joint<T,N> q[], int n)
+        {
+            T ret = 0;
+            for(int k=0; k+1<n; k++)
+            {
+                T d2 = 0;
+                for(int j=0; j<N; j++) d2 += (q[k+1].val[j] - q[k].val[j])*(q[k+1].val[j] - q[k].val[j]);
+                ret += sqrt(d2);
+            }
+            return ret;
+        }
+
+        /**
+         * @brief 経路長
+         */
+        static T length(const std::vector<joint<T,N>>& path)
+        {
+            return path.empty() ? 0 : length(&path[0], path.size());
+        }
+
+        /**
+         * @brief 所要時間の見積もり
+         * @details 区間毎に最も遅い軸が速度上限vmaxで動く時間の和（加速度は考慮しない下限）。
+         *          分解能毎の点列と折れ線を同じ尺度で比べるための指標で、
+         *          加速度制約を含む所要時間はtoppで求める。
+         */
+        T duration(const std::vector<joint<T,N>>& path) const
+        {
+            T ret = 0;
+            for(size_t k=0; k+1<path.size(); k++)
+            {
+                T t = 0;
+                for(int j=0; j<N; j++) t = std::max(t, std::abs(path[k+1].val[j] - path[k].val[j])/this->vmax.val[j]);
+                ret += t;
+            }
+            return ret;
+        }
+
+    private:
+        /**
+         * @brief 処理前後の経路長・所要時間の記録
+         */
+        void measure(const std::vector<joint<T,N>>& path, bool after)
+        {
+            (after ? this->length_after : this->length_before) = length(path);
+            (after ? this->time_after : this->time_before) = this->duration(path);
+        }
+
+        /**
+         * @brief 短絡の候補（path[i]～path[j]をptsで置換）
+         */
+        struct candidate
+        {
+            int i, j;
+            std::vector<joint<T,N>> pts;
+            T gain;
+        };
+
+        /**
+         * @brief 部分短絡（軸dのみを弦長に比例して線形に）
+         */
+        static void make_partial(const std::vector<joint<T,N>>& path, int i, int j, int d, std::vector<joint<T,N>>& out)
+        {
+            out.assign(path.begin()+i, path.begin()+j+1);
+            T total = length(&out[0], out.size()), s = 0;
+            if(total<=0) return;
+            T a = path[i].val[d], b = path[j].val[d];
+            for(size_t k=1; k+1<out.size(); k++)
+            {
+                s += length(&path[i+k-1], 2);
+                out[k].val[d] = a + (b - a)*(s/total);
+            }
+        }
+
+        /**
+         * @brief 区間の判定点（始点を除く）
+         * @details 粗い順（2分割の中点から）に並べ、無効な候補を少ない判定で打ち切る
+         */
+        void discretize(const joint<T,N>& qa, const joint<T,N>& qb, int id, std::vector<joint<T,N>>& sample, std::vector<int>& owner) const
+        {
+            T dmax = 0;
+            for(int j=0; j<N; j++) dmax = std::max(dmax, std::abs(qb.val[j] - qa.val[j]));
+            int m = std::max(1, (int)ceil(dmax/this->resolution));
+            int top = 1;
+            while(2*top <= m) top *= 2;
+            for(int st=top; st>=1; st/=2)
+            {
+                for(int k=st; k<=m; k+=2*st)
+                {
+                    joint<T,N> q;
+                    for(int j=0; j<N; j++) q.val[j] = qa.val[j] + (qb.val[j] - qa.val[j])*((T)k/m);
+                    sample.push_back(q);
+                    owner.push_back(id);
+                }
+            }
+        }
+
+        /**
+         * @brief 一括判定
+         * @param [in] sample 判定点
+         * @param [in] owner 判定点の所属
+         * @param [in] num 所属の数
+         * @return 所属毎の無効フラグ
+         */
+        std::vector<char> check(const std::vector<joint<T,N>>& sample, const std::vector<int>& owner, int num)
+        {
+            std::unique_ptr<std::atomic<char>[]> bad(new std::atomic<char>[num]);
+            for(int k=0; k<num; k++) bad[k] = 0;
+            std::atomic<long> cnt(0);
+            auto job = [&](int b, int e, int worker)
+            {
+                long c = 0;
+                for(int k=b; k<e; k++)
+                {
+                    if(bad[owner[k]].load(std::memory_order_relaxed)) continue;
+                    c++;
+                    if(!this->valid(sample[k], worker)) bad[owner[k]] = 1;
+                }
+                cnt += c;
+            };
+            int n = sample.size();
+            if(this->pool && this->pool->size()>1) this->pool->parallel_for(n, job);
+            else                                    job(0, n, 0);
+            this->checks += cnt;
+
+            std::vector<char> ret(num);
+            for(int k=0; k<num; k++) ret[k] = bad[k];
+            return ret;
+        }
+};
+
+}
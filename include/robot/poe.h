@@ -0,0 +1,124 @@
+/**
+ * @file poe.h
+ * @brief 指数積(Product of Exponentials)による順運動学
+ */
+#pragma once
+#include <robot/jacobian.h>
+#include <robot/geometry.h>
+
+namespace kinematics
+{
+
+/**
+ * @brief 指数積による順運動学クラス
+ * @details 関節0の状態でスクリュー軸（回転軸方向omega、軸上の点r）と
+ *          各リンクのホーム姿勢Mを一度だけ求めておき、
+ *          T(q) = posI * exp([S1]q1) * … * exp([SN]qN) * M を閉形式の指数で合成する。
+ *          途中の積（基準座標系での関節軸）を保持し、ヤコビ行列の生成で再利用する。
+ * @tparam N 軸数
+ */
+template <typename T, int N=Naxis>
+class poe
+{
+    public:
+        std::array<vec3<T>, N> omega;   ///< スクリュー軸方向（ホーム、ベース座標系）
+        std::array<vec3<T>, N> r;       ///< スクリュー軸上の点（ホーム、ベース座標系）
+        std::array<JOINT_TYPE, N> type; ///< 関節種別
+        std::array<pose<T>, N+1> M;     ///< リンクのホーム姿勢（ベース座標系）
+        pose<T> posI;                   ///< ベース姿勢
+
+        std::array<vec3<T>, N> w;       ///< 直近の関節軸方向（基準座標系）
+        std::array<vec3<T>, N> p;       ///< 直近の関節軸上の点（基準座標系）
+        std::array<pose<T>, N+1> P;     ///< 直近の指数積 P[i] = posI*exp(S1 q1)…exp(Si qi)
+
+        /**
+         * @brief ロボットモデルから生成
+         * @param [in] rm ロボットモデル
+         * @param [in] posI_ ベース姿勢
+         */
+        poe(const robot_model<T,N>& rm=robot_model<T,N>(), pose<T> posI_=pose<T>())
+        {
+            std::array<fpose<T>, N+1> pa = to_pose_array(rm, joint<T,N>());
+            for(int i=0; i<N; i++)
+            {
+                vec4<T> q = pa[i+1].q;
+                this->omega[i] = q.Trans(rm.alfa[i], true);
+                this->r[i] = pa[i+1].p;
+                this->type[i] = rm.type[i];
+            }
+            for(int i=0; i<=N; i++) this->M[i] = pa[i];
+            this->posI = posI_;
+            (*this)(joint<T,N>());
+        }
+
+        /**
+         * @brief 関節iの指数 exp([Si]qi)
+         */
+        pose<T> exp(int i, T qi) const
+        {
+            if(this->type[i]==PRISMATIC)
+                return pose<T>(this->omega[i]*qi, vec4<T>());
+
+            T s = sin(0.5*qi);
+            vec4<T> q(this->omega[i].x*s, this->omega[i].y*s, this->omega[i].z*s, cos(0.5*qi));
+            return pose<T>(this->r[i] - rotate(q, this->r[i]), q);
+        }
+
+        /**
+         * @brief 順運動学
+         * @param [in] jnt 関節値
+         * @return 手先姿勢（基準座標系）
+         */
+        pose<T> operator()(joint<T,N> jnt)
+        {
+            this->P[0] = this->posI;
+            auto step = [&](int i)
+            {
+                const pose<T>& A = this->P[i];
+                // 基準座標系での関節軸（ヤコビ行列用）
+                this->w[i] = rotate(A.q, this->omega[i]);
+                this->p[i] = A.p + rotate(A.q, this->r[i]);
+                // P[i+1] = P[i]*exp(Si qi)
+                pose<T> E = this->exp(i, jnt.val[i]);
+                this->P[i+1].p = A.p + rotate(A.q, E.p);
+                this->P[i+1].q = A.q * E.q;
+            };
+            unroll<0, N>::run(step);
+            return this->frame(N);
+        }
+
+        /**
+         * @brief 直近の関節値でのリンクi座標系（基準座標系）
+         * @note リンクiは関節1～iの指数積のみに依存する
+         */
+        pose<T> frame(int i) const
+        {
+            const pose<T>& A = this->P[i];
+            return pose<T>(A.p + rotate(A.q, this->M[i].p), A.q * this->M[i].q);
+        }
+
+        /**
+         * @brief 直近の関節値でのヤコビ行列（手先位置基準）
+         * @param [out] J ヤコビ行列（軸数N）
+         */
+        void jacobian_to(jacobian<T>& J) const
+        {
+            assert(J.size()==N);
+            vec3<T> pe = this->frame(N).p;
+            for(int i=0; i<N; i++)
+            {
+                if(this->type[i]==PRISMATIC)
+                {
+                    J.v[i] = this->w[i];
+                    J.w[i] = vec3<T>();
+                }
+                else
+                {
+                    J.w[i] = this->w[i];
+                    J.v[i] = this->w[i] % (pe - this->p[i]);
+                }
+            }
+        }
+};
+
+}
@@ -14,7 +14,7 @@ class pose_array
 
         pose_array(){}
 
-        pose_array(std::vector<vec3<T>> pos, std::vector<vec3<T>> alfa, T theta[], pose<T> posI=pose<T>())
+        pose_array(const std::vector<vec3<T>>& pos, const std::vector<vec3<T>>& alfa, const T theta[], pose<T> posI=pose<T>())
         {
             (*this)(pos, alfa, theta, posI);
         }
@@ -26,7 +26,7 @@ class pose_array
          * @param [in] theta 回転角
          * @param [in] posI ベース座標系
          */
-        void operator()(std::vector<vec3<T>> pos, std::vector<vec3<T>> alfa, T theta[], pose<T> posI=pose<T>())
+        void operator()(const std::vector<vec3<T>>& pos, const std::vector<vec3<T>>& alfa, const T theta[], pose<T> posI=pose<T>())
         {
             // 入力サイズ確認
             int linksize = pos.size();
@@ -0,0 +1,242 @@
+/**
+ * @file reach_shard.h
+ * @brief 到達可能性マップの分割集計（プロセス・計算機間）と統合
+ */
+#pragma once
+#include <robot/reachability.h>
+#include <cstdlib>
+#include <cerrno>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace kinematics
+{
+
+/**
+ * @brief 部分マップ統合の状態
+ */
+enum MERGE_STATUS
+{
+    MERGE_SUCCESS = 0,      ///< 統合完了
+    MERGE_READ_ERROR,       ///< 読み込み失敗（欠落・破損）
+    MERGE_GRID_MISMATCH,    ///< 格子が一致しない
+    MERGE_CONFIG_MISMATCH,  ///< 集計条件（モデル・制約・ツール・種）が一致しない
+    MERGE_OVERLAP,          ///< サンプル番号の範囲が重なる（二重集計）
+    MERGE_GAP,              ///< サンプル番号の範囲に欠けがある
+};
+
+/**
+ * @brief 分割の担当範囲
+ * @details 全サンプル[0, total)をcount個に連続区間で分け、index番目の区間を返す
+ *          （先頭の total%count 個は1個多い）。番号のみで決まるため、各分割は
+ *          他と通信せずに担当を求められ、同じ番号の再実行は同じ結果になる。
+ * @param [in] total 全サンプル数
+ * @param [in] count 分割数
+ * @param [in] index 分割番号（0～count-1）
+ * @param [out] first 担当範囲の先頭サンプル番号
+ * @param [out] num 担当サンプル数
+ */
+inline void shard_range(uint64_t total, int count, int index, uint64_t& first, uint64_t& num)
+{
+    assert(count>0 && 0<=index && index<count);
+    uint64_t base = total/count, rem = total%count;
+    first = index*base + std::min((uint64_t)index, rem);
+    num = base + ((uint64_t)index < rem ? 1 : 0);
+}
+
+/**
+ * @brief 分割の部分マップのファイル名（prefix.00003-of-00016.krmp）
+ */
+inline std::string shard_path(const std::string& prefix, int index, int count)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), ".%05d-of-%05d.krmp", index, count);
+    return prefix + buf;
+}
+
+/**
+ * @brief 1分割の集計と保存
+ * @details 担当範囲を集計し、一時ファイルへ書いてから名前を変更する（完成した部分マップのみが
+ *          見える）。同じ条件で完成済みのファイルがあれば集計を省略するため、
+ *          バッチスケジューラでの再投入や中断後の再実行はそのまま行える。
+ * @param [in] rm ロボットモデル
+ * @param [in] lim 角度制約（有限値）
+ * @param [in] region 範囲
+ * @param [in] res ボクセル間隔
+ * @param [in] bands 方向区分の帯数
+ * @param [in] total 全サンプル数
+ * @param [in] count 分割数
+ * @param [in] index 分割番号
+ * @param [in] path 出力ファイル
+ * @param [in] pool ワーカープール（nullptrで呼び出しスレッドのみ）
+ * @param [in] seed 乱数の種
+ * @param [in] tool ツール座標系
+ * @retval false 書き込み失敗
+ */
+template <typename T, int N>
+bool run_shard(const robot_model<T,N>& rm, const joint_limit<T,N>& lim, const aabb<T>& region, T res, int bands,
+               uint64_t total, int count, int index, const std::string& path,
+               thread_pool *pool=nullptr, uint64_t seed=1, const pose<T>& tool=pose<T>())
+{
+    uint64_t first, num;
+    shard_range(total, count, index, first, num);
+
+    reach_map<T> map;
+    map.resize(region, res, bands);
+    {
+        reach_map<T> done;
+        if(done.load(path) && done.same_grid(map) && done.config==reach_fingerprint(rm, lim, tool, seed)
+            && done.first==first && done.samples==num) return true;
+    }
+
+    // accumulateの1回の件数はint（部分マップはその都度統合される）
+    const uint64_t chunk = 1ULL << 26;
+    for(uint64_t k=0; k<num; k+=chunk)
+        map.accumulate(rm, lim, first + k, (int)std::min(chunk, num - k), pool, seed, tool);
+    if(num==0)
+    {
+        map.seed = seed;
+        map.first = first;
+        map.config = reach_fingerprint(rm, lim, tool, seed);
+    }
+
+    std::string tmp = path + ".tmp" + std::to_string((long)getpid());
+    if(!map.save(tmp))
+    {
+        remove(tmp.c_str());
+        return false;
+    }
+    if(rename(tmp.c_str(), path.c_str())!=0)
+    {
+        remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief 部分マップの統合
+ * @details 格子・集計条件が一致し、サンプル番号の範囲が重ならないことを確認しながら
+ *          ボクセル毎に統合する（方向区分の和・数の和・可操作度の最大値のため、
+ *          統合の順序・分割の仕方によらず一括の集計と一致する）。
+ *          部分マップは1つずつmmapで読むため、メモリは出力マップ＋1枚分で済む。
+ * @param [in] paths 部分マップのファイル
+ * @param [out] out 統合したマップ（失敗時は途中まで）
+ * @param [in] total 全サンプル数（0で欠けの確認を省略、範囲の連続性のみ確認）
+ * @param [out] bad 失敗したファイル（nullptrで省略）
+ */
+template <typename T>
+MERGE_STATUS merge_shards(const std::vector<std::string>& paths, reach_map<T>& out, uint64_t total=0, std::string *bad=nullptr)
+{
+    std::vector<std::pair<uint64_t, uint64_t>> ranges;
+    for(size_t n=0; n<paths.size(); n++)
+    {
+        reach_map<T> part;
+        MERGE_STATUS st = MERGE_SUCCESS;
+        if(!part.load(paths[n]))                st = MERGE_READ_ERROR;
+        else if(part.config==0)                 st = MERGE_CONFIG_MISMATCH;
+        else if(n==0)                           st = out.load(paths[n]) ? MERGE_SUCCESS : MERGE_READ_ERROR;
+        else if(!out.same_grid(part))           st = MERGE_GRID_MISMATCH;
+        else if(part.config!=out.config)        st = MERGE_CONFIG_MISMATCH;
+        else                                    out.merge(part);
+        if(st!=MERGE_SUCCESS)
+        {
+            if(bad) *bad = paths[n];
+            return st;
+        }
+        if(part.samples>0) ranges.push_back(std::make_pair(part.first, part.samples));
+    }
+
+    // 範囲の重なり・欠け
+    std::sort(ranges.begin(), ranges.end());
+    uint64_t end = ranges.empty() ? 0 : ranges[0].first;
+    if(total>0 && end!=0) return MERGE_GAP;
+    for(const auto& r : ranges)
+    {
+        if(r.first < end) return MERGE_OVERLAP;
+        if(r.first > end) return MERGE_GAP;
+        end = r.first + r.second;
+    }
+    if(total>0 && end!=total) return MERGE_GAP;
+    return MERGE_SUCCESS;
+}
+
+/**
+ * @brief ローカル計算機での分割集計と統合（簡易コーディネータ）
+ * @details 分割毎に子プロセスを起動し（同時procs個まで）、失敗した分割は1回だけ再実行して、
+ *          全ての部分マップを統合する。各子プロセスはrun_shardと同じ処理のため、
+ *          複数の計算機ではバッチスケジューラの配列ジョブからrun_shardを分割番号で呼び、
+ *          最後にmerge_shardsで統合すればよい。
+ * @note 子プロセスはfork()で起動し、子でメモリ確保とワーカー生成を行う。fork()は呼び出したスレッドのみを
+ *       複製するため、他のスレッド（thread_poolのワーカーなど）が動いているとロックを保持したまま
+ *       複製されて子が停止しうる。ワーカーを生成する前など、単一スレッドの状態で呼ぶこと。
+ * @param [in] prefix 部分マップのファイル名の接頭辞（shard_path）
+ * @param [in] procs 同時に実行する子プロセス数
+ * @param [in] threads 子プロセス毎のワーカー数
+ * @param [out] out 統合したマップ
+ * @retval false 子プロセスの起動・集計の失敗、統合の失敗
+ */
+template <typename T, int N>
+bool run_local(const robot_model<T,N>& rm, const joint_limit<T,N>& lim, const aabb<T>& region, T res, int bands,
+               uint64_t total, int count, const std::string& prefix, int procs, int threads, reach_map<T>& out,
+               uint64_t seed=1, const pose<T>& tool=pose<T>())
+{
+    assert(procs>0 && count>0);
+    std::vector<int> todo, tries(count, 0);
+    for(int i=count-1; i>=0; i--) todo.push_back(i);
+    std::vector<std::pair<pid_t, int>> running;
+    bool ok = true;
+    while(!todo.empty() || !running.empty())
+    {
+        while(ok && !todo.empty() && (int)running.size() < procs)
+        {
+            int index = todo.back();
+            todo.pop_back();
+            tries[index]++;
+            pid_t pid = fork();
+            if(pid<0)
+            {
+                ok = false;
+                break;
+            }
+            if(pid==0)
+            {
+                // 子プロセス（親のスレッドは複製されないため、ワーカーは子で生成）
+                thread_pool pool(threads);
+                bool r = run_shard(rm, lim, region, res, bands, total, count, index, shard_path(prefix, index, count), &pool, seed, tool);
+                _exit(r ? 0 : 1);
+            }
+            running.push_back(std::make_pair(pid, index));
+        }
+        if(running.empty()) break;
+
+        // 起動した子プロセスのみ待つ（呼び出し側の子プロセスの終了状態は取らない）
+        bool reaped = false;
+        for(size_t k=0; k<running.size(); )
+        {
+            int status;
+            pid_t pid = waitpid(running[k].first, &status, WNOHANG);
+            if(pid==0 || (pid<0 && errno==EINTR))
+            {
+                k++;
+                continue;
+            }
+            int index = running[k].second;
+            running.erase(running.begin() + k);
+            reaped = true;
+            if(pid<0 || !(WIFEXITED(status) && WEXITSTATUS(status)==0))
+            {
+                if(pid>=0 && tries[index] < 2) todo.push_back(index);
+                else                           ok = false;
+            }
+        }
+        if(!reaped) usleep(1000);
+    }
+    if(!ok) return false;
+
+    std::vector<std::string> paths;
+    for(int i=0; i<count; i++) paths.push_back(shard_path(prefix, i, count));
+    return merge_shards(paths, out, total)==MERGE_SUCCESS;
+}
+
+}
@@ -0,0 +1,433 @@
+/**
+ * @file reachability.h
+ * @brief 関節空間サンプリングによるボクセル到達可能性マップ
+ */
+#pragma once
+#include <robot/jacobian.h>
+#include <robot/joint_limit.h>
+#include <robot/geometry.h>
+#include <robot/thread_pool.h>
+#include <robot/mapped_file.h>
+
+namespace kinematics
+{
+
+/**
+ * @brief 番号から決まる[0,1)の一様乱数（カウンタ方式、splitmix64）
+ * @details サンプル番号kと軸iのみから値が決まるため、分担の仕方によらず同じ標本になる
+ * @param [in] seed 乱数の種
+ * @param [in] k サンプル番号
+ * @param [in] i 次元番号
+ */
+inline double counter_uniform(uint64_t seed, uint64_t k, int i)
+{
+    uint64_t z = seed + 0x9e3779b97f4a7c15ULL*(k*64 + i + 1);
+    z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27))*0x94d049bb133111ebULL;
+    z = z ^ (z >> 31);
+    return (z >> 11)*(1.0/9007199254740992.0);
+}
+
+/**
+ * @brief 到達可能性マップの集計条件の指紋（FNV-1a）
+ * @details ロボットモデル・角度制約・ツール・乱数の種から計算し、別々に集計した
+ *          部分マップが同じ条件の標本列か判定する（0は未設定を表すため避ける）。
+ */
+template <typename T, int N>
+uint64_t reach_fingerprint(const robot_model<T,N>& rm, const joint_limit<T,N>& lim, const pose<T>& tool, uint64_t seed)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    auto add = [&h](double x)
+    {
+        uint64_t u;
+        memcpy(&u, &x, sizeof(u));
+        for(int b=0; b<8; b++, u>>=8) h = (h ^ (u & 0xff))*0x100000001b3ULL;
+    };
+    add(N);
+    for(int i=0; i<N; i++)
+    {
+        add(rm.pos[i].x); add(rm.pos[i].y); add(rm.pos[i].z);
+        add(rm.alfa[i].x); add(rm.alfa[i].y); add(rm.alfa[i].z);
+        add(rm.type[i]);
+        add(lim.qmin.val[i]); add(lim.qmax.val[i]);
+    }
+    add(tool.p.x); add(tool.p.y); add(tool.p.z);
+    add(tool.q.x); add(tool.q.y); add(tool.q.z); add(tool.q.w);
+    add((double)(seed >> 32)); add((double)(seed & 0xffffffffULL));
+    return h ? h : 1;
+}
+
+/**
+ * @brief 到達可能性マップのボクセル
+ */
+struct reach_cell
+{
+    uint64_t mask;      ///< 到達したアプローチ方向の区分（bit b = 区分b）
+    uint32_t count;     ///< 手先が入ったサンプル数
+    float manip;        ///< 可操作度の最大値
+
+    /**
+     * @brief 統合（区分の和・数の和・可操作度の最大値、順序によらず同じ結果）
+     */
+    void merge(const reach_cell& c)
+    {
+        this->mask |= c.mask;
+        this->count += c.count;
+        this->manip = std::max(this->manip, c.manip);
+    }
+};
+static_assert(sizeof(reach_cell)==16, "reach_cell must be 16 bytes");
+
+/**
+ * @brief 到達可能性マップクラス
+ * @details 関節角を角度制約内で一様に抽出し、手先位置を格子点中心のボクセルへ、
+ *          手先z軸（アプローチ方向）を単位球の等面積区分（z方向bands帯 x 方位2*bands）へ
+ *          振り分け、ボクセル毎に到達した方向区分・サンプル数・可操作度の最大値を保持する。
+ *          到達度は到達した方向区分の割合。構築はワーカー毎の部分マップへ集計して統合する
+ *          （統合は区分の和・数の和・最大値のため分担によらず同じ結果）。
+ *          ボクセルはx最速の連続配列で、ファイルに保存したものはmmapで読み込む（検索はO(1)）。
+ */
+template <typename T>
+class reach_map
+{
+    public:
+        vec3<T> origin;     ///< ボクセル(0,0,0)の中心
+        T res = 0;          ///< ボクセル間隔
+        int nx = 0;         ///< x方向のボクセル数
+        int ny = 0;         ///< y方向のボクセル数
+        int nz = 0;         ///< z方向のボクセル数
+        int bands = 4;      ///< 方向区分のz方向の帯数（区分数は2*bands^2、64以下）
+        uint64_t samples = 0;   ///< 集計したサンプル数（範囲外を含む）
+        uint64_t seed = 0;      ///< 乱数の種（最初の集計で記録）
+        uint64_t first = 0;     ///< 集計したサンプル番号の先頭（統合では最小値）
+        uint64_t config = 0;    ///< 集計条件の指紋（0で未設定、統合で条件が異なれば0）
+
+        reach_map() {}
+
+        reach_map(const reach_map&) = delete;
+        reach_map& operator=(const reach_map&) = delete;
+
+        /**
+         * @brief 空のマップの生成
+         * @param [in] region 範囲
+         * @param [in] res_ ボクセル間隔
+         * @param [in] bands_ 方向区分の帯数（1～5）
+         */
+        void resize(const aabb<T>& region, T res_, int bands_=4)
+        {
+            assert(res_>0 && bands_>=1 && 2*bands_*bands_<=64);
+            this->res = res_;
+            this->bands = bands_;
+            this->origin = region.lo;
+            this->nx = std::max(1, (int)ceil((region.hi.x - region.lo.x)/res_) + 1);
+            this->ny = std::max(1, (int)ceil((region.hi.y - region.lo.y)/res_) + 1);
+            this->nz = std::max(1, (int)ceil((region.hi.z - region.lo.z)/res_) + 1);
+            this->cells.assign((size_t)this->nx*this->ny*this->nz, reach_cell{0, 0, 0});
+            this->samples = 0;
+            this->seed = 0;
+            this->first = 0;
+            this->config = 0;
+        }
+
+        /**
+         * @brief 構築（空のマップへ集計）
+         * @param [in] rm ロボットモデル
+         * @param [in] lim 角度制約（抽出範囲、有限値）
+         * @param [in] region 範囲
+         * @param [in] res_ ボクセル間隔
+         * @param [in] num サンプル数
+         * @param [in] pool ワーカープール（nullptrで呼び出しスレッドのみ）
+         * @param [in] seed 乱数の種
+         * @param [in] tool ツール座標系（手先座標系から見た位置・姿勢）
+         */
+        template <int N>
+        void build(const robot_model<T,N>& rm, const joint_limit<T,N>& lim, const aabb<T>& region, T res_, int num,
+                   thread_pool *pool=nullptr, uint64_t seed=1, const pose<T>& tool=pose<T>())
+        {
+            this->resize(region, res_, this->bands);
+            this->accumulate(rm, lim, 0, num, pool, seed, tool);
+        }
+
+        /**
+         * @brief サンプル番号[first, first+num)の集計
+         * @details 同じseedで番号が重ならない範囲を集計すれば、分けて集計して統合しても
+         *          一括で集計した結果と一致する。最初の集計で種・先頭番号・条件の指紋を記録し、
+         *          以降の集計で条件が異なれば指紋を0（不一致）にする。
+         */
+        template <int N>
+        void accumulate(const robot_model<T,N>& rm, const joint_limit<T,N>& lim, uint64_t first, int num,
+                        thread_pool *pool=nullptr, uint64_t seed=1, const pose<T>& tool=pose<T>())
+        {
+            assert(!this->empty());
+            reach_cell *grid = this->cells.writable();
+            for(int i=0; i<N; i++)
+                assert(std::isfinite(lim.qmin.val[i]) && std::isfinite(lim.qmax.val[i]));
+            uint64_t fp = reach_fingerprint(rm, lim, tool, seed);
+            if(this->samples==0)
+            {
+                this->seed = seed;
+                this->first = first;
+                this->config = fp;
+            }
+            else if(num>0)
+            {
+                this->first = std::min(this->first, first);
+                if(this->config!=fp) this->config = 0;
+            }
+
+            // ワーカー毎の部分マップ（最初のワーカーは本体へ直接）
+            int nw = pool ? pool->size() : 1;
+            size_t ncell = this->cells.size();
+            std::vector<std::vector<reach_cell>> part(nw-1);
+            auto job = [&](int b, int e, int worker)
+            {
+                reach_cell *out = grid;
+                if(worker>0)
+                {
+                    std::vector<reach_cell>& p = part[worker-1];
+                    if(p.empty()) p.assign(ncell, reach_cell{0, 0, 0});
+                    out = &p[0];
+                }
+                jacobian<T> jac(rm);
+                for(int k=b; k<e; k++)
+                {
+                    joint<T,N> q;
+                    for(int i=0; i<N; i++)
+                        q.val[i] = lim.qmin.val[i] + (lim.qmax.val[i] - lim.qmin.val[i])*(T)counter_uniform(seed, first+k, i);
+                    std::array<fpose<T>, N+1> pa = to_pose_array(rm, q);
+                    vec3<T> pe = transform<T>(pa[N], tool.p);
+                    int c = this->index(pe);
+                    if(c<0) continue;
+                    jac(pa, pe);
+                    reach_cell& cell = out[c];
+                    cell.mask |= 1ULL << this->bin(rotate(pa[N].q*tool.q, vec3<T>(0, 0, 1)));
+                    cell.count++;
+                    cell.manip = std::max(cell.manip, (float)jac.manipulability());
+                }
+            };
+            if(pool) pool->parallel_for(num, job);
+            else     job(0, num, 0);
+
+            // 部分マップの統合（ボクセル毎に分担）
+            auto reduce = [&](int b, int e, int)
+            {
+                for(const auto& p : part)
+                    if(!p.empty())
+                        for(int c=b; c<e; c++) grid[c].merge(p[c]);
+            };
+            if(pool) pool->parallel_for(ncell, reduce);
+            else     reduce(0, ncell, 0);
+            this->samples += num;
+        }
+
+        /**
+         * @brief 同じ格子のマップの統合
+         * @retval false 格子が一致しない
+         */
+        bool merge(const reach_map& m)
+        {
+            if(!this->same_grid(m)) return false;
+            reach_cell *grid = this->cells.writable();
+            for(size_t c=0; c<this->cells.size(); c++) grid[c].merge(m.cells.data()[c]);
+            if(this->samples==0)
+            {
+                this->seed = m.seed;
+                this->first = m.first;
+                this->config = m.config;
+            }
+            else if(m.samples>0)
+            {
+                this->first = std::min(this->first, m.first);
+                if(this->config!=m.config) this->config = 0;
+            }
+            this->samples += m.samples;
+            return true;
+        }
+
+        /**
+         * @brief 格子の一致
+         */
+        bool same_grid(const reach_map& m) const
+        {
+            return this->nx==m.nx && this->ny==m.ny && this->nz==m.nz && this->bands==m.bands
+                && this->res==m.res && this->origin.x==m.origin.x && this->origin.y==m.origin.y && this->origin.z==m.origin.z;
+        }
+
+        /**
+         * @brief 空の判定
+         */
+        bool empty() const
+        {
+            return this->cells.empty();
+        }
+
+        /**
+         * @brief mmapで読み込んだマップの判定
+         */
+        bool mapped() const
+        {
+            return this->cells.mapped();
+        }
+
+        /**
+         * @brief 方向区分数
+         */
+        int bins() const
+        {
+            return 2*this->bands*this->bands;
+        }
+
+        /**
+         * @brief 方向の区分番号（z方向の等面積帯 x 方位）
+         */
+        int bin(const vec3<T>& d) const
+        {
+            T z = std::min(std::max(d.z/d.nrm(), (T)-1), (T)1);
+            int b = std::min((int)((z + 1)*0.5*this->bands), this->bands-1);
+            int a = (int)((atan2(d.y, d.x) + M_PI)*(1/(2*M_PI))*(2*this->bands));
+            a = std::min(std::max(a, 0), 2*this->bands-1);
+            return b*2*this->bands + a;
+        }
+
+        /**
+         * @brief ボクセル番号（範囲外で-1）
+         */
+        int index(const vec3<T>& p) const
+        {
+            const T ir = 1/this->res;
+            int i = (int)floor((p.x - this->origin.x)*ir + 0.5);
+            int j = (int)floor((p.y - this->origin.y)*ir + 0.5);
+            int k = (int)floor((p.z - this->origin.z)*ir + 0.5);
+            if(i<0 || j<0 || k<0 || i>=this->nx || j>=this->ny || k>=this->nz) return -1;
+            return (k*this->ny + j)*this->nx + i;
+        }
+
+        /**
+         * @brief ボクセルの参照
+         */
+        const reach_cell& at(int i, int j, int k) const
+        {
+            return this->cells.data()[(k*this->ny + j)*this->nx + i];
+        }
+
+        /**
+         * @brief 位置のボクセル（範囲外でnullptr）
+         */
+        const reach_cell* at(const vec3<T>& p) const
+        {
+            int c = this->index(p);
+            return (c<0) ? nullptr : &this->cells.data()[c];
+        }
+
+        /**
+         * @brief 到達度（到達した方向区分の割合）
+         */
+        T score(const vec3<T>& p) const
+        {
+            const reach_cell *c = this->at(p);
+            return c ? (T)popcount(c->mask)/this->bins() : 0;
+        }
+
+        /**
+         * @brief 姿勢の到達判定（位置のボクセルで手先z軸の方向区分に到達したか）
+         */
+        bool reachable(const pose<T>& P) const
+        {
+            const reach_cell *c = this->at(P.p);
+            return c && ((c->mask >> this->bin(rotate(P.q, vec3<T>(0, 0, 1)))) & 1);
+        }
+
+        /**
+         * @brief 可操作度の最大値（範囲外・未到達で0）
+         */
+        T manipulability(const vec3<T>& p) const
+        {
+            const reach_cell *c = this->at(p);
+            return c ? c->manip : 0;
+        }
+
+        /**
+         * @brief ファイルへ保存
+         * @retval false 書き込み失敗
+         */
+        bool save(const std::string& path) const
+        {
+            header hd;
+            this->fill_header(hd);
+            return this->cells.save(path, hd);
+        }
+
+        /**
+         * @brief ファイルの読み込み（mmap、ボクセルは読み込み専用で共有）
+         * @retval false 読み込み失敗・形式不一致（マップは空になる）
+         */
+        bool load(const std::string& path)
+        {
+            header hd;
+            auto count = [](const header& h) -> size_t
+            {
+                if(h.n[0]<1 || h.n[1]<1 || h.n[2]<1 || h.bands<1 || 2*h.bands*h.bands>64) return 0;
+                return (size_t)h.n[0]*h.n[1]*h.n[2];
+            };
+            if(!this->cells.load(path, "KRMP", 1, hd, count)) return false;
+            this->nx = hd.n[0];
+            this->ny = hd.n[1];
+            this->nz = hd.n[2];
+            this->bands = hd.bands;
+            this->origin = vec3<T>(hd.origin[0], hd.origin[1], hd.origin[2]);
+            this->res = hd.res;
+            this->samples = hd.samples;
+            this->seed = hd.seed;
+            this->first = hd.first;
+            this->config = hd.config;
+            return true;
+        }
+
+    private:
+        /**
+         * @brief ファイルの先頭（ボクセルの開始を32バイト境界にする）
+         */
+        struct header
+        {
+            file_tag tag;       ///< "KRMP"・形式の版・ボクセルのサイズ
+            int32_t bands;      ///< 方向区分の帯数
+            int32_t n[3];       ///< ボクセル数
+            char pad0[4];
+            double origin[3];   ///< ボクセル(0,0,0)の中心
+            double res;         ///< ボクセル間隔
+            uint64_t samples;   ///< 集計したサンプル数
+            uint64_t seed;      ///< 乱数の種
+            uint64_t first;     ///< サンプル番号の先頭
+            uint64_t config;    ///< 集計条件の指紋（旧形式では0）
+        };
+        static_assert(sizeof(header)==96, "reach_map header must be 96 bytes");
+
+        mapped_array<reach_cell> cells;     ///< ボクセル（構築またはmmap）
+
+        static int popcount(uint64_t x)
+        {
+            int ret = 0;
+            for(; x; x &= x-1) ret++;
+            return ret;
+        }
+
+        void fill_header(header& hd) const
+        {
+            memset(&hd, 0, sizeof(hd));
+            hd.tag.set("KRMP", 1, sizeof(reach_cell));
+            hd.bands = this->bands;
+            hd.n[0] = this->nx;
+            hd.n[1] = this->ny;
+            hd.n[2] = this->nz;
+            hd.origin[0] = this->origin.x;
+            hd.origin[1] = this->origin.y;
+            hd.origin[2] = this->origin.z;
+            hd.res = this->res;
+            hd.samples = this->samples;
+            hd.seed = this->seed;
+            hd.first = this->first;
+            hd.config = this->config;
+        }
+};
+
+}
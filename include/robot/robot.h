@@ -1,5 +1,6 @@
 #pragma once
 #include <robot/joint.h>    // kinematics
+#include <robot/joint_limit.h>
 #include <robot/fpose.h>    // kinematics
 #include <robot/bit.h>
 
@@ -30,83 +31,417 @@ inline std::vector<vec3<double>> alfaB()
 }
 
 /**
- * @brief 角度制約チェック
+ * @brief 標準アームの角度下限[rad]
+ */
+inline std::vector<double> qminB()
+{
+    return std::vector<double>{-M_PI, -1.5, -1.5, -M_PI, -2.0, -M_PI};
+}
+
+/**
+ * @brief 標準アームの角度上限[rad]
+ */
+inline std::vector<double> qmaxB()
+{
+    return std::vector<double>{M_PI, 1.5, 2.5, M_PI, 2.0, M_PI};
+}
+
+/**
+ * @brief リンクの慣性パラメータ
+ * @details 座標系はリンク座標系（関節iの回転後、to_pose_arrayのpa[i+1]）。
+ *          慣性テンソルは重心まわりで、要素順は [Ixx, Iyy, Izz, Ixy, Ixz, Iyz]。
+ */
+template <typename T>
+struct link_inertia
+{
+    T m = 0;                            ///< 質量[kg]
+    vec3<T> c;                          ///< 重心位置[m]
+    std::array<T, 6> I = {{0, 0, 0, 0, 0, 0}};     ///< 重心まわりの慣性テンソル[kg m^2]
+
+    link_inertia() {}
+
+    link_inertia(T m_, const vec3<T>& c_, T Ixx, T Iyy, T Izz, T Ixy=0, T Ixz=0, T Iyz=0)
+     : m(m_), c(c_)
+    {
+        this->I = {{Ixx, Iyy, Izz, Ixy, Ixz, Iyz}};
+    }
+
+    /**
+     * @brief 重心まわりの慣性テンソルとベクトルの積
+     */
+    vec3<T> mul(const vec3<T>& w) const
+    {
+        return vec3<T>(this->I[0]*w.x + this->I[3]*w.y + this->I[4]*w.z,
+                       this->I[3]*w.x + this->I[1]*w.y + this->I[5]*w.z,
+                       this->I[4]*w.x + this->I[5]*w.y + this->I[2]*w.z);
+    }
+};
+
+/**
+ * @brief 標準アームの慣性パラメータ（リンク寸法からの概略値、実機の同定値で置き換える）
+ */
+inline std::vector<link_inertia<double>> inertiaB()
+{
+    std::vector<link_inertia<double>> in(Naxis);
+    in[0] = link_inertia<double>(4.0, vec3<double>(0, 0.030, 0), 0.015, 0.012, 0.012);
+    in[1] = link_inertia<double>(3.5, vec3<double>(0, -0.020, 0.115), 0.020, 0.020, 0.005);
+    in[2] = link_inertia<double>(2.0, vec3<double>(-0.025, -0.020, 0.036), 0.005, 0.005, 0.003);
+    in[3] = link_inertia<double>(1.8, vec3<double>(0, 0, 0.100), 0.008, 0.008, 0.002);
+    in[4] = link_inertia<double>(0.8, vec3<double>(0, 0, 0.035), 0.001, 0.001, 0.0006);
+    in[5] = link_inertia<double>(0.3, vec3<double>(0, 0, 0.020), 0.0002, 0.0002, 0.0002);
+    return in;
+}
+
+/**
+ * @brief 角度制約チェック（制約テーブル指定）
+ * @param [out] mask 制約外の軸マスク
  * @retval true 制約外
  * @retval false 制約内
  */
+template <typename T, int N>
+bool LimChk(const joint<T,N>& jnt, const joint_limit<T,N>& lim, unsigned int *mask=nullptr)
+{
+    unsigned int m = lim.check(jnt);
+    if(mask) *mask = m;
+    return m!=0;
+}
+
+/**
+ * @brief 回転数（SFLG2の回転フラグ）
+ * @details |q|<=piで0、pi<|q|<=3piで±1、…となる閉形式（分岐なし）
+ */
 template <typename T>
-bool LimChk(const joint<T> jnt)
+inline int turn_count(T q)
 {
-    return false;
+    T n = std::ceil((std::abs(q) - M_PI)/(2.0*M_PI));
+    n = std::max(n, (T)0);
+    return (q>0) ? (int)n : -(int)n;
 }
 
 /**
- * @brief フラグ生成
+ * @brief 形態フラグ(SFLG1::val)生成
+ * @param [in] j2 第2軸角度
+ * @param [in] j3 第3軸角度
+ * @param [in] j5 第5軸角度
  */
 template <typename T>
-SFLG FlgChk(joint<T> jnt)
+inline unsigned int flg1_val(T j2, T j3, T j5)
 {
+    // アーム寸法はposB()から初回のみ取得
+    static const std::vector<vec3<double>> pos = posB();
+    static const T D2  = std::abs(pos[3].x);
+    static const T D1  = std::abs(pos[2].x);
+    static const T L2  = std::abs(pos[2].x);
+    static const T L3  = std::abs(pos[3].z + pos[4].z);
+    static const T AB  = atan2(D2, L3);
+
+    T C23 = cos(j2 + j3);
+    T S23 = sin(j2 + j3);
+    T S2  = cos(j2);
+    T M41 = -D2*C23+L3*S23+L2*S2+D1;
+    unsigned int NF = (j5>=0);
+    unsigned int AB_ = (j3>=AB);
+    unsigned int RL = (M41>=0);
+    return NF | (AB_<<1) | (RL<<2);
+}
+
+/**
+ * @brief フラグ生成（全軸回転関節、Naxis軸は標準アームとして形態フラグも生成）
+ * @note 回転フラグ(SFLG2)は8軸まで、形態フラグ(SFLG1)は標準アーム(Naxis軸)のみ。
+ *       直動軸を含むモデル・標準アーム以外の6軸モデルはFlgChk(rm, jnt)を使う
+ */
+template <typename T, int N>
+SFLG FlgChk(joint<T,N> jnt)
+{
+    static_assert(N<=8, "SFLG2 holds up to 8 axes");
     SFLG ret;
     int flg[8] = {0};
-    for(int i=0; i<6; i++)
+    for(int i=0; i<N; i++)
+    {
+        flg[i] = turn_count(jnt[i]);
+        if(std::abs(flg[i]) > 4)
+        {
+            std::cerr << "[FlgChk] out of range." << std::endl;
+            assert(false);
+        }
+    }
+    ret.flg2.val = encode_flg2(flg, N);
+    if(N==Naxis) ret.flg1.val = flg1_val(jnt.val[1], jnt.val[2], jnt.val[4]);
+    return ret;
+}
+
+/**
+ * @brief フラグ一括生成（関節角SoA入力）
+ * @param [in] q 軸毎の関節角配列 q[軸][要素]
+ * @param [in] num 要素数
+ * @param [out] flg1 SFLG1::val配列
+ * @param [out] flg2 SFLG2::val配列
+ * @note 要素方向のループは分岐を含まずベクトル化可能。回転数の範囲外(|n|>4)は単体生成と同様に全要素の後で判定する
+ */
+template <int N=Naxis, typename T>
+void FlgChk(const T* const q[], int num, unsigned int flg1[], unsigned int flg2[])
+{
+    static_assert(N<=8, "SFLG2 holds up to 8 axes");
+    for(int k=0; k<num; k++) flg2[k] = 0;
+    int range = 0;
+    for(int i=0; i<N; i++)
+    {
+        const T *qi = q[i];
+        int sft = 4*i;
+        for(int k=0; k<num; k++)
+        {
+            int n = turn_count(qi[k]);
+            range = std::max(range, std::abs(n));
+            flg2[k] |= ((unsigned int)n & 0xF) << sft;
+        }
+    }
+    if(range > 4)
     {
-        T Lmin = M_PI;
-        while(abs(jnt[i]) > Lmin)
+        std::cerr << "[FlgChk] out of range." << std::endl;
+        assert(false);
+    }
+    for(int k=0; k<num; k++)
+        flg1[k] = (N==Naxis) ? flg1_val(q[1][k], q[2][k], q[4][k]) : 0;
+}
+
+/**
+ * @brief フラグ一括生成（関節配列入力）
+ */
+template <typename T, int N>
+void FlgChk(const joint<T,N> jnt[], int num, unsigned int flg1[], unsigned int flg2[])
+{
+    static_assert(N<=8, "SFLG2 holds up to 8 axes");
+    int range = 0;
+    for(int k=0; k<num; k++)
+    {
+        int flg[N];
+        for(int i=0; i<N; i++)
+        {
+            flg[i] = turn_count(jnt[k].val[i]);
+            range = std::max(range, std::abs(flg[i]));
+        }
+        flg2[k] = encode_flg2(flg, N);
+        flg1[k] = (N==Naxis) ? flg1_val(jnt[k].val[1], jnt[k].val[2], jnt[k].val[4]) : 0;
+    }
+    if(range > 4)
+    {
+        std::cerr << "[FlgChk] out of range." << std::endl;
+        assert(false);
+    }
+}
+
+/**
+ * @brief 関節種別
+ */
+enum JOINT_TYPE
+{
+    REVOLUTE = 0,   ///< 回転関節（alfa軸まわりに回転）
+    PRISMATIC,      ///< 直動関節（alfa方向に並進）
+};
+
+/**
+ * @brief N軸直列リンクのロボットモデル
+ * @details リンクiの座標系はリンクi-1座標系からpos[i]だけ移動し、関節iで
+ *          alfa[i]まわりに回転（直動関節ではalfa[i]方向に並進）した座標系。
+ *          軸数はコンパイル時定数で、順運動学は軸毎に展開される。
+ * @tparam N 軸数
+ */
+template <typename T, int N=Naxis>
+class robot_model
+{
+    public:
+        std::array<vec3<T>, N> pos;         ///< 相対位置
+        std::array<vec3<T>, N> alfa;        ///< 関節軸（単位ベクトル）
+        std::array<JOINT_TYPE, N> type;     ///< 関節種別
+        std::array<link_inertia<T>, N> inertia;     ///< リンクの慣性パラメータ（既定は質量0）
+        joint_limit<T,N> lim;               ///< 関節制約（既定は制約なし、標準アームはqminB/qmaxB）
+        vec3<T> gravity = vec3<T>(0, 0, -9.80665);  ///< 重力加速度（基準座標系）[m/s^2]
+
+        /**
+         * @brief 生成（N==Naxisでは標準アームposB/alfaB/inertiaB/qminB/qmaxB）
+         */
+        robot_model()
+        {
+            this->type.fill(REVOLUTE);
+            if(N==Naxis)
+            {
+                this->set(posB(), alfaB());
+                this->set_inertia(inertiaB());
+                this->set_limit(qminB(), qmaxB());
+            }
+        }
+
+        /**
+         * @brief リンク構造を指定して生成
+         * @param [in] pos_ 相対位置（N個）
+         * @param [in] alfa_ 関節軸（N個）
+         * @param [in] type_ 関節種別（省略時は全て回転関節）
+         */
+        template <typename U>
+        robot_model(const std::vector<vec3<U>>& pos_, const std::vector<vec3<U>>& alfa_, const std::vector<JOINT_TYPE>& type_=std::vector<JOINT_TYPE>())
         {
-            flg[i] = (jnt[i]>0) ? (flg[i]+1) : (flg[i]-1);
-            Lmin += 2.0*M_PI;
+            this->type.fill(REVOLUTE);
+            this->set(pos_, alfa_);
+            assert(type_.empty() || type_.size()==N);
+            for(int i=0; i<type_.size(); i++) this->type[i] = type_[i];
+        }
 
-            if(Lmin > 10.0*M_PI)
+        /**
+         * @brief リンク構造設定
+         */
+        template <typename U>
+        void set(const std::vector<vec3<U>>& pos_, const std::vector<vec3<U>>& alfa_)
+        {
+            assert(pos_.size()==N && alfa_.size()==N);
+            for(int i=0; i<N; i++)
             {
-                std::cerr << "[FlgChk] out of range." << std::endl;
-                assert(false);
+                this->pos[i] = pos_[i];
+                this->alfa[i] = alfa_[i];
+                this->alfa[i] = this->alfa[i] / this->alfa[i].nrm();
             }
         }
-    }
-    for(int i=0; i<6; i++)
-        ret.flg2.SET(i, flg[i]);
-
-    std::vector<vec3<double>> pos = posB();
-    T D2  = abs(pos[3].x);
-    T D1  = abs(pos[2].x);
-    T L2  = abs(pos[2].x);
-    T L3  = abs(pos[3].z + pos[4].z);
-    T C23 = cos(jnt[1] + jnt[2]);
-    T S23 = sin(jnt[1] + jnt[2]);
-    T S2  = cos(jnt[1]);
-    T M41 = -D2*C23+L3*S23+L2*S2+D1;
-    ret.flg1.bit.RL = (M41>=0) ? (1) : (0);
-    ret.flg1.bit.AB = (jnt[2]>=atan2(D2,L3)) ? (1) : (0);
-    ret.flg1.bit.NF = (jnt[4]>=0) ? (1) : (0);
 
+        /**
+         * @brief 慣性パラメータ設定
+         */
+        template <typename U>
+        void set_inertia(const std::vector<link_inertia<U>>& in)
+        {
+            assert(in.size()==N);
+            for(int i=0; i<N; i++)
+            {
+                this->inertia[i].m = in[i].m;
+                this->inertia[i].c = in[i].c;
+                for(int k=0; k<6; k++) this->inertia[i].I[k] = in[i].I[k];
+            }
+        }
+
+        /**
+         * @brief 角度制約設定
+         */
+        template <typename U>
+        void set_limit(const std::vector<U>& qmin_, const std::vector<U>& qmax_)
+        {
+            assert(qmin_.size()==N && qmax_.size()==N);
+            for(int i=0; i<N; i++)
+            {
+                assert(qmin_[i]<=qmax_[i]);
+                this->lim.qmin.val[i] = qmin_[i];
+                this->lim.qmax.val[i] = qmax_[i];
+            }
+        }
+
+        /**
+         * @brief 標準アーム(posB/alfaB、全軸回転)の判定
+         */
+        bool standard() const
+        {
+            if(N!=Naxis) return false;
+            static const std::vector<vec3<double>> p = posB(), a = alfaB();
+            for(int i=0; i<N; i++)
+            {
+                vec3<T> pb(p[i].x, p[i].y, p[i].z), ab(a[i].x, a[i].y, a[i].z);
+                if(this->type[i]!=REVOLUTE) return false;
+                if(this->pos[i].x!=pb.x || this->pos[i].y!=pb.y || this->pos[i].z!=pb.z) return false;
+                if(this->alfa[i].x!=ab.x || this->alfa[i].y!=ab.y || this->alfa[i].z!=ab.z) return false;
+            }
+            return true;
+        }
+
+        /**
+         * @brief 関節iの相対変換
+         */
+        pose<T> link(int i, T q) const
+        {
+            if(this->type[i]==PRISMATIC)
+                return pose<T>(this->pos[i] + this->alfa[i]*q, vec4<T>());
+            return pose<T>(this->pos[i], vec4<T>(this->alfa[i], q));
+        }
+};
+
+/**
+ * @brief フラグ生成（ロボットモデル指定）
+ * @details 直動軸の回転数は0、形態フラグ(SFLG1)は標準アームのみ（それ以外は0）
+ */
+template <typename T, int N>
+SFLG FlgChk(const robot_model<T,N>& rm, joint<T,N> jnt)
+{
+    for(int i=0; i<N; i++)
+        if(rm.type[i]==PRISMATIC) jnt.val[i] = 0;
+    SFLG ret = FlgChk(jnt);
+    if(!rm.standard()) ret.flg1.val = 0;
     return ret;
 }
 
+/**
+ * @brief 角度制約チェック（ロボットモデルの制約テーブル）
+ * @param [out] mask 制約外の軸マスク
+ * @retval true 制約外
+ * @retval false 制約内
+ */
+template <typename T, int N>
+bool LimChk(const robot_model<T,N>& rm, const joint<T,N>& jnt, unsigned int *mask=nullptr)
+{
+    return LimChk(jnt, rm.lim, mask);
+}
 
-
+/**
+ * @brief 角度制約チェック（標準アーム）
+ * @retval true 制約外
+ * @retval false 制約内
+ */
+template <typename T>
+bool LimChk(const joint<T>& jnt)
+{
+    static const robot_model<T> rm;     // 標準アーム
+    return LimChk(jnt, rm.lim);
+}
 
 /**
  * @brief ジョイント関節から姿勢生成(基準座標)
+ * @param [in] rm ロボットモデル
+ * @param [in] jnt 関節値
  * @param [in] posI ベース姿勢
+ * @return 各リンク座標系（N+1個、末尾にフラグ付き）
  */
-template <typename T>
-std::vector<fpose<T>> to_pose_array(joint<T> jnt, pose<T> posI=pose<T>())
+template <typename T, int N>
+std::array<fpose<T>, N+1> to_pose_array(const robot_model<T,N>& rm, joint<T,N> jnt, pose<T> posI=pose<T>())
 {
-    std::vector<vec3<T>> pos = posB();
-    std::vector<vec3<T>> alfa = alfaB();
-
-    int linksize = jnt.val.size();
-    std::vector<fpose<T>> pa(linksize+1);
+    std::array<fpose<T>, N+1> pa;
     pa[0] = posI;
-    for(int i=0; i<linksize; i++)
-        pa[i+1] = pa[i] * fpose<T>(pos[i], vec4<T>(alfa[i], jnt[i]));
+    auto link = [&](int i){ pa[i+1] = pa[i] * rm.link(i, jnt.val[i]); };
+    unroll<0, N>::run(link);
 
-    SFLG flg = FlgChk(jnt);
-    pa[linksize].flg1 = flg.flg1;
-    pa[linksize].flg2 = flg.flg2;    
+    SFLG flg = FlgChk(rm, jnt);
+    pa[N].flg1 = flg.flg1;
+    pa[N].flg2 = flg.flg2;
     return pa;
 }
 
+/**
+ * @brief ジョイント関節から手先姿勢生成(基準座標)
+ * @param [in] rm ロボットモデル
+ * @param [in] jnt 関節値
+ * @param [in] posI ベース姿勢
+ */
+template <typename T, int N>
+fpose<T> to_pose(const robot_model<T,N>& rm, joint<T,N> jnt, pose<T> posI=pose<T>())
+{
+    return to_pose_array(rm, jnt, posI)[N];
+}
+
+/**
+ * @brief ジョイント関節から姿勢生成(基準座標)
+ * @param [in] posI ベース姿勢
+ */
+template <typename T>
+std::vector<fpose<T>> to_pose_array(joint<T> jnt, pose<T> posI=pose<T>())
+{
+    static const robot_model<T> rm;     // 標準アーム
+    std::array<fpose<T>, Naxis+1> pa = to_pose_array(rm, jnt, posI);
+    return std::vector<fpose<T>>(pa.begin(), pa.end());
+}
+
 /**
  * @brief ジョイント関節から手先姿勢生成(基準座標)
  * @param [in] posI ベース姿勢
@@ -114,7 +449,7 @@ std::vector<fpose<T>> to_pose_array(joint<T> jnt, pose<T> posI=pose<T>())
 template <typename T>
 fpose<T> to_pose(joint<T> jnt, pose<T> posI=pose<T>())
 {
-    std::vector<pose<T>> pa = to_pose_array(jnt, posI);
+    std::vector<fpose<T>> pa = to_pose_array(jnt, posI);
     return pa.back();
 }
 
@@ -0,0 +1,308 @@
+/**
+ * @file rrt.h
+ * @brief 関節空間の双方向RRT（RRT-Connect）経路計画
+ */
+#pragma once
+#include <robot/kdtree.h>
+#include <robot/joint_limit.h>
+#include <robot/thread_pool.h>
+#include <robot/fpose.h>
+#include <random>
+#include <chrono>
+
+namespace kinematics
+{
+
+/**
+ * @brief 経路計画の状態
+ */
+enum PLAN_STATUS
+{
+    PLAN_SUCCESS = 0,       ///< 成功
+    PLAN_INVALID_START,     ///< 始点が無効（角度制約外・干渉）
+    PLAN_INVALID_GOAL,      ///< 終点が無効（要求回転数が角度制約外を含む）
+    PLAN_TIMEOUT,           ///< 反復回数・時間の上限
+};
+
+/**
+ * @brief 関節空間の双方向RRTクラス
+ * @details 始点・終点から木を伸ばし、一方をランダム点へ1歩伸ばした点へ
+ *          他方の木を直線で接続する（RRT-Connect）。最近傍はk-d木で探索する。
+ *          直線区間の有効判定は分解能毎の点列を判定関数で調べ、ワーカープールで
+ *          点列を分担して最初の無効点を求める（無効点の手前までを木に追加）。
+ *          判定関数はワーカー番号を受け取るため、ワーカー毎の作業領域を持つ
+ *          干渉判定（self_collisionなど）をそのまま使える。
+ *          終点の回転数（SFLG2）を指定すると各軸を2pi単位で移した終点へ計画し、
+ *          any_turnでは角度制約内の回転違いの終点全てを終点側の木の根とする。
+ * @tparam N 軸数
+ */
+template <typename T, int N=Naxis>
+class rrt_connect
+{
+    public:
+        /**
+         * @brief 状態の有効判定 valid(q, worker)（角度制約は計画側で判定）
+         */
+        typedef std::function<bool(const joint<T,N>&, int)> valid_t;
+
+        joint_limit<T,N> lim;       ///< 角度制約（サンプリング範囲、有限値）
+        valid_t valid;              ///< 有効判定（ワーカー間で並行に呼ばれる）
+        thread_pool *pool;          ///< ワーカープール（nullptrで呼び出しスレッドのみ）
+        T range = 0.5;              ///< 1歩の長さ[rad]（ユークリッド距離）
+        T resolution = 0.02;        ///< 区間判定の分解能[rad]（軸毎の最大変化量）
+        int max_iter = 20000;       ///< 反復回数の上限
+        double timeout = 1.0;       ///< 計算時間の上限[s]
+        bool any_turn = false;      ///< 終点の回転数を問わない（flg2未指定時）
+        unsigned int seed = 1;      ///< 乱数の種（計画毎に進む）
+
+        int iterations = 0;         ///< 直前の計画の反復回数
+        long checks = 0;            ///< 直前の計画の判定回数
+        int nodes = 0;              ///< 直前の計画の木の点数（両木の合計）
+
+        /**
+         * @brief 生成
+         * @param [in] lim_ 角度制約（サンプリング範囲、有限値）
+         * @param [in] valid_ 有効判定
+         * @param [in] pool_ ワーカープール
+         */
+        rrt_connect(const joint_limit<T,N>& lim_, const valid_t& valid_, thread_pool *pool_=nullptr)
+        {
+            this->lim = lim_;
+            this->valid = valid_;
+            this->pool = pool_;
+            for(int i=0; i<N; i++)
+                assert(std::isfinite(lim_.qmin.val[i]) && std::isfinite(lim_.qmax.val[i]));
+        }
+
+        /**
+         * @brief 経路計画
+         * @param [in] q0 始点
+         * @param [in] q1 終点
+         * @param [out] path 経由点列（始点・終点を含む、各区間は有効判定済み）
+         * @param [in] flg2 終点の要求回転数（nullptrでq1のまま、any_turnでは任意）
+         * @return 状態
+         */
+        PLAN_STATUS operator()(const joint<T,N>& q0, const joint<T,N>& q1, std::vector<joint<T,N>>& path, const SFLG2 *flg2=nullptr)
+        {
+            auto t0 = std::chrono::steady_clock::now();
+            path.clear();
+            this->iterations = 0;
+            this->checks = 0;
+            this->nodes = 0;
+            std::mt19937 rng(this->seed++);
+
+            if(this->lim.check(q0) || !this->valid(q0, 0)) return PLAN_INVALID_START;
+            this->checks++;
+
+            // 終点側の根
+            std::vector<joint<T,N>> goals;
+            this->goal_set(q1, flg2, goals);
+            if(goals.empty()) return PLAN_INVALID_GOAL;
+
+            tree ta, tb;
+            ta.add(q0, -1);
+            for(const auto& g : goals) tb.add(g, -1);
+
+            // 始点から直接到達できる場合
+            int k = this->connect(tb, q0);
+            if(k>=0 && kd_tree<T,N>::dist2(tb.kd[k], q0)==0) return this->finish(ta, 0, tb, k, false, path);
+
+            std::uniform_real_distribution<T> U(0, 1);
+            tree *a = &ta, *b = &tb;
+            for(int it=0; it<this->max_iter; it++)
+            {
+                this->iterations = it+1;
+                if((it & 15)==0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() > this->timeout) break;
+
+                joint<T,N> qr;
+                for(int i=0; i<N; i++)
+                    qr.val[i] = this->lim.qmin.val[i] + (this->lim.qmax.val[i] - this->lim.qmin.val[i])*U(rng);
+
+                // 一方の木を1歩伸ばす
+                int na = a->kd.nearest(qr);
+                joint<T,N> qn = this->steer(a->kd[na], qr, this->range);
+                int ia = this->extend(*a, na, qn);
+                if(ia>=0)
+                {
+                    // 他方の木を接続
+                    int ib = this->connect(*b, a->kd[ia]);
+                    if(ib>=0 && kd_tree<T,N>::dist2(b->kd[ib], a->kd[ia])==0)
+                        return this->finish(*a, ia, *b, ib, a!=&ta, path);
+                }
+                std::swap(a, b);
+            }
+            this->nodes = ta.kd.size() + tb.kd.size();
+            return PLAN_TIMEOUT;
+        }
+
+        /**
+         * @brief 区間の有効判定（分解能毎の点列、ワーカープールで分担）
+         * @param [in] qa 始点（判定済みとして扱う）
+         * @param [in] qb 終点
+         * @return 最初の無効点の番号（1～m）全て有効でm+1（mは分割数）
+         * @param [out] m 分割数
+         */
+        int check_segment(const joint<T,N>& qa, const joint<T,N>& qb, int& m)
+        {
+            T dmax = 0;
+            for(int i=0; i<N; i++) dmax = std::max(dmax, std::abs(qb.val[i] - qa.val[i]));
+            m = std::max(1, (int)ceil(dmax/this->resolution));
+
+            std::atomic<int> first(m+1);
+            std::atomic<long> cnt(0);
+            auto job = [&](int b, int e, int worker)
+            {
+                for(int k=b+1; k<=e; k++)
+                {
+                    if(k >= first.load(std::memory_order_relaxed)) return;
+                    joint<T,N> q;
+                    T s = (T)k/m;
+                    for(int i=0; i<N; i++) q.val[i] = qa.val[i] + (qb.val[i] - qa.val[i])*s;
+                    cnt++;
+                    if(!this->valid(q, worker))
+                    {
+                        int f = first.load();
+                        while(k < f && !first.compare_exchange_weak(f, k));
+                        return;
+                    }
+                }
+            };
+            // 短い区間は呼び出しスレッドのみ
+            if(this->pool && m >= 4*this->pool->size()) this->pool->parallel_for(m, job, std::max(1, m/(4*this->pool->size())));
+            else                                        job(0, m, 0);
+            this->checks += cnt;
+            return first;
+        }
+
+    private:
+        /**
+         * @brief 木（点と親）
+         */
+        struct tree
+        {
+            kd_tree<T,N> kd;
+            std::vector<int> parent;
+
+            int add(const joint<T,N>& q, int p)
+            {
+                this->parent.push_back(p);
+                return this->kd.insert(q);
+            }
+        };
+
+        /**
+         * @brief 終点の回転違いの展開
+         */
+        void goal_set(const joint<T,N>& q1, const SFLG2 *flg2, std::vector<joint<T,N>>& out)
+        {
+            const T P2 = 2.0*M_PI;
+            if(flg2)
+            {
+                joint<T,N> g;
+                int n[N];
+                decode_flg2(flg2->val, n, N);
+                for(int i=0; i<N; i++)
+                    g.val[i] = q1.val[i] - P2*round(q1.val[i]/P2) + P2*n[i];
+                if(!this->lim.check(g) && this->valid(g, 0)) out.push_back(g);
+                this->checks++;
+                return;
+            }
+            if(!this->any_turn)
+            {
+                if(!this->lim.check(q1) && this->valid(q1, 0)) out.push_back(q1);
+                this->checks++;
+                return;
+            }
+
+            // 軸毎の回転違い（角度制約内）の全組合せ
+            std::array<std::vector<T>, N> alt;
+            size_t total = 1;
+            for(int i=0; i<N; i++)
+            {
+                T a = q1.val[i] - P2*round(q1.val[i]/P2);
+                for(T k=ceil((this->lim.qmin.val[i] - a)/P2); a + P2*k <= this->lim.qmax.val[i]; k++)
+                    alt[i].push_back(a + P2*k);
+                total *= alt[i].size();
+            }
+            for(size_t c=0; c<total; c++)
+            {
+                joint<T,N> g;
+                size_t r = c;
+                for(int i=0; i<N; i++)
+                {
+                    g.val[i] = alt[i][r % alt[i].size()];
+                    r /= alt[i].size();
+                }
+                this->checks++;
+                if(this->valid(g, 0)) out.push_back(g);
+            }
+        }
+
+        static joint<T,N> steer(const joint<T,N>& from, const joint<T,N>& to, T step)
+        {
+            T d = sqrt(kd_tree<T,N>::dist2(from, to));
+            if(d <= step) return to;
+            joint<T,N> ret;
+            for(int i=0; i<N; i++) ret.val[i] = from.val[i] + (to.val[i] - from.val[i])*(step/d);
+            return ret;
+        }
+
+        /**
+         * @brief 点naからqへ1歩（有効なら追加）
+         * @return 追加した点の番号 無効で-1
+         */
+        int extend(tree& t, int na, const joint<T,N>& q)
+        {
+            int m;
+            if(this->check_segment(t.kd[na], q, m) <= m) return -1;
+            return t.add(q, na);
+        }
+
+        /**
+         * @brief 木をqへ直線で接続（無効点の手前まで1歩毎に追加）
+         * @return 最後に追加した点の番号（qに到達した場合はqの点）追加なしで-1
+         */
+        int connect(tree& t, const joint<T,N>& q)
+        {
+            int n = t.kd.nearest(q);
+            joint<T,N> qa = t.kd[n];
+            int m;
+            int f = this->check_segment(qa, q, m);
+            T reach = (T)(f-1)/m;       // 有効な区間の割合
+            T len = sqrt(kd_tree<T,N>::dist2(qa, q));
+            int steps = std::max(1, (int)ceil(len/this->range));
+            int last = -1;
+            for(int k=1; k<=steps; k++)
+            {
+                T s = (T)k/steps;
+                if(s > reach) s = reach;
+                if(s <= 0) break;
+                joint<T,N> p;
+                for(int i=0; i<N; i++) p.val[i] = qa.val[i] + (q.val[i] - qa.val[i])*s;
+                if(f > m && k==steps) p = q;
+                n = t.add(p, n);
+                last = n;
+                if(s < (T)k/steps) break;
+            }
+            return last;
+        }
+
+        /**
+         * @brief 両木の経路を連結
+         * @param [in] reversed trueでaが終点側の木
+         */
+        PLAN_STATUS finish(const tree& a, int ia, const tree& b, int ib, bool reversed, std::vector<joint<T,N>>& path)
+        {
+            std::vector<joint<T,N>> pa, pb;
+            for(int i=ia; i>=0; i=a.parent[i]) pa.push_back(a.kd[i]);
+            for(int i=b.parent[ib]; i>=0; i=b.parent[i]) pb.push_back(b.kd[i]);
+            std::reverse(pa.begin(), pa.end());
+            path = pa;
+            path.insert(path.end(), pb.begin(), pb.end());
+            if(reversed) std::reverse(path.begin(), path.end());
+            this->nodes = a.kd.size() + b.kd.size();
+            return PLAN_SUCCESS;
+        }
+};
+
+}
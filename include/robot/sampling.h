@@ -0,0 +1,253 @@
+/**
+ * @file sampling.h
+ * @brief 姿勢空間SO(3)・SE(3)の一様な標本列（番号から直接計算）
+ */
+#pragma once
+#include <robot/geometry.h>
+#include <cstdint>
+
+namespace kinematics
+{
+
+/**
+ * @brief HEALPix（RING番号付け）の画素中心
+ * @details 単位球を等面積の12*nside^2画素に分け、画素番号から中心の
+ *          z = cos(theta) と方位phiを閉形式で求める（北極側の帯から順）。
+ * @param [in] nside 分割数
+ * @param [in] p 画素番号（0～12*nside^2-1）
+ * @param [out] z 中心のz座標
+ * @param [out] phi 中心の方位[rad]
+ */
+template <typename T>
+void healpix_center(int nside, int64_t p, T& z, T& phi)
+{
+    const int64_t npix = 12*(int64_t)nside*nside;
+    const int64_t ncap = 2*(int64_t)nside*(nside-1);
+    const T n2 = 3*(T)nside*nside;
+    assert(0<=p && p<npix);
+    if(p < ncap)
+    {
+        // 北極側（帯iにはi*4画素）
+        int64_t i = (int64_t)((sqrt(1 + 2*(T)p) + 1)/2);
+        if(2*i*(i-1) > p) i--;
+        if(2*(i+1)*i <= p) i++;
+        int64_t j = p + 1 - 2*i*(i-1);
+        z = 1 - i*i/n2;
+        phi = (j - (T)0.5)*M_PI/(2*i);
+    }
+    else if(p < npix - ncap)
+    {
+        // 赤道帯（各帯4*nside画素、1帯おきに半画素ずらす、方位は[0,2pi)）
+        int64_t q = p - ncap;
+        int64_t i = q/(4*nside) + nside;
+        int64_t j = q%(4*nside) + 1;
+        int s = (i - nside + 1)%2;
+        z = (T)4/3 - 2*(T)i/(3*nside);
+        phi = (j - 1 + (T)s/2)*M_PI/(2*nside);
+    }
+    else
+    {
+        // 南極側（北極側の鏡像）
+        int64_t q = npix - p;
+        int64_t i = (int64_t)((sqrt(2*(T)q - 1) + 1)/2);
+        if(2*i*(i-1) >= q) i--;
+        if(2*(i+1)*i < q) i++;
+        int64_t j = 4*i + 1 - (q - 2*i*(i-1));
+        z = -1 + i*i/n2;
+        phi = (j - (T)0.5)*M_PI/(2*i);
+    }
+}
+
+/**
+ * @brief Hopf座標による一様な回転の格子
+ * @details 回転をアプローチ方向（球面S^2、HEALPix）とその軸まわりの回転（円S^1）に分け、
+ *          両者の直積で四元数を並べる（Yershovaらの方法）。分解能level rで
+ *          S^2は12*4^r画素、S^1は6*2^r点、合計72*8^r個。オイラー角の一様格子と異なり
+ *          極付近への偏りがない。番号から四元数を直接計算するため、番号の範囲で
+ *          スレッド・プロセスへ分担できる（調整不要）。
+ */
+template <typename T>
+class so3_grid
+{
+    public:
+        int level;      ///< 分解能（0以上）
+
+        /**
+         * @brief 生成
+         * @param [in] level_ 分解能（隣接点の角度はおよそ 60/2^level 度）
+         */
+        so3_grid(int level_=0) : level(level_)
+        {
+            assert(level_>=0 && level_<=10);
+        }
+
+        /**
+         * @brief 点数
+         */
+        int64_t size() const
+        {
+            return (int64_t)72 << (3*this->level);
+        }
+
+        /**
+         * @brief i番目の回転（w>=0）
+         */
+        vec4<T> operator[](int64_t i) const
+        {
+            const int nside = 1 << this->level;
+            const int m = 6*nside;      // S^1の点数
+            T z, phi;
+            healpix_center(nside, i/m, z, phi);
+            T psi = (i%m + (T)0.5)*(2*M_PI/m);
+            T c = sqrt(std::max((1 + z)/2, (T)0));     // cos(theta/2)
+            T s = sqrt(std::max((1 - z)/2, (T)0));     // sin(theta/2)
+            vec4<T> ret(s*cos(phi + psi/2), s*sin(phi + psi/2), c*sin(psi/2), c*cos(psi/2));
+            if(ret.w<0) ret = -ret;
+            return ret;
+        }
+
+        /**
+         * @brief 番号[first, first+num)の回転を軸毎の配列へ
+         * @param [out] q q[0..3] = x, y, z, w の配列（各num要素）
+         */
+        void generate(int64_t first, int num, T* const q[4]) const
+        {
+            for(int k=0; k<num; k++)
+            {
+                vec4<T> r = (*this)[first + k];
+                q[0][k] = r.x;
+                q[1][k] = r.y;
+                q[2][k] = r.z;
+                q[3][k] = r.w;
+            }
+        }
+};
+
+/**
+ * @brief Sobol列（6次元、番号から直接計算）
+ * @details 方向数はJoe-Kuoの表（new-joe-kuo-6.21201）の先頭6次元。
+ *          番号iの点はiの立っているビットの方向数の排他的論理和で、
+ *          shiftとの排他的論理和（デジタルシフト）で独立な列を作れる。
+ */
+class sobol6
+{
+    public:
+        static const int dims = 6;  ///< 次元数
+
+        sobol6()
+        {
+            static const int s[dims] = {0, 1, 2, 3, 3, 4};
+            static const int a[dims] = {0, 0, 1, 1, 2, 1};
+            static const int m[dims][4] = {{1}, {1}, {1, 3}, {1, 3, 1}, {1, 1, 1}, {1, 1, 3, 3}};
+            for(int d=0; d<dims; d++)
+            {
+                if(d==0)
+                {
+                    for(int k=0; k<32; k++) this->v[d][k] = 1u << (31-k);
+                    continue;
+                }
+                for(int k=0; k<s[d]; k++) this->v[d][k] = (uint32_t)m[d][k] << (31-k);
+                for(int k=s[d]; k<32; k++)
+                {
+                    uint32_t x = this->v[d][k-s[d]] ^ (this->v[d][k-s[d]] >> s[d]);
+                    for(int b=1; b<s[d]; b++)
+                        if((a[d] >> (s[d]-1-b)) & 1) x ^= this->v[d][k-b];
+                    this->v[d][k] = x;
+                }
+            }
+        }
+
+        /**
+         * @brief 番号iの点の次元d（[0,1)）
+         */
+        double operator()(uint32_t i, int d, uint32_t shift=0) const
+        {
+            uint32_t x = shift;
+            for(int k=0; i; i>>=1, k++)
+                if(i & 1) x ^= this->v[d][k];
+            return x*(1.0/4294967296.0);
+        }
+
+    private:
+        uint32_t v[dims][32];   ///< 方向数
+};
+
+/**
+ * @brief 一様な位置・姿勢の低食い違い列
+ * @details 6次元Sobol列の3次元を範囲内の位置へ、残り3次元をShoemakeの方法で
+ *          一様な回転へ写す。番号から直接計算するため分担が容易で、
+ *          seedを変えるとデジタルシフトにより独立な列になる。
+ */
+template <typename T>
+class se3_sobol
+{
+    public:
+        aabb<T> box;        ///< 位置の範囲
+        uint32_t seed;      ///< デジタルシフトの種（0でシフトなし）
+
+        /**
+         * @brief 生成
+         * @param [in] box_ 位置の範囲
+         * @param [in] seed_ デジタルシフトの種
+         */
+        se3_sobol(const aabb<T>& box_, uint32_t seed_=0) : box(box_), seed(seed_)
+        {
+            for(int d=0; d<sobol6::dims; d++)
+            {
+                uint32_t z = seed_ ? seed_*0x9e3779b9u + d*0x85ebca6bu : 0;
+                z ^= z >> 16;
+                z *= 0x7feb352du;
+                z ^= z >> 15;
+                this->shift[d] = seed_ ? z : 0;
+            }
+        }
+
+        /**
+         * @brief i番目の位置・姿勢
+         */
+        pose<T> operator[](uint32_t i) const
+        {
+            T u[sobol6::dims];
+            for(int d=0; d<sobol6::dims; d++) u[d] = this->seq(i, d, this->shift[d]);
+            return pose<T>(vec3<T>(this->box.lo.x + (this->box.hi.x - this->box.lo.x)*u[0],
+                                   this->box.lo.y + (this->box.hi.y - this->box.lo.y)*u[1],
+                                   this->box.lo.z + (this->box.hi.z - this->box.lo.z)*u[2]),
+                           uniform_rotation(u[3], u[4], u[5]));
+        }
+
+        /**
+         * @brief 番号[first, first+num)を軸毎の配列へ
+         * @param [out] out out[0..2] = 位置x,y,z、out[3..6] = 四元数x,y,z,w の配列（各num要素）
+         */
+        void generate(uint32_t first, int num, T* const out[7]) const
+        {
+            for(int k=0; k<num; k++)
+            {
+                pose<T> P = (*this)[first + k];
+                out[0][k] = P.p.x;
+                out[1][k] = P.p.y;
+                out[2][k] = P.p.z;
+                out[3][k] = P.q.x;
+                out[4][k] = P.q.y;
+                out[5][k] = P.q.z;
+                out[6][k] = P.q.w;
+            }
+        }
+
+        /**
+         * @brief [0,1)^3から一様な回転（Shoemake、w>=0）
+         */
+        static vec4<T> uniform_rotation(T u1, T u2, T u3)
+        {
+            T a = sqrt(1 - u1), b = sqrt(u1);
+            vec4<T> ret(a*sin(2*M_PI*u2), a*cos(2*M_PI*u2), b*sin(2*M_PI*u3), b*cos(2*M_PI*u3));
+            if(ret.w<0) ret = -ret;
+            return ret;
+        }
+
+    private:
+        sobol6 seq;                         ///< Sobol列
+        uint32_t shift[sobol6::dims];       ///< 次元毎のデジタルシフト
+};
+
+}
@@ -0,0 +1,448 @@
+/**
+ * @file sdf.h
+ * @brief 作業環境のボクセル符号付き距離場
+ */
+#pragma once
+#include <robot/bvh.h>
+#include <robot/mapped_file.h>
+
+namespace kinematics
+{
+
+/**
+ * @brief リンクに取り付けた球
+ */
+template <typename T>
+struct link_sphere
+{
+    int link;       ///< リンク番号（to_pose_arrayの番号）
+    sphere<T> s;    ///< リンク座標系の球
+};
+
+/**
+ * @brief リンク形状（カプセル）を球列で覆う
+ * @details 軸上に間隔step以下で球を並べ、半径は sqrt(r^2 + (間隔/2)^2) として
+ *          カプセルを内包させる（距離は安全側に最大 半径増分 だけ小さくなる）。
+ * @param [in] robot リンク形状
+ * @param [in] step 球の間隔の上限
+ */
+template <typename T, int N>
+std::vector<link_sphere<T>> link_spheres(const self_collision<T,N>& robot, T step)
+{
+    assert(step>0);
+    std::vector<link_sphere<T>> ret;
+    for(int k=0; k<=N; k++)
+    {
+        for(const auto& c : robot.shapes(k))
+        {
+            vec3<T> d = c.b - c.a;
+            T len = d.nrm();
+            int m = (int)ceil(len/step);
+            if(m==0)
+            {
+                ret.push_back(link_sphere<T>{k, sphere<T>{c.a, c.r}});
+                continue;
+            }
+            T h = len/m;
+            T r = sqrt(c.r*c.r + 0.25*h*h);
+            for(int i=0; i<=m; i++)
+                ret.push_back(link_sphere<T>{k, sphere<T>{c.a + d*((T)i/m), r}});
+        }
+    }
+    return ret;
+}
+
+/**
+ * @brief 符号付き距離場クラス
+ * @details 直方体・三角形（bvhの要素）を格子点の中心で占有ボクセル化し、
+ *          占有・非占有それぞれのユークリッド距離変換（Felzenszwalbの分離型、
+ *          軸毎の1次元変換をワーカープールで並列）から符号付き距離を求める。
+ *          距離は障害物外で正・内部で負、格子点間は3線形補間で値と勾配を返す。
+ *          格子は単精度でx最速の連続配列に保持し、ファイルに保存したものは
+ *          mmapで読み込むため、読み込み時の変換や確保が発生しない。
+ * @note 占有判定は格子点から要素まで半格子以内とするため、距離は安全側に
+ *       最大で格子間隔程度の誤差を持つ。三角形は面として扱い内部の符号は持たない。
+ */
+template <typename T>
+class sdf
+{
+    public:
+        vec3<T> origin;     ///< 格子点(0,0,0)の位置
+        T res = 0;          ///< 格子間隔
+        int nx = 0;         ///< x方向の格子点数
+        int ny = 0;         ///< y方向の格子点数
+        int nz = 0;         ///< z方向の格子点数
+
+        sdf() {}
+
+        sdf(const sdf&) = delete;
+        sdf& operator=(const sdf&) = delete;
+
+        /**
+         * @brief 構築
+         * @param [in] env 障害物（build()済み）
+         * @param [in] region 距離場の範囲
+         * @param [in] res_ 格子間隔
+         * @param [in] pool ワーカープール（nullptrで呼び出しスレッドのみ）
+         */
+        void build(const bvh<T>& env, const aabb<T>& region, T res_, thread_pool *pool=nullptr)
+        {
+            assert(res_>0);
+            this->cells.release();
+            vec3<T> ext = region.hi - region.lo;
+            this->origin = region.lo;
+            this->res = res_;
+            this->nx = std::max(2, (int)ceil(ext.x/res_ - 1e-9) + 1);
+            this->ny = std::max(2, (int)ceil(ext.y/res_ - 1e-9) + 1);
+            this->nz = std::max(2, (int)ceil(ext.z/res_ - 1e-9) + 1);
+            int n = this->nx*this->ny*this->nz;
+
+            // 要素の格子点範囲
+            int np = env.prim.size();
+            std::vector<std::array<int,6>> range(np);
+            auto rng = [&](int b, int e, int)
+            {
+                for(int i=b; i<e; i++)
+                    this->cell_range(bvh<T>::bounds(env.prim[i]), 0.5*res_, &range[i][0], &range[i][3]);
+            };
+            if(pool) pool->parallel_for(np, rng);
+            else     rng(0, np, 0);
+
+            // 占有ボクセル化（z方向の範囲毎に並列）
+            std::vector<unsigned char> occ(n, 0);
+            T h2 = 0.25*res_*res_;
+            auto rast = [&](int b, int e, int)
+            {
+                for(int m=0; m<np; m++)
+                {
+                    const auto& p = env.prim[m];
+                    const std::array<int,6>& r = range[m];
+                    for(int k=std::max(r[2], b); k<=std::min(r[5], e-1); k++)
+                    {
+                        for(int j=r[1]; j<=r[4]; j++)
+                        {
+                            for(int i=r[0]; i<=r[3]; i++)
+                            {
+                                int c = this->index(i, j, k);
+                                if(occ[c]) continue;
+                                vec3<T> x = this->point(i, j, k);
+                                if(bvh<T>::distance2(p, capsule<T>{x, x, 0}) <= h2) occ[c] = 1;
+                            }
+                        }
+                    }
+                }
+            };
+            if(pool) pool->parallel_for(this->nz, rast, 1);
+            else     rast(0, this->nz, 0);
+
+            // 占有・非占有までの2乗距離（格子単位）
+            const float far = 1e20f;
+            std::vector<float> dout(n), din(n);
+            for(int c=0; c<n; c++)
+            {
+                dout[c] = occ[c] ? 0 : far;
+                din[c]  = occ[c] ? far : 0;
+            }
+            this->transform3(&dout[0], pool);
+            this->transform3(&din[0], pool);
+
+            // 境界は格子点間の中央とみなして半格子ずらす
+            float *grid = this->cells.assign(n, 0.0f);
+            T big = (this->nx + this->ny + this->nz)*res_;
+            auto fin = [&](int b, int e, int)
+            {
+                for(int c=b; c<e; c++)
+                {
+                    if(occ[c])                grid[c] = -(sqrt(din[c]) - 0.5)*res_;
+                    else if(dout[c]<far*0.5f) grid[c] = (sqrt(dout[c]) - 0.5)*res_;
+                    else                      grid[c] = big;
+                }
+            };
+            if(pool) pool->parallel_for(n, fin);
+            else     fin(0, n, 0);
+        }
+
+        /**
+         * @brief 格子点の値
+         */
+        T at(int i, int j, int k) const
+        {
+            return this->cells.data()[this->index(i, j, k)];
+        }
+
+        /**
+         * @brief 格子の有無
+         */
+        bool empty() const
+        {
+            return this->cells.empty();
+        }
+
+        /**
+         * @brief ファイルから読み込んだ格子か
+         */
+        bool mapped() const
+        {
+            return this->cells.mapped();
+        }
+
+        /**
+         * @brief 符号付き距離
+         * @param [in] p 位置
+         * @param [out] grad 勾配（nullptrで省略）
+         * @return 距離 範囲外は格子端の値dと格子範囲までの距離oから sqrt(d^2+o^2)（d<0ではd+o）
+         */
+        T distance(const vec3<T>& p, vec3<T> *grad=nullptr) const
+        {
+            assert(!this->cells.empty());
+            const T ir = 1/this->res;
+            T gx = (p.x - this->origin.x)*ir;
+            T gy = (p.y - this->origin.y)*ir;
+            T gz = (p.z - this->origin.z)*ir;
+            T cx = std::min(std::max(gx, (T)0), (T)(this->nx-1));
+            T cy = std::min(std::max(gy, (T)0), (T)(this->ny-1));
+            T cz = std::min(std::max(gz, (T)0), (T)(this->nz-1));
+            int i = std::min((int)cx, this->nx-2);
+            int j = std::min((int)cy, this->ny-2);
+            int k = std::min((int)cz, this->nz-2);
+            T fx = cx - i, fy = cy - j, fz = cz - k;
+
+            const int sy = this->nx, sz = this->nx*this->ny;
+            const float *c = this->cells.data() + this->index(i, j, k);
+            T c00 = c[0]    + fx*(c[1]       - c[0]);
+            T c10 = c[sy]   + fx*(c[sy+1]    - c[sy]);
+            T c01 = c[sz]   + fx*(c[sz+1]    - c[sz]);
+            T c11 = c[sz+sy]+ fx*(c[sz+sy+1] - c[sz+sy]);
+            T c0 = c00 + fy*(c10 - c00);
+            T c1 = c01 + fy*(c11 - c01);
+            T ret = c0 + fz*(c1 - c0);
+
+            // 範囲外（格子端の点は範囲内の障害物への最近点方向と直交するため、
+            // 非負の距離はsqrt(d^2 + o^2)を下限とする）
+            vec3<T> e((gx-cx)*this->res, (gy-cy)*this->res, (gz-cz)*this->res);
+            T o = e.nrm();
+            T d = ret;
+            if(o>0) ret = (d>=0) ? sqrt(d*d + o*o) : d + o;
+
+            if(grad)
+            {
+                T dx00 = c[1]       - c[0];
+                T dx10 = c[sy+1]    - c[sy];
+                T dx01 = c[sz+1]    - c[sz];
+                T dx11 = c[sz+sy+1] - c[sz+sy];
+                T dx0 = dx00 + fy*(dx10 - dx00);
+                T dx1 = dx01 + fy*(dx11 - dx01);
+                T dy0 = c10 - c00;
+                T dy1 = c11 - c01;
+                *grad = vec3<T>((dx0 + fz*(dx1 - dx0))*ir, (dy0 + fz*(dy1 - dy0))*ir, (c1 - c0)*ir);
+                if(o>0)
+                {
+                    // 格子端に固定した軸の成分は位置によらない
+                    if(gx!=cx) grad->x = 0;
+                    if(gy!=cy) grad->y = 0;
+                    if(gz!=cz) grad->z = 0;
+                    if(d>=0) *grad = (*grad*d + e)*(1/ret);
+                    else     *grad = *grad + e*(1/o);
+                }
+            }
+            return ret;
+        }
+
+        /**
+         * @brief 一括評価
+         * @param [in] p 位置配列
+         * @param [in] num 要素数
+         * @param [out] out 距離
+         * @param [out] grad 勾配（nullptrで省略）
+         */
+        void distance(const vec3<T> p[], int num, T out[], vec3<T> grad[]=nullptr) const
+        {
+            for(int k=0; k<num; k++)
+                out[k] = this->distance(p[k], grad ? &grad[k] : nullptr);
+        }
+
+        /**
+         * @brief リンクの球とのクリアランス
+         * @param [in] ls リンクの球（link_spheres()の出力）
+         * @param [in] pa リンク座標系（to_pose_arrayの出力）
+         * @param [out] out 球毎のクリアランス（nullptrで省略）
+         * @param [out] grad 球毎の中心位置に対する勾配（基準座標系、nullptrで省略）
+         * @param [out] index 最小の球の番号（nullptrで省略）
+         * @return 最小クリアランス
+         */
+        template <typename C>
+        T distance(const std::vector<link_sphere<T>>& ls, const C& pa, T out[]=nullptr, vec3<T> grad[]=nullptr, int *index=nullptr) const
+        {
+            T ret = INFINITY;
+            for(int k=0; k<(int)ls.size(); k++)
+            {
+                const link_sphere<T>& s = ls[k];
+                T d = this->distance(transform<T>(pa[s.link], s.s.c), grad ? &grad[k] : nullptr) - s.s.r;
+                if(out) out[k] = d;
+                if(d < ret)
+                {
+                    ret = d;
+                    if(index) *index = k;
+                }
+            }
+            return ret;
+        }
+
+        /**
+         * @brief ファイルへ保存
+         * @retval false 書き込み失敗
+         */
+        bool save(const std::string& path) const
+        {
+            header hd;
+            this->fill_header(hd);
+            return this->cells.save(path, hd);
+        }
+
+        /**
+         * @brief ファイルの読み込み（mmap、格子は読み込み専用で共有）
+         * @retval false 読み込み失敗・形式不一致（格子は空になる）
+         */
+        bool load(const std::string& path)
+        {
+            header hd;
+            auto count = [](const header& h) -> size_t
+            {
+                if(h.n[0]<2 || h.n[1]<2 || h.n[2]<2) return 0;
+                return (size_t)h.n[0]*h.n[1]*h.n[2];
+            };
+            if(!this->cells.load(path, "KSDF", 1, hd, count)) return false;
+            this->nx = hd.n[0];
+            this->ny = hd.n[1];
+            this->nz = hd.n[2];
+            this->origin = vec3<T>(hd.origin[0], hd.origin[1], hd.origin[2]);
+            this->res = hd.res;
+            return true;
+        }
+
+    private:
+        /**
+         * @brief ファイルの先頭（格子の開始を64バイト境界にする）
+         */
+        struct header
+        {
+            file_tag tag;       ///< "KSDF"・形式の版・格子の要素サイズ
+            int32_t n[3];       ///< 格子点数
+            double origin[3];   ///< 格子点(0,0,0)の位置
+            double res;         ///< 格子間隔
+            char pad[8];
+        };
+        static_assert(sizeof(header)==64, "sdf header must be 64 bytes");
+
+        mapped_array<float> cells;      ///< 格子（構築またはmmap）
+
+        int index(int i, int j, int k) const
+        {
+            return (k*this->ny + j)*this->nx + i;
+        }
+
+        vec3<T> point(int i, int j, int k) const
+        {
+            return vec3<T>(this->origin.x + i*this->res, this->origin.y + j*this->res, this->origin.z + k*this->res);
+        }
+
+        /**
+         * @brief 包含箱を膨張した範囲の格子点番号
+         */
+        void cell_range(const aabb<T>& box, T pad, int lo[3], int hi[3]) const
+        {
+            const T ir = 1/this->res;
+            const T l[3] = {box.lo.x - pad - this->origin.x, box.lo.y - pad - this->origin.y, box.lo.z - pad - this->origin.z};
+            const T h[3] = {box.hi.x + pad - this->origin.x, box.hi.y + pad - this->origin.y, box.hi.z + pad - this->origin.z};
+            const int n[3] = {this->nx, this->ny, this->nz};
+            for(int a=0; a<3; a++)
+            {
+                lo[a] = std::max((int)ceil(l[a]*ir), 0);
+                hi[a] = std::min((int)floor(h[a]*ir), n[a]-1);
+            }
+        }
+
+        void fill_header(header& hd) const
+        {
+            memset(&hd, 0, sizeof(hd));
+            hd.tag.set("KSDF", 1, sizeof(float));
+            hd.n[0] = this->nx;
+            hd.n[1] = this->ny;
+            hd.n[2] = this->nz;
+            hd.origin[0] = this->origin.x;
+            hd.origin[1] = this->origin.y;
+            hd.origin[2] = this->origin.z;
+            hd.res = this->res;
+        }
+
+        /**
+         * @brief 1次元の2乗距離変換（下側包絡線）
+         * @param [in,out] f 2乗距離（stride間隔、その場で変換）
+         * @param [in] n 要素数
+         * @param [in] stride 要素の間隔
+         * @param [in] g,v,z 作業領域（n, n, n+1要素）
+         */
+        static void transform1(float *f, int n, int stride, float *g, int *v, float *z)
+        {
+            for(int q=0; q<n; q++) g[q] = f[q*stride];
+            int k = 0;
+            v[0] = 0;
+            z[0] = -INFINITY;
+            z[1] = INFINITY;
+            for(int q=1; q<n; q++)
+            {
+                float s;
+                while(true)
+                {
+                    int p = v[k];
+                    s = ((g[q] + (float)q*q) - (g[p] + (float)p*p))/(2.0f*(q - p));
+                    if(s > z[k]) break;
+                    k--;
+                }
+                k++;
+                v[k] = q;
+                z[k] = s;
+                z[k+1] = INFINITY;
+            }
+            k = 0;
+            for(int q=0; q<n; q++)
+            {
+                while(z[k+1] < q) k++;
+                float e = (float)(q - v[k]);
+                f[q*stride] = e*e + g[v[k]];
+            }
+        }
+
+        /**
+         * @brief 3次元の2乗距離変換（軸毎の1次元変換、直線毎に並列）
+         */
+        void transform3(float *f, thread_pool *pool) const
+        {
+            const int nx = this->nx, ny = this->ny, nz = this->nz;
+            int nw = pool ? pool->size() : 1;
+            int m = std::max(nx, std::max(ny, nz));
+            std::vector<float> g(nw*m), z(nw*(m+1));
+            std::vector<int> v(nw*m);
+
+            const int line[3] = {ny*nz, nx*nz, nx*ny};
+            for(int axis=0; axis<3; axis++)
+            {
+                auto job = [&](int b, int e, int w)
+                {
+                    float *gw = &g[w*m];
+                    float *zw = &z[w*(m+1)];
+                    int *vw = &v[w*m];
+                    for(int l=b; l<e; l++)
+                    {
+                        if(axis==0)      transform1(f + l*nx, nx, 1, gw, vw, zw);
+                        else if(axis==1) transform1(f + (l/nx)*nx*ny + l%nx, ny, nx, gw, vw, zw);
+                        else             transform1(f + l, nz, nx*ny, gw, vw, zw);
+                    }
+                };
+                if(pool) pool->parallel_for(line[axis], job);
+                else     job(0, line[axis], 0);
+            }
+        }
+};
+
+}
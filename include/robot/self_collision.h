@@ -0,0 +1,336 @@
+/**
+ * @file self_collision.h
+ * @brief リンクのカプセル・球モデルによる自己干渉判定
+ */
+#pragma once
+#include <robot/robot.h>
+#include <robot/geometry.h>
+#include <robot/thread_pool.h>
+
+namespace kinematics
+{
+
+/**
+ * @brief 自己干渉判定クラス
+ * @details リンクk（to_pose_arrayのk番目の座標系、k=0がベース）に
+ *          カプセル・球（リンク座標系）を取り付け、干渉許可行列で除外しない
+ *          リンク対をbuild()で対リストにしておく。
+ *          判定はリンク毎の外接球（2段の球木の根）で対を枝刈りし、
+ *          残った対のリンク形状のみ座標変換して線分間距離で判定する。
+ *          作業領域はbuild()で確保し、判定中に確保は発生しない。
+ * @tparam N 軸数
+ */
+template <typename T, int N=Naxis>
+class self_collision
+{
+    public:
+        static const int Nlink = N+1;   ///< リンク数（ベースを含む）
+
+        /**
+         * @brief 判定作業領域（スレッド毎）
+         */
+        struct work
+        {
+            std::vector<capsule<T>> cap;            ///< 基準座標系の形状
+            std::array<sphere<T>, N+1> bound;       ///< 基準座標系の外接球
+            std::array<bool, N+1> done;             ///< 形状の座標変換済み
+            int hit[2];                             ///< 干渉したリンク対
+        };
+
+        robot_model<T,N> rm;    ///< ロボットモデル
+        T margin = 0;           ///< 干渉とみなす距離
+
+        /**
+         * @brief 生成（形状なし、隣接リンクは干渉許可）
+         */
+        self_collision(const robot_model<T,N>& rm_=robot_model<T,N>())
+        {
+            this->rm = rm_;
+            for(int i=0; i<Nlink; i++)
+                for(int j=0; j<Nlink; j++)
+                    this->acm[i][j] = (std::abs(i-j)<=1);
+            this->build();
+        }
+
+        /**
+         * @brief 関節間を結ぶカプセルで生成
+         * @param [in] rm_ ロボットモデル
+         * @param [in] radius リンクk（k<N）の半径（原点からrm.pos[k]までのカプセル）
+         * @note 関節0の姿勢で接するリンク対（関節オフセット部など）は干渉許可とする
+         */
+        self_collision(const robot_model<T,N>& rm_, T radius) : self_collision(rm_)
+        {
+            for(int k=0; k<N; k++)
+                this->add(k, capsule<T>{vec3<T>(), rm_.pos[k], radius});
+            this->allow_contact(joint<T,N>());
+        }
+
+        /**
+         * @brief カプセルの追加（build()が必要）
+         * @param [in] k リンク番号
+         * @param [in] c リンク座標系のカプセル
+         */
+        void add(int k, const capsule<T>& c)
+        {
+            assert(0<=k && k<Nlink && c.r>=0);
+            this->shape[k].push_back(c);
+        }
+
+        /**
+         * @brief 球の追加（build()が必要）
+         */
+        void add(int k, const vec3<T>& c, T r)
+        {
+            this->add(k, capsule<T>{c, c, r});
+        }
+
+        /**
+         * @brief リンクkの形状（リンク座標系）
+         */
+        const std::vector<capsule<T>>& shapes(int k) const
+        {
+            return this->shape[k];
+        }
+
+        /**
+         * @brief 干渉許可の設定（build()が必要）
+         */
+        void allow(int i, int j, bool flag=true)
+        {
+            assert(0<=i && i<Nlink && 0<=j && j<Nlink);
+            this->acm[i][j] = this->acm[j][i] = flag;
+        }
+
+        /**
+         * @brief 干渉許可の判定
+         */
+        bool allowed(int i, int j) const
+        {
+            return this->acm[i][j];
+        }
+
+        /**
+         * @brief 指定姿勢で干渉するリンク対を干渉許可にして再生成
+         * @param [in] q 関節角（干渉のない姿勢として扱う）
+         * @return 許可したリンク対の数
+         */
+        int allow_contact(const joint<T,N>& q)
+        {
+            this->build();
+            std::array<fpose<T>, N+1> pa = to_pose_array(this->rm, q);
+            int ret = 0;
+            for(const auto& pr : this->pairs)
+            {
+                int i = pr.first, j = pr.second;
+                this->place(pa, i, this->wk, true);
+                this->place(pa, j, this->wk, true);
+                T d = INFINITY;
+                for(int a=this->off[i]; a<this->off[i+1]; a++)
+                    for(int b=this->off[j]; b<this->off[j+1]; b++)
+                        d = std::min(d, distance(this->wk.cap[a], this->wk.cap[b]));
+                if(d <= this->margin)
+                {
+                    this->allow(i, j);
+                    ret++;
+                }
+            }
+            this->build();
+            return ret;
+        }
+
+        /**
+         * @brief 対リスト・外接球・作業領域の生成
+         */
+        void build()
+        {
+            // 形状を連続配列へ
+            this->cap.clear();
+            for(int k=0; k<Nlink; k++)
+            {
+                this->off[k] = this->cap.size();
+                this->cap.insert(this->cap.end(), this->shape[k].begin(), this->shape[k].end());
+            }
+            this->off[Nlink] = this->cap.size();
+
+            // リンクの外接球（端点の包含箱中心）
+            for(int k=0; k<Nlink; k++)
+            {
+                sphere<T>& s = this->bound[k];
+                s.c = vec3<T>();
+                s.r = -INFINITY;
+                if(this->shape[k].empty()) continue;
+                vec3<T> lo(INFINITY, INFINITY, INFINITY), hi(-INFINITY, -INFINITY, -INFINITY);
+                for(const auto& c : this->shape[k])
+                {
+                    for(const vec3<T>* e : {&c.a, &c.b})
+                    {
+                        lo = vec3<T>(std::min(lo.x, e->x), std::min(lo.y, e->y), std::min(lo.z, e->z));
+                        hi = vec3<T>(std::max(hi.x, e->x), std::max(hi.y, e->y), std::max(hi.z, e->z));
+                    }
+                }
+                s.c = (lo + hi)*0.5;
+                for(const auto& c : this->shape[k])
+                    s.r = std::max(s.r, std::max((c.a - s.c).nrm(), (c.b - s.c).nrm()) + c.r);
+            }
+
+            // 判定対象のリンク対
+            this->pairs.clear();
+            for(int i=0; i<Nlink; i++)
+                for(int j=i+1; j<Nlink; j++)
+                    if(!this->acm[i][j] && !this->shape[i].empty() && !this->shape[j].empty())
+                        this->pairs.push_back(std::make_pair(i, j));
+
+            this->init(this->wk);
+            for(auto& w : this->wks) this->init(w);
+        }
+
+        /**
+         * @brief 判定対象のリンク対
+         */
+        const std::vector<std::pair<int,int>>& pair_list() const
+        {
+            return this->pairs;
+        }
+
+        /**
+         * @brief 作業領域の初期化
+         */
+        void init(work& w) const
+        {
+            w.cap.resize(this->cap.size());
+            w.hit[0] = w.hit[1] = -1;
+        }
+
+        /**
+         * @brief リンク座標系から判定
+         * @param [in] pa リンク座標系（to_pose_arrayの出力）
+         * @param [out] dist 最短距離（nullptrで干渉時に打ち切り）
+         * @param [in,out] w 作業領域（init()済み）
+         * @retval true 干渉あり（w.hitに干渉リンク対）
+         */
+        template <typename C>
+        bool check(const C& pa, T *dist, work& w) const
+        {
+            for(int k=0; k<Nlink; k++)
+            {
+                w.done[k] = false;
+                w.bound[k].c = transform<T>(pa[k], this->bound[k].c);
+                w.bound[k].r = this->bound[k].r;
+            }
+
+            T best = INFINITY;
+            bool ret = false;
+            w.hit[0] = w.hit[1] = -1;
+            for(const auto& pr : this->pairs)
+            {
+                int i = pr.first, j = pr.second;
+                const sphere<T>& si = w.bound[i];
+                const sphere<T>& sj = w.bound[j];
+                T cut = dist ? best : this->margin;
+                T dc = (si.c - sj.c).nrm() - si.r - sj.r;
+                if(dc > cut) continue;
+
+                this->place(pa, i, w);
+                this->place(pa, j, w);
+                for(int a=this->off[i]; a<this->off[i+1]; a++)
+                {
+                    for(int b=this->off[j]; b<this->off[j+1]; b++)
+                    {
+                        T d = distance(w.cap[a], w.cap[b]);
+                        if(d < best) best = d;
+                        if(d <= this->margin && !ret)
+                        {
+                            ret = true;
+                            w.hit[0] = i;
+                            w.hit[1] = j;
+                            if(!dist) return true;
+                        }
+                    }
+                }
+            }
+            if(dist) *dist = best;
+            return ret;
+        }
+
+        /**
+         * @brief リンク座標系から判定
+         */
+        template <typename C>
+        bool operator()(const C& pa, T *dist=nullptr)
+        {
+            return this->check(pa, dist, this->wk);
+        }
+
+        /**
+         * @brief 関節角から判定
+         */
+        bool operator()(const joint<T,N>& q, T *dist=nullptr)
+        {
+            return this->check(to_pose_array(this->rm, q), dist, this->wk);
+        }
+
+        /**
+         * @brief 直近に干渉したリンク対
+         */
+        std::pair<int,int> hit() const
+        {
+            return std::make_pair(this->wk.hit[0], this->wk.hit[1]);
+        }
+
+        /**
+         * @brief 一括判定
+         * @param [in] q 関節角配列
+         * @param [in] num 要素数
+         * @param [out] out 要素毎の判定（1で干渉）
+         * @param [out] dist 要素毎の最短距離（nullptrで省略）
+         * @param [in] pool ワーカープール（nullptrで呼び出しスレッドのみ）
+         * @return 干渉した要素数
+         */
+        int operator()(const joint<T,N> q[], int num, unsigned char out[], T dist[]=nullptr, thread_pool *pool=nullptr)
+        {
+            int nw = pool ? pool->size() : 1;
+            if((int)this->wks.size() < nw) this->wks.resize(nw);
+            for(auto& w : this->wks)
+                if(w.cap.size() != this->cap.size()) this->init(w);
+            auto job = [&](int b, int e, int worker)
+            {
+                work& w = this->wks[worker];
+                for(int k=b; k<e; k++)
+                    out[k] = this->check(to_pose_array(this->rm, q[k]), dist ? &dist[k] : nullptr, w);
+            };
+            if(pool) pool->parallel_for(num, job);
+            else     job(0, num, 0);
+
+            int ret = 0;
+            for(int k=0; k<num; k++) ret += out[k];
+            return ret;
+        }
+
+    private:
+        std::array<std::vector<capsule<T>>, N+1> shape;     ///< リンク毎の形状（リンク座標系）
+        std::array<std::array<bool, N+1>, N+1> acm;         ///< 干渉許可行列
+        std::vector<capsule<T>> cap;                        ///< 形状の連続配列
+        std::array<int, N+2> off;                           ///< リンク毎の形状の開始位置
+        std::array<sphere<T>, N+1> bound;                   ///< リンク毎の外接球（リンク座標系）
+        std::vector<std::pair<int,int>> pairs;              ///< 判定対象のリンク対
+        work wk;                                            ///< 単体判定の作業領域
+        std::vector<work> wks;                              ///< 一括判定の作業領域
+
+        /**
+         * @brief リンクkの形状を基準座標系へ
+         */
+        template <typename C>
+        void place(const C& pa, int k, work& w, bool force=false) const
+        {
+            if(w.done[k] && !force) return;
+            for(int a=this->off[k]; a<this->off[k+1]; a++)
+            {
+                w.cap[a].a = transform<T>(pa[k], this->cap[a].a);
+                w.cap[a].b = transform<T>(pa[k], this->cap[a].b);
+                w.cap[a].r = this->cap[a].r;
+            }
+            w.done[k] = true;
+        }
+};
+
+}
@@ -1,3 +1,4 @@
+#pragma once
 #include <robot/bit.h>
 
 namespace kinematics
@@ -80,6 +81,16 @@ union SFLG2
             }
         }
     }
+
+    /**
+     * @brief 回転数取得（4bit符号付き）
+     */
+    int GET(int _n) const
+    {
+        assert(0<=_n && _n<8);
+        int v = (this->val >> (4*_n)) & 0xF;
+        return (v ^ 8) - 8;
+    }
 };
 
 struct SFLG
@@ -88,6 +99,49 @@ struct SFLG
     SFLG2 flg2;
 };
 
+/**
+ * @brief 回転数配列からSFLG2::valを生成（分岐なし）
+ * @param [in] n 回転数(-7～7)
+ * @param [in] naxis 軸数(8以下)
+ */
+inline unsigned int encode_flg2(const int n[], int naxis)
+{
+    unsigned int ret = 0;
+    for(int i=0; i<naxis; i++)
+        ret |= ((unsigned int)n[i] & 0xF) << (4*i);
+    return ret;
+}
+
+/**
+ * @brief SFLG2::valから回転数配列を取得（分岐なし）
+ * @param [in] val SFLG2::val
+ * @param [out] n 回転数
+ * @param [in] naxis 軸数(8以下)
+ */
+inline void decode_flg2(unsigned int val, int n[], int naxis)
+{
+    for(int i=0; i<naxis; i++)
+        n[i] = (int)(((val >> (4*i)) & 0xF) ^ 8) - 8;
+}
+
+/**
+ * @brief SFLG2::val配列から軸毎の回転数配列(SoA)を取得
+ * @param [in] val SFLG2::val配列
+ * @param [in] num 要素数
+ * @param [out] n 軸毎の回転数配列 n[軸][要素]
+ * @param [in] naxis 軸数(8以下)
+ */
+inline void decode_flg2(const unsigned int val[], int num, signed char *n[], int naxis)
+{
+    for(int i=0; i<naxis; i++)
+    {
+        signed char *out = n[i];
+        int sft = 4*i;
+        for(int k=0; k<num; k++)
+            out[k] = (signed char)((int)(((val[k] >> sft) & 0xF) ^ 8) - 8);
+    }
+}
+
 inline std::ostream& operator<<(std::ostream& stream, SFLG1& obj)
 {
     char cData[512];
@@ -0,0 +1,338 @@
+/**
+ * @file singularity.h
+ * @brief 可操作度と特異姿勢の監視（制御周期毎）
+ */
+#pragma once
+#include <robot/jacobian.h>
+#include <robot/geometry.h>
+#include <cstring>
+
+namespace kinematics
+{
+
+/**
+ * @brief 特異姿勢の種別（ビットマスク）
+ */
+enum SINGULARITY
+{
+    SING_NONE = 0,          ///< 特異姿勢から十分遠い
+    SING_WRIST = 1,         ///< 手首特異（第4軸と第6軸が一直線）
+    SING_ELBOW = 2,         ///< 肘特異（腕が伸び切る・折り畳まれる）
+    SING_SHOULDER = 4,      ///< 肩特異（手首中心が第1軸上）
+    SING_CONDITION = 8,     ///< 条件数が上限を超える
+};
+
+/**
+ * @brief 特異姿勢の監視結果
+ */
+template <typename T>
+struct singularity_state
+{
+    T manip = 0;            ///< 可操作度 sqrt(det(J*J^T))
+    T cond = INFINITY;      ///< 条件数（姿勢行をlength倍したヤコビ行列の最大/最小特異値）
+    T wrist = 0;            ///< 手首特異までの距離 |det[w4 w5 w6]|（=|sin(q5)|）
+    T elbow = 0;            ///< 肘特異までの距離（肘の折れ角の|sin|）
+    T shoulder = 0;         ///< 肩特異までの距離[m]（手首中心と第1軸の腕平面内の距離）
+    T eta = INFINITY;       ///< 警告域に入るまでの推定周期数（指標毎に前周期からの変化率で外挿した最小値、近づく指標なしでINFINITY）
+    unsigned int flags = SING_NONE;     ///< 警告域に入っている特異姿勢（SINGULARITYの和）
+};
+
+/**
+ * @brief 特異姿勢の監視クラス
+ * @details 同周期で計算済みのFK座標系から、可操作度・条件数・既知の特異姿勢までの距離を求める。
+ *          ヤコビ行列の列は基準原点まわりのPlucker座標 s_i = (p_i x w_i, w_i) で保持する。
+ *          s_iは座標系i+1のみで決まるため、前周期から変化していない座標系（変化した最初の関節より
+ *          根元側）の列と、列の外積の累積和 G_k = sum_{i<k} s_i s_i^T を再利用し、変化した関節以降のみ
+ *          更新する。手先位置peでのヤコビ行列は J = X(pe) S（Xは行列式1のせん断）のため、
+ *          可操作度はGのみから、条件数は X G X^T の固有値（6x6対称行列のJacobi法）から求める。
+ *          特異姿勢の距離は6軸・球面手首（第5軸原点が手首中心）の腕を前提とし、
+ *          それ以外の軸数ではNANとする。演算は固定回数のループのみで確保は発生しない。
+ * @tparam N 軸数
+ */
+template <typename T, int N=Naxis>
+class singularity_monitor
+{
+    public:
+        T length = 0.5;             ///< 条件数の姿勢行の尺度[m]
+        T warn_wrist = 0.15;        ///< 手首特異の警告距離
+        T warn_elbow = 0.15;        ///< 肘特異の警告距離
+        T warn_shoulder = 0.05;     ///< 肩特異の警告距離[m]
+        T warn_cond = 200;          ///< 条件数の警告値
+        int reused = 0;             ///< 直前の更新で再利用した列数
+
+        /**
+         * @brief 生成
+         * @param [in] rm ロボットモデル
+         */
+        singularity_monitor(const robot_model<T,N>& rm=robot_model<T,N>())
+        {
+            this->alfa = rm.alfa;
+            this->type = rm.type;
+            this->reset();
+        }
+
+        /**
+         * @brief 再利用する列・変化率の履歴を破棄
+         */
+        void reset()
+        {
+            this->cur.valid = 0;
+            this->ahead.valid = 0;
+            this->first = true;
+        }
+
+        /**
+         * @brief 直近の監視結果
+         */
+        const singularity_state<T>& state() const
+        {
+            return this->st;
+        }
+
+        /**
+         * @brief 計算済みFK座標系から更新（末尾要素を手先とする）
+         */
+        template <typename C>
+        const singularity_state<T>& operator()(const C& pa)
+        {
+            return (*this)(pa, pa.back().p);
+        }
+
+        /**
+         * @brief 計算済みFK座標系と手先位置から更新
+         * @param [in] pa 座標系配列(to_pose_array) 要素数は軸数+1以上
+         * @param [in] pe 手先位置（ツール先端など、基準座標系）
+         * @return 監視結果
+         */
+        template <typename C>
+        const singularity_state<T>& operator()(const C& pa, const vec3<T>& pe)
+        {
+            this->reused = this->evaluate(pa, pe, this->cur, this->st);
+
+            // 指標毎に前周期からの変化率で警告域までの周期数を外挿し、最小値をとる
+            T r[4];
+            this->ratio(this->st, r);
+            this->st.eta = INFINITY;
+            for(int k=0; k<4; k++)
+            {
+                if(r[k] <= 1)                               this->st.eta = 0;
+                else if(!this->first && r[k] < this->prev[k])
+                    this->st.eta = std::min(this->st.eta, (r[k] - 1)/(this->prev[k] - r[k]));
+                this->prev[k] = r[k];
+            }
+            this->first = false;
+            return this->st;
+        }
+
+        /**
+         * @brief 今後の周期の関節角で警告を予測
+         * @details 周期毎に順運動学から監視結果を求め（直近の監視結果・再利用する列は変えない）、
+         *          最初に警告域に入る周期を返す。
+         * @param [in] rm ロボットモデル
+         * @param [in] q 今後の周期の関節角
+         * @param [in] num 周期数
+         * @param [out] out 周期毎の監視結果（nullptrで省略、num要素）
+         * @param [in] tool ツール座標系（手先位置の計算用）
+         * @return 最初に警告域に入る周期の番号 警告なしで-1
+         */
+        int forecast(const robot_model<T,N>& rm, const joint<T,N> q[], int num, singularity_state<T> *out=nullptr, const pose<T>& tool=pose<T>())
+        {
+            int ret = -1;
+            singularity_state<T> s;
+            for(int k=0; k<num; k++)
+            {
+                std::array<fpose<T>, N+1> pa = to_pose_array(rm, q[k]);
+                this->evaluate(pa, transform<T>(pa[N], tool.p), this->ahead, s);
+                if(out) out[k] = s;
+                if(s.flags && ret<0)
+                {
+                    ret = k;
+                    if(!out) break;
+                }
+            }
+            return ret;
+        }
+
+    private:
+        /**
+         * @brief 列と累積和の作業領域
+         */
+        struct cache
+        {
+            std::array<pose<T>, N> frame;       ///< 列の計算に使った座標系（pa[i+1]）
+            std::array<T[6], N> s;              ///< Plucker座標の列 (p x w, w)
+            std::array<T[6][6], N+1> G;         ///< 列の外積の累積和（G[0]=0）
+            int valid;                          ///< 有効な列数
+        };
+
+        std::array<vec3<T>, N> alfa;        ///< 関節軸（リンク座標系）
+        std::array<JOINT_TYPE, N> type;     ///< 関節種別
+        cache cur;                          ///< 制御周期の作業領域
+        cache ahead;                        ///< 予測の作業領域
+        singularity_state<T> st;            ///< 直近の監視結果
+        bool first;                         ///< 変化率の履歴なし
+        T prev[4];                          ///< 前周期の警告距離に対する比
+
+        /**
+         * @brief 警告距離に対する比（1未満で警告域）
+         */
+        void ratio(const singularity_state<T>& s, T r[4]) const
+        {
+            r[0] = s.wrist/this->warn_wrist;
+            r[1] = s.elbow/this->warn_elbow;
+            r[2] = s.shoulder/this->warn_shoulder;
+            r[3] = this->warn_cond/s.cond;
+        }
+
+        /**
+         * @brief 監視結果の計算
+         * @return 再利用した列数
+         */
+        template <typename C>
+        int evaluate(const C& pa, const vec3<T>& pe, cache& c, singularity_state<T>& s) const
+        {
+            assert((int)pa.size() > N);
+
+            // 座標系が変化した最初の関節から列と累積和を更新
+            int j = 0;
+            while(j < c.valid && same(c.frame[j], pa[j+1])) j++;
+            if(j==0)
+                for(int r=0; r<6; r++)
+                    for(int k=0; k<6; k++) c.G[0][r][k] = 0;
+            for(int i=j; i<N; i++)
+            {
+                const pose<T>& f = pa[i+1];
+                c.frame[i] = f;
+                vec4<T> q = f.q;
+                vec3<T> w = q.Trans(this->alfa[i], false);
+                vec3<T> m = (this->type[i]==PRISMATIC) ? w : f.p % w;
+                if(this->type[i]==PRISMATIC) w = vec3<T>();
+                T* col = c.s[i];
+                col[0] = m.x; col[1] = m.y; col[2] = m.z;
+                col[3] = w.x; col[4] = w.y; col[5] = w.z;
+                for(int r=0; r<6; r++)
+                    for(int k=0; k<=r; k++) c.G[i+1][r][k] = c.G[i][r][k] + col[r]*col[k];
+            }
+            c.valid = N;
+            T G[6][6];
+            for(int r=0; r<6; r++)
+                for(int k=0; k<=r; k++) G[r][k] = G[k][r] = c.G[N][r][k];
+
+            // 可操作度（det(X)=1のため基準点によらない）
+            T A[6][6], b[6] = {0, 0, 0, 0, 0, 0};
+            memcpy(A, G, sizeof(A));
+            s.manip = 0;
+            if(chol6(A, b))
+            {
+                s.manip = 1;
+                for(int r=0; r<6; r++) s.manip *= A[r][r];
+            }
+
+            // 条件数（手先位置まわり、姿勢行をlength倍）
+            // J = D X S, X = [I -[pe]x; 0 I], D = diag(1,1,1,L,L,L)
+            T M[6][6];
+            const T px[3][3] = {{0, -pe.z, pe.y}, {pe.z, 0, -pe.x}, {-pe.y, pe.x, 0}};
+            for(int r=0; r<6; r++)          // M = X*G
+                for(int k=0; k<6; k++)
+                {
+                    T x = G[r][k];
+                    if(r<3) for(int l=0; l<3; l++) x -= px[r][l]*G[3+l][k];
+                    M[r][k] = x;
+                }
+            for(int r=0; r<6; r++)          // A = M*X^T*D^2（対称）
+                for(int k=0; k<=r; k++)
+                {
+                    T x = M[r][k];
+                    if(k<3) for(int l=0; l<3; l++) x -= M[r][3+l]*px[k][l];
+                    T d = ((r<3) ? 1 : this->length)*((k<3) ? 1 : this->length);
+                    A[r][k] = A[k][r] = d*x;
+                }
+            T lmin, lmax;
+            eigen_range(A, lmin, lmax);
+            s.cond = (lmin > lmax*1e-30) ? sqrt(lmax/lmin) : INFINITY;
+
+            // 既知の特異姿勢までの距離（6軸・球面手首）
+            if(N==6)
+            {
+                vec3<T> w[N];
+                for(int i=0; i<N; i++) w[i] = vec3<T>(c.s[i][3], c.s[i][4], c.s[i][5]);
+                const vec3<T> wc = pa[N-1].p;       // 手首中心（第5軸原点）
+                s.wrist = std::abs((w[3] % w[4])*w[5]);
+
+                vec3<T> a = pa[3].p - pa[2].p, e = wc - pa[3].p;
+                vec3<T> ap = a - w[1]*(a*w[1]), ep = e - w[1]*(e*w[1]);
+                T den = ap.nrm()*ep.nrm();
+                s.elbow = (den > 0) ? std::abs((a % e)*w[1])/den : 0;
+
+                vec3<T> r = w[0] % w[1];
+                T rn = r.nrm();
+                s.shoulder = (rn > 0) ? std::abs((wc - pa[1].p)*r)/rn : 0;
+            }
+            else
+            {
+                s.wrist = s.elbow = s.shoulder = NAN;
+            }
+
+            s.flags = SING_NONE;
+            if(s.wrist < this->warn_wrist)          s.flags |= SING_WRIST;
+            if(s.elbow < this->warn_elbow)          s.flags |= SING_ELBOW;
+            if(s.shoulder < this->warn_shoulder)    s.flags |= SING_SHOULDER;
+            if(!(s.cond <= this->warn_cond))        s.flags |= SING_CONDITION;
+            return j;
+        }
+
+        /**
+         * @brief 座標系の一致（同じ関節角から計算したものは完全に一致する）
+         */
+        static bool same(const pose<T>& a, const pose<T>& b)
+        {
+            return a.p.x==b.p.x && a.p.y==b.p.y && a.p.z==b.p.z
+                && a.q.x==b.q.x && a.q.y==b.q.y && a.q.z==b.q.z && a.q.w==b.q.w;
+        }
+
+        /**
+         * @brief 6x6対称行列の最小・最大固有値（巡回Jacobi法）
+         * @param [in,out] A 対称行列（対角化で上書き）
+         */
+        static void eigen_range(T A[6][6], T& lmin, T& lmax)
+        {
+            for(int sweep=0; sweep<12; sweep++)
+            {
+                T off = 0, diag = 0;
+                for(int p=0; p<6; p++)
+                {
+                    diag += A[p][p]*A[p][p];
+                    for(int q=p+1; q<6; q++) off += A[p][q]*A[p][q];
+                }
+                if(off <= 1e-30*diag) break;
+                for(int p=0; p<5; p++)
+                    for(int q=p+1; q<6; q++)
+                    {
+                        if(A[p][q]==0) continue;
+                        T theta = (A[q][q] - A[p][p])/(2*A[p][q]);
+                        T t = (theta>=0 ? 1 : -1)/(std::abs(theta) + sqrt(theta*theta + 1));
+                        T c = 1/sqrt(t*t + 1), s = t*c;
+                        for(int k=0; k<6; k++)
+                        {
+                            T akp = A[k][p], akq = A[k][q];
+                            A[k][p] = c*akp - s*akq;
+                            A[k][q] = s*akp + c*akq;
+                        }
+                        for(int k=0; k<6; k++)
+                        {
+                            T apk = A[p][k], aqk = A[q][k];
+                            A[p][k] = c*apk - s*aqk;
+                            A[q][k] = s*apk + c*aqk;
+                        }
+                    }
+            }
+            lmin = lmax = A[0][0];
+            for(int p=1; p<6; p++)
+            {
+                lmin = std::min(lmin, A[p][p]);
+                lmax = std::max(lmax, A[p][p]);
+            }
+        }
+};
+
+}
@@ -0,0 +1,270 @@
+/**
+ * @file spline.h
+ * @brief 関節空間の3次スプライン・一様3次Bスプライン軌道
+ */
+#pragma once
+#include <robot/joint.h>
+#include <vector>
+
+namespace kinematics
+{
+
+/**
+ * @brief SIMDレーン数（256bit）
+ */
+template <typename T>
+struct simd_width
+{
+    static const int value = 32/sizeof(T);
+};
+
+/**
+ * @brief 関節空間の区分3次多項式軌道
+ * @details 区間毎の係数を次数毎に全軸を並べ（軸インターリーブ）、
+ *          軸数をSIMDレーン数の倍数Npに詰め物して保持する。
+ *          評価は全軸同時の多項式1段（分岐なしのNpレーンループ）で、
+ *          区間探索は一様ノットでは除算、非一様では前回区間からの探索となる。
+ *          生成は端点速度指定の3次スプライン補間と一様3次Bスプラインの2通り。
+ * @tparam N 軸数
+ */
+template <typename T, int N=Naxis>
+class joint_spline
+{
+    public:
+        static const int W = simd_width<T>::value;  ///< SIMDレーン数
+        static const int Np = (N+W-1)/W*W;          ///< 詰め物込みの軸数
+
+        /**
+         * @brief 区間の係数 c[次数][軸]（区間開始からの経過時間の多項式）
+         */
+        struct block
+        {
+            T c[4][Np];
+        };
+
+        std::vector<T> knot;        ///< ノット（区間数+1）
+        std::vector<block> coef;    ///< 区間係数
+
+        /**
+         * @brief 区間数
+         */
+        int size() const
+        {
+            return this->coef.size();
+        }
+
+        /**
+         * @brief 3次スプライン補間
+         * @param [in] t 時刻（狭義単調増加）
+         * @param [in] q 経由点
+         * @param [in] n 経由点数（2以上）
+         * @param [in] v0 始点速度
+         * @param [in] v1 終点速度
+         */
+        void interpolate(const T t[], const joint<T,N> q[], int n, const joint<T,N>& v0=joint<T,N>(), const joint<T,N>& v1=joint<T,N>())
+        {
+            assert(n>=2);
+            this->resize(n-1);
+            for(int i=0; i<n; i++) this->knot[i] = t[i];
+            this->set_uniform();
+
+            // 速度 m を未知数とする三重対角系をThomas法で解く（行列は全軸共通）
+            std::vector<T> up(n);
+            std::vector<joint<T,N>> m(n);
+            m[0] = v0;
+            m[n-1] = v1;
+            up[0] = 0;
+            for(int i=1; i<n-1; i++)
+            {
+                T h0 = t[i]-t[i-1], h1 = t[i+1]-t[i];
+                assert(h0>0 && h1>0);
+                T lo = h1;                      // m[i-1]の係数
+                T d  = 2*(h0+h1) - lo*up[i-1];  // 前進消去
+                for(int j=0; j<N; j++)
+                {
+                    T r = 3*(h1*(q[i].val[j]-q[i-1].val[j])/h0 + h0*(q[i+1].val[j]-q[i].val[j])/h1);
+                    if(i==1)   r -= h1*v0.val[j];
+                    else       r -= lo*m[i-1].val[j];
+                    if(i==n-2) r -= h0*v1.val[j];
+                    m[i].val[j] = r/d;
+                }
+                up[i] = (i<n-2) ? h0/d : 0;
+            }
+            for(int i=n-3; i>=1; i--)
+                for(int j=0; j<N; j++)
+                    m[i].val[j] -= up[i]*m[i+1].val[j];
+
+            for(int i=0; i<n-1; i++)
+            {
+                T h = t[i+1]-t[i];
+                block& b = this->coef[i];
+                for(int j=0; j<N; j++)
+                {
+                    T dl = (q[i+1].val[j]-q[i].val[j])/h;
+                    b.c[0][j] = q[i].val[j];
+                    b.c[1][j] = m[i].val[j];
+                    b.c[2][j] = (3*dl - 2*m[i].val[j] - m[i+1].val[j])/h;
+                    b.c[3][j] = (m[i].val[j] + m[i+1].val[j] - 2*dl)/(h*h);
+                }
+            }
+        }
+
+        /**
+         * @brief 一様3次Bスプライン
+         * @param [in] t0 開始時刻
+         * @param [in] dt ノット間隔
+         * @param [in] p 制御点
+         * @param [in] n 制御点数（4以上、区間数はn-3）
+         */
+        void bspline(T t0, T dt, const joint<T,N> p[], int n)
+        {
+            assert(n>=4 && dt>0);
+            this->resize(n-3);
+            for(int i=0; i<=n-3; i++) this->knot[i] = t0 + dt*i;
+            this->set_uniform();
+
+            // 基底行列（u = tau/dt のべき）を時間のべきへ変換
+            const T s1 = 1/dt, s2 = s1*s1, s3 = s2*s1;
+            for(int i=0; i<n-3; i++)
+            {
+                block& b = this->coef[i];
+                for(int j=0; j<N; j++)
+                {
+                    T P0 = p[i].val[j], P1 = p[i+1].val[j], P2 = p[i+2].val[j], P3 = p[i+3].val[j];
+                    b.c[0][j] = (P0 + 4*P1 + P2)/6;
+                    b.c[1][j] = (-P0 + P2)/2*s1;
+                    b.c[2][j] = (P0 - 2*P1 + P2)/2*s2;
+                    b.c[3][j] = (-P0 + 3*P1 - 3*P2 + P3)/6*s3;
+                }
+            }
+        }
+
+        /**
+         * @brief 開始時刻
+         */
+        T t_begin() const
+        {
+            return this->knot.front();
+        }
+
+        /**
+         * @brief 終了時刻
+         */
+        T t_end() const
+        {
+            return this->knot.back();
+        }
+
+        /**
+         * @brief 時刻tの区間番号（範囲外は端の区間）
+         */
+        int find(T t)
+        {
+            int n = this->size();
+            int i;
+            if(this->uniform)
+            {
+                i = (int)std::floor((t - this->knot[0])*this->idt);
+                i = std::min(std::max(i, 0), n-1);
+            }
+            else
+            {
+                // 時刻は単調増加が主なので前回区間から探索
+                i = this->hint;
+                while(i>0 && t<this->knot[i]) i--;
+                while(i<n-1 && t>=this->knot[i+1]) i++;
+            }
+            this->hint = i;
+            return i;
+        }
+
+        /**
+         * @brief 軌道評価
+         * @param [in] t 時刻（範囲外は端の区間の多項式を外挿せず端点で飽和）
+         * @param [out] q 関節角
+         * @param [out] v 関節速度
+         * @param [out] a 関節加速度
+         */
+        void eval(T t, joint<T,N>& q, joint<T,N>& v, joint<T,N>& a)
+        {
+            T pq[Np], pv[Np], pa[Np];
+            this->lanes(t, pq, pv, pa);
+            std::copy(pq, pq+N, q.val.begin());
+            std::copy(pv, pv+N, v.val.begin());
+            std::copy(pa, pa+N, a.val.begin());
+        }
+
+        /**
+         * @brief 関節角のみ評価
+         */
+        joint<T,N> operator()(T t)
+        {
+            joint<T,N> q, v, a;
+            this->eval(t, q, v, a);
+            return q;
+        }
+
+        /**
+         * @brief 一括評価（軸毎の配列に出力）
+         * @param [in] t 時刻配列
+         * @param [in] num 要素数
+         * @param [out] q 関節角 q[軸][要素]
+         * @param [out] v 関節速度 v[軸][要素]（nullptrで省略）
+         * @param [out] a 関節加速度 a[軸][要素]（nullptrで省略）
+         */
+        void eval(const T t[], int num, T* const q[], T* const v[]=nullptr, T* const a[]=nullptr)
+        {
+            T pq[Np], pv[Np], pa[Np];
+            for(int k=0; k<num; k++)
+            {
+                this->lanes(t[k], pq, pv, pa);
+                for(int j=0; j<N; j++) q[j][k] = pq[j];
+                if(v) for(int j=0; j<N; j++) v[j][k] = pv[j];
+                if(a) for(int j=0; j<N; j++) a[j][k] = pa[j];
+            }
+        }
+
+    private:
+        bool uniform = false;   ///< 一様ノット
+        T idt = 0;              ///< 一様ノット間隔の逆数
+        int hint = 0;           ///< 区間探索の開始番号
+
+        void resize(int nseg)
+        {
+            this->knot.resize(nseg+1);
+            this->coef.resize(nseg);
+            for(auto& b : this->coef)
+                for(int k=0; k<4; k++) std::fill(b.c[k], b.c[k]+Np, (T)0);
+            this->hint = 0;
+        }
+
+        void set_uniform()
+        {
+            int n = this->size();
+            T dt = (this->knot[n] - this->knot[0])/n;
+            this->uniform = true;
+            for(int i=0; i<n; i++)
+                if(std::abs(this->knot[i+1]-this->knot[i]-dt) > 1e-12*std::max(std::abs(dt), (T)1)) this->uniform = false;
+            this->idt = 1/dt;
+        }
+
+        /**
+         * @brief 全レーンの多項式評価
+         */
+        void lanes(T t, T pq[], T pv[], T pa[])
+        {
+            T tc = std::min(std::max(t, this->t_begin()), this->t_end());
+            int i = this->find(tc);
+            const block& b = this->coef[i];
+            const T d = tc - this->knot[i];
+            const T stop = (t==tc) ? 1 : 0;     // 範囲外は静止
+            for(int j=0; j<Np; j++)
+            {
+                pq[j] = b.c[0][j] + d*(b.c[1][j] + d*(b.c[2][j] + d*b.c[3][j]));
+                pv[j] = (b.c[1][j] + d*(2*b.c[2][j] + 3*d*b.c[3][j]))*stop;
+                pa[j] = (2*b.c[2][j] + 6*d*b.c[3][j])*stop;
+            }
+        }
+};
+
+}
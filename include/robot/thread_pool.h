@@ -0,0 +1,145 @@
+/**
+ * @file thread_pool.h
+ * @brief 固定スレッド数のワーカープール
+ */
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <vector>
+#include <algorithm>
+
+namespace kinematics
+{
+
+/**
+ * @brief ワーカープール
+ * @details 生成時にスレッドを起動し、parallel_forごとに区間をチャンク単位で配る。
+ *          呼び出しスレッドも処理に参加し、全区間の完了まで戻らない。
+ */
+class thread_pool
+{
+    public:
+        /**
+         * @brief 区間処理関数 func(begin, end, worker)
+         * @details workerは0～size()-1のワーカー番号（ワーカー毎の作業領域の選択用）
+         */
+        typedef std::function<void(int, int, int)> job_t;
+
+        /**
+         * @brief 生成
+         * @param [in] n 総ワーカー数（呼び出しスレッドを含む）0でハードウェアスレッド数
+         */
+        thread_pool(int n=0)
+        {
+            if(n<=0) n = std::max(1, (int)std::thread::hardware_concurrency());
+            this->stop = false;
+            this->generation = 0;
+            for(int i=1; i<n; i++)
+                this->threads.push_back(std::thread(&thread_pool::worker, this, i));
+        }
+
+        ~thread_pool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(this->mtx);
+                this->stop = true;
+            }
+            this->cv_job.notify_all();
+            for(auto &t : this->threads) t.join();
+        }
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        /**
+         * @brief 総ワーカー数
+         */
+        int size() const
+        {
+            return this->threads.size()+1;
+        }
+
+        /**
+         * @brief 区間[0,n)の並列処理
+         * @param [in] n 要素数
+         * @param [in] func 区間処理関数
+         * @param [in] grain チャンクサイズ（0で自動）
+         */
+        void parallel_for(int n, const job_t& func, int grain=0)
+        {
+            if(n<=0) return;
+            if(grain<=0) grain = std::max(1, n/(8*size()));
+            if(this->threads.empty() || n<=grain)
+            {
+                func(0, n, 0);
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(this->mtx);
+                this->job = &func;
+                this->n_total = n;
+                this->n_grain = grain;
+                this->next = 0;
+                this->active = this->threads.size();
+                this->generation++;
+            }
+            this->cv_job.notify_all();
+
+            this->run(0);
+
+            std::unique_lock<std::mutex> lock(this->mtx);
+            this->cv_done.wait(lock, [this]{ return this->active==0; });
+            this->job = nullptr;
+        }
+
+    private:
+        std::vector<std::thread> threads;
+        std::mutex mtx;
+        std::condition_variable cv_job;
+        std::condition_variable cv_done;
+        bool stop;
+        unsigned long generation;       ///< 投入済みジョブ番号
+        const job_t *job = nullptr;     ///< 実行中ジョブ
+        int n_total = 0;
+        int n_grain = 1;
+        std::atomic<int> next;          ///< 次に配るチャンク先頭
+        int active = 0;                 ///< 実行中ワーカー数（呼び出しスレッド除く）
+
+        /**
+         * @brief チャンクを取り尽くすまで処理
+         */
+        void run(int id)
+        {
+            while(true)
+            {
+                int b = this->next.fetch_add(this->n_grain);
+                if(b >= this->n_total) break;
+                (*this->job)(b, std::min(b+this->n_grain, this->n_total), id);
+            }
+        }
+
+        void worker(int id)
+        {
+            unsigned long seen = 0;
+            while(true)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(this->mtx);
+                    this->cv_job.wait(lock, [&]{ return this->stop || this->generation!=seen; });
+                    if(this->stop) return;
+                    seen = this->generation;
+                }
+                this->run(id);
+                {
+                    std::lock_guard<std::mutex> lock(this->mtx);
+                    if(--this->active==0) this->cv_done.notify_one();
+                }
+            }
+        }
+};
+
+}
@@ -0,0 +1,285 @@
+/**
+ * @file topp.h
+ * @brief 関節経路の時間最適な時間配分（到達可能性解析）
+ */
+#pragma once
+#include <robot/joint_limit.h>
+
+namespace kinematics
+{
+
+/**
+ * @brief 関節経路の時間最適化クラス
+ * @details 経由点を弦長パラメータsの格子とし、x=ds/dt^2, u=d^2s/dt^2 に関する
+ *          速度・加速度制約の下で TOPP-RA（到達可能性解析）により時間配分を求める。
+ *          - 経路微分 q'(s), q''(s) は経由点の差分で求め、軸毎の配列(SoA)に保持
+ *          - 後退パスで各格子の可制御集合の上限 x <= K[i] を求める
+ *            （制約は軸毎の u の上下限で、x と u の2変数LPを上下限の組で閉形式に解く）
+ *          - 前進パスで可制御集合内の最大加速度を選ぶ
+ *          作業領域は経由点数が増えたときのみ確保する。
+ * @tparam N 軸数
+ */
+template <typename T, int N=Naxis>
+class topp
+{
+    public:
+        joint_limit<T,N> lim;   ///< 速度・加速度制約（vmax, amaxを使用）
+        std::vector<T> s;       ///< 格子の経路パラメータ（弦長）
+        std::vector<T> sd;      ///< 格子の経路速度 ds/dt
+        std::vector<T> sdd;     ///< 格子の経路加速度 d^2s/dt^2
+        std::vector<T> t;       ///< 格子の時刻
+
+        /**
+         * @brief 生成
+         * @param [in] lim_ 制約（vmax, amaxを使用、有限値）
+         */
+        topp(const joint_limit<T,N>& lim_)
+        {
+            this->lim = lim_;
+            for(int j=0; j<N; j++)
+                assert(std::isfinite(lim_.vmax.val[j]) && std::isfinite(lim_.amax.val[j]));
+        }
+
+        /**
+         * @brief 時間配分（静止から静止）
+         * @param [in] wp 経由点
+         * @param [in] n 経由点数
+         * @return 所要時間 実行不能でNAN
+         */
+        T operator()(const joint<T,N> wp[], int n)
+        {
+            assert(n>=2);
+            this->resize(n);
+            this->derivative(wp, n);
+            this->backward(n);
+            if(!this->forward(n)) return NAN;
+            return this->t[n-1];
+        }
+
+        /**
+         * @brief 時間配分（静止から静止）
+         */
+        T operator()(const std::vector<joint<T,N>>& wp)
+        {
+            return (*this)(&wp[0], wp.size());
+        }
+
+        /**
+         * @brief 格子iの関節速度
+         */
+        joint<T,N> velocity(int i) const
+        {
+            joint<T,N> ret;
+            for(int j=0; j<N; j++) ret.val[j] = this->a[j][i]*this->sd[i];
+            return ret;
+        }
+
+        /**
+         * @brief 格子iの関節加速度
+         */
+        joint<T,N> acceleration(int i) const
+        {
+            joint<T,N> ret;
+            for(int j=0; j<N; j++)
+                ret.val[j] = this->a[j][i]*this->sdd[i] + this->b[j][i]*this->sd[i]*this->sd[i];
+            return ret;
+        }
+
+    private:
+        std::array<std::vector<T>, N> a;    ///< q'(s) a[軸][格子]
+        std::array<std::vector<T>, N> b;    ///< q''(s) b[軸][格子]
+        std::vector<T> xmax;                ///< 可制御集合の上限
+        std::vector<T> x;                   ///< 前進パスの x = sd^2
+        std::vector<int> nb0, nb1;          ///< 差分に使う前後の格子
+
+        void resize(int n)
+        {
+            if((int)this->s.size() >= n) return;
+            this->s.resize(n);
+            this->sd.resize(n);
+            this->sdd.resize(n);
+            this->t.resize(n);
+            this->xmax.resize(n);
+            this->x.resize(n);
+            this->nb0.resize(n);
+            this->nb1.resize(n);
+            for(int j=0; j<N; j++)
+            {
+                this->a[j].resize(n);
+                this->b[j].resize(n);
+            }
+        }
+
+        /**
+         * @brief 弦長パラメータと経路微分
+         */
+        void derivative(const joint<T,N> wp[], int n)
+        {
+            this->s[0] = 0;
+            for(int i=1; i<n; i++)
+            {
+                T d2 = 0;
+                for(int j=0; j<N; j++)
+                {
+                    T d = wp[i].val[j] - wp[i-1].val[j];
+                    d2 += d*d;
+                }
+                this->s[i] = this->s[i-1] + sqrt(d2);
+            }
+
+            // 軸方向の差分（重複点は前後の異なる点で差分）
+            for(int i=0; i<n; i++)
+            {
+                int i0 = std::max(i-1, 0);
+                int i1 = std::min(i+1, n-1);
+                while(i0>0 && this->s[i0]==this->s[i]) i0--;
+                while(i1<n-1 && this->s[i1]==this->s[i]) i1++;
+                this->nb0[i] = i0;
+                this->nb1[i] = i1;
+            }
+            for(int j=0; j<N; j++)
+            {
+                T *aj = &this->a[j][0];
+                T *bj = &this->b[j][0];
+                for(int i=0; i<n; i++)
+                {
+                    int i0 = this->nb0[i];
+                    int i1 = this->nb1[i];
+                    T h0 = this->s[i] - this->s[i0];
+                    T h1 = this->s[i1] - this->s[i];
+                    T g0 = (h0>0) ? (wp[i].val[j] - wp[i0].val[j])/h0 : 0;
+                    T g1 = (h1>0) ? (wp[i1].val[j] - wp[i].val[j])/h1 : 0;
+                    T h = h0 + h1;
+                    aj[i] = (h>0) ? (wp[i1].val[j] - wp[i0].val[j])/h : 0;
+                    bj[i] = (h0>0 && h1>0) ? 2*(g1 - g0)/h : 0;
+                }
+            }
+        }
+
+        /**
+         * @brief 格子iの u の上下限（x の1次式 c0 + c1*x）
+         * @param [out] lo0,lo1 下限の係数（要素N+1）
+         * @param [out] hi0,hi1 上限の係数（要素N+1）
+         * @param [in] H 次の格子の可制御集合上限
+         * @param [in] D 次の格子までの区間長
+         * @return 加速度制約による x の上限（q'=0の軸）
+         */
+        T bounds(int i, T H, T D, T lo0[], T lo1[], T hi0[], T hi1[]) const
+        {
+            T xa = INFINITY;
+            for(int j=0; j<N; j++)
+            {
+                T aj = this->a[j][i];
+                T bj = this->b[j][i];
+                T am = this->lim.amax.val[j];
+                if(std::abs(aj) > 1e-12)
+                {
+                    T ia = 1/aj;
+                    T r = std::abs(am*ia);
+                    lo0[j] = -r;  lo1[j] = -bj*ia;
+                    hi0[j] =  r;  hi1[j] = -bj*ia;
+                }
+                else
+                {
+                    lo0[j] = -INFINITY; lo1[j] = 0;
+                    hi0[j] =  INFINITY; hi1[j] = 0;
+                    if(std::abs(bj) > 0) xa = std::min(xa, am/std::abs(bj));
+                }
+            }
+            // 次の格子の可制御集合 0 <= x + 2Du <= H
+            lo0[N] = 0;       lo1[N] = -0.5/D;
+            hi0[N] = 0.5*H/D; hi1[N] = -0.5/D;
+            return xa;
+        }
+
+        /**
+         * @brief 後退パス（可制御集合）
+         */
+        void backward(int n)
+        {
+            T lo0[N+1], lo1[N+1], hi0[N+1], hi1[N+1];
+
+            // 速度制約 |q' sd| <= vmax
+            this->xvel(n);
+
+            this->xmax[n-1] = 0;
+            for(int i=n-2; i>=0; i--)
+            {
+                T D = this->s[i+1] - this->s[i];
+                if(!(D>0))
+                {
+                    this->xmax[i] = std::min(this->xmax[i], this->xmax[i+1]);
+                    continue;
+                }
+                T xm = std::min(this->xmax[i], this->bounds(i, this->xmax[i+1], D, lo0, lo1, hi0, hi1));
+
+                // 全ての下限 <= 全ての上限 となる x の上限
+                for(int k=0; k<=N; k++)
+                {
+                    for(int m=0; m<=N; m++)
+                    {
+                        T c = lo1[k] - hi1[m];
+                        T r = hi0[m] - lo0[k];
+                        if(c > 1e-15) xm = std::min(xm, r/c);
+                    }
+                }
+                this->xmax[i] = std::max(xm, (T)0);
+            }
+        }
+
+        /**
+         * @brief 速度制約による x の上限（軸毎の連続配列で一括計算）
+         */
+        void xvel(int n)
+        {
+            T *xm = &this->xmax[0];
+            for(int i=0; i<n; i++) xm[i] = INFINITY;
+            for(int j=0; j<N; j++)
+            {
+                const T *aj = &this->a[j][0];
+                const T v2 = this->lim.vmax.val[j]*this->lim.vmax.val[j];
+                for(int i=0; i<n; i++)
+                    xm[i] = std::min(xm[i], v2/(aj[i]*aj[i]));
+            }
+        }
+
+        /**
+         * @brief 前進パス（最大加速度）と時刻
+         * @retval false 区間内で停止したまま進めない（実行不能）
+         */
+        bool forward(int n)
+        {
+            T lo0[N+1], lo1[N+1], hi0[N+1], hi1[N+1];
+            this->x[0] = 0;
+            this->t[0] = 0;
+            for(int i=0; i<n-1; i++)
+            {
+                T D = this->s[i+1] - this->s[i];
+                T xi = this->x[i];
+                T u = 0;
+                if(D>0)
+                {
+                    this->bounds(i, this->xmax[i+1], D, lo0, lo1, hi0, hi1);
+                    T ulo = -INFINITY, uhi = INFINITY;
+                    for(int k=0; k<=N; k++)
+                    {
+                        ulo = std::max(ulo, lo0[k] + lo1[k]*xi);
+                        uhi = std::min(uhi, hi0[k] + hi1[k]*xi);
+                    }
+                    u = uhi;    // 可制御集合内ではulo<=uhi（数値誤差は次の飽和で吸収）
+                }
+                T x1 = std::min(std::max(xi + 2*D*u, (T)0), this->xmax[i+1]);
+                this->x[i+1] = x1;
+                this->sdd[i] = u;
+
+                T v = sqrt(xi) + sqrt(x1);
+                if(D>0 && !(v>0)) return false;
+                this->t[i+1] = this->t[i] + ((D>0) ? 2*D/v : 0);
+            }
+            this->sdd[n-1] = 0;
+            for(int i=0; i<n; i++) this->sd[i] = sqrt(this->x[i]);
+            return true;
+        }
+};
+
+}
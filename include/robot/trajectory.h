@@ -0,0 +1,517 @@
+/**
+ * @file trajectory.h
+ * @brief 関節空間の台形・S字（躍度制限）速度軌道生成
+ */
+#pragma once
+#include <robot/joint_limit.h>
+#include <functional>
+
+namespace kinematics
+{
+
+/**
+ * @brief 1軸の区分3次（躍度一定）軌道
+ * @details 初期状態(位置・速度・加速度)から目標位置に停止する軌道を、
+ *          躍度一定の区間列（最大12区間）として計画する。
+ *          jmax=INFINITYで台形速度、有限でS字（7区間）速度となる。
+ *          移動中からの再計画では、加速度を0に戻す区間と、
+ *          行き過ぎる場合の停止区間を前置する。
+ *          所要時間の指定(fit)では、移動中からでも減速・惰行により最短時間以上の任意の時間に合わせる。
+ */
+template <typename T>
+class profile1d
+{
+    public:
+        /**
+         * @brief 躍度一定区間
+         */
+        struct segment
+        {
+            T t0;   ///< 開始時刻
+            T p0;   ///< 開始位置
+            T v0;   ///< 開始速度
+            T a0;   ///< 開始加速度
+            T j;    ///< 躍度
+        };
+
+        static const int Nseg = 12;     ///< 区間数上限
+        std::array<segment, Nseg> seg;  ///< 区間
+        int nseg = 0;                   ///< 区間数
+        T k = 1;                        ///< 時間伸長率（計画時間 = k * 元の時間）
+        T duration = 0;                 ///< 元の所要時間
+        T p_end = 0;                    ///< 終端位置
+
+        /**
+         * @brief 計画
+         * @param [in] q0 初期位置
+         * @param [in] q1 目標位置
+         * @param [in] v0 初期速度
+         * @param [in] a0 初期加速度
+         * @param [in] vmax 速度上限
+         * @param [in] amax 加速度上限
+         * @param [in] jmax 躍度上限（INFINITYで台形）
+         * @return 所要時間
+         */
+        T plan(T q0, T q1, T v0, T a0, T vmax, T amax, T jmax=INFINITY)
+        {
+            assert(vmax>0 && amax>0 && jmax>0);
+            T s = this->start(q0, q1, v0, a0, amax, jmax);
+            this->double_s(q1, s, std::max(vmax, s*this->v), amax, jmax);
+            return this->finish(q1);
+        }
+
+        /**
+         * @brief 所要時間を指定した計画
+         * @details 最短時間がT1より短ければ、次のいずれかで所要時間をT1に合わせる。
+         *          - 静止開始: 時間伸長
+         *          - 行き過ぎて停止した後・停止中: 停止後の移動の制約を縮小（時間伸長と同じ形状）
+         *          - 目標から離れる向き、または巡航速度が現在速度以上で足りる場合: 巡航速度の二分探索
+         *          - 現在速度未満に減速して巡航（減速後の速度の二分探索）
+         *          - 減速すると停止距離が足りない場合: 現在速度で惰行してから停止し、残りを移動
+         *            （惰行時間の二分探索、惰行なしでも短ければ残りの移動の制約を縮小）
+         *          停止距離ちょうどで目標に向かう場合のみ、行き過ぎずには伸ばせないため最短時間となる。
+         * @param [in] T1 所要時間
+         * @param [in] q0 初期位置
+         * @param [in] q1 目標位置
+         * @param [in] v0 初期速度
+         * @param [in] a0 初期加速度
+         * @param [in] vmax 速度上限
+         * @param [in] amax 加速度上限
+         * @param [in] jmax 躍度上限（INFINITYで台形）
+         * @return 所要時間（最短時間がT1より短ければT1以下でT1に一致）
+         */
+        T fit(T T1, T q0, T q1, T v0, T a0, T vmax, T amax, T jmax=INFINITY)
+        {
+            T Tmin = this->plan(q0, q1, v0, a0, vmax, amax, jmax);
+            if(this->nseg==0 || !(Tmin<T1)) return Tmin;
+            if(v0==0 && a0==0)
+            {
+                this->stretch(T1);
+                return this->time();
+            }
+
+            // 加速度を0に戻した（行き過ぎる場合は停止した）状態から試行
+            const T s = this->start(q0, q1, v0, a0, amax, jmax);
+            const int n0 = this->nseg;
+            const T t0 = this->t, p0 = this->p, w = s*this->v;
+            auto reset = [&]() -> void
+            {
+                this->nseg = n0;
+                this->t = t0;
+                this->p = p0;
+                this->v = s*w;
+                this->a = 0;
+            };
+            // 巡航速度vm
+            auto cruise = [&](T vm) -> T
+            {
+                reset();
+                this->double_s(q1, s, vm, amax, jmax);
+                return this->t;
+            };
+            // 速度vm（w未満）へ減速して巡航（停止距離が足りなければINFINITY）
+            auto slow = [&](T vm) -> T
+            {
+                reset();
+                this->decel(s*vm, amax, jmax);
+                if(!reachable(s*(q1-this->p), vm, amax, jmax)) return (T)INFINITY;
+                this->double_s(q1, s, vm, amax, jmax);
+                return this->t;
+            };
+            // 時間cの惰行後に停止し、残りを制約を縮小（時間kk倍）して移動
+            auto coast = [&](T c, T kk) -> T
+            {
+                reset();
+                this->push(c, 0, 0);
+                this->decel(0, amax, jmax);
+                this->double_s(q1, s, vmax/kk, amax/(kk*kk), jmax/(kk*kk*kk));
+                return this->t;
+            };
+            // 区間[lo, hi]の二分探索（f(lo)>=T1, f(hi)<=T1を保ちhiを返す）
+            auto bisect = [&](T lo, T hi, const std::function<T(T)>& f) -> T
+            {
+                for(int it=0; it<50; it++)
+                {
+                    T x = 0.5*(lo+hi);
+                    if(f(x) > T1) lo = x; else hi = x;
+                }
+                return hi;
+            };
+
+            if(w>0 && !(cruise(w)>=T1))
+            {
+                T vm = bisect(0, w, slow);
+                if(!(slow(vm) < T1 - 1e-9*(1+T1))) return this->finish(q1);
+
+                // 惰行なしで停止した後の移動
+                reset();
+                this->decel(0, amax, jmax);
+                T t_stop = this->t;
+                T c_max = std::max(s*(q1-this->p)/w, (T)0);
+                T Tc = coast(0, 1);
+                if(Tc>=T1) coast(bisect(0, c_max, [&](T c) -> T { return coast(c, 1); }), 1);
+                else if(Tc>t_stop) coast(0, (T1-t_stop)/(Tc-t_stop));
+            }
+            else if(w!=0)
+            {
+                cruise(bisect(std::max(w, (T)0), vmax, cruise));
+            }
+            else
+            {
+                // 停止中: 残りの移動を時間伸長
+                T Tc = coast(0, 1);
+                if(Tc>t0) coast(0, std::max((T1-t0)/(Tc-t0), (T)1));
+            }
+            return this->finish(q1);
+        }
+
+        /**
+         * @brief 所要時間を伸長（静止開始の軌道のみ形状を保って有効）
+         * @param [in] T1 伸長後の所要時間
+         */
+        void stretch(T T1)
+        {
+            this->k = (this->duration>0) ? std::max(T1/this->duration, (T)1) : 1;
+        }
+
+        /**
+         * @brief 伸長後の所要時間
+         */
+        T time() const
+        {
+            return this->k*this->duration;
+        }
+
+        /**
+         * @brief 軌道評価
+         * @param [in] t 時刻（計画開始からの経過時間）
+         * @param [out] pos 位置
+         * @param [out] vel 速度
+         * @param [out] acc 加速度
+         * @param [in,out] hint 区間探索の開始番号（前回値）
+         */
+        void eval(T t, T& pos, T& vel, T& acc, int& hint) const
+        {
+            T tau = t/this->k;
+            if(this->nseg==0 || tau>=this->duration)
+            {
+                pos = this->p_end; vel = 0; acc = 0;
+                return;
+            }
+            if(tau<0) tau = 0;
+
+            // 時刻は単調増加が主なので前回区間から探索
+            int i = std::min(std::max(hint, 0), this->nseg-1);
+            while(i>0 && tau<this->seg[i].t0) i--;
+            while(i<this->nseg-1 && tau>=this->seg[i+1].t0) i++;
+            hint = i;
+
+            const segment& sg = this->seg[i];
+            T d = tau - sg.t0;
+            T ik = 1/this->k;
+            pos = sg.p0 + d*(sg.v0 + d*(0.5*sg.a0 + d*sg.j/6.0));
+            vel = (sg.v0 + d*(sg.a0 + 0.5*d*sg.j))*ik;
+            acc = (sg.a0 + d*sg.j)*ik*ik;
+        }
+
+    private:
+        T t, p, v, a;   ///< 計画中の状態
+
+        /**
+         * @brief 区間追加と状態の積分
+         */
+        void push(T dt, T a_, T j)
+        {
+            if(!(dt>0)) return;
+            assert(this->nseg<Nseg);
+            this->a = a_;
+            this->seg[this->nseg++] = segment{this->t, this->p, this->v, this->a, j};
+            this->p += dt*(this->v + dt*(0.5*this->a + dt*j/6.0));
+            this->v += dt*(this->a + 0.5*dt*j);
+            this->a += dt*j;
+            this->t += dt;
+        }
+
+        /**
+         * @brief 行き過ぎずに停止可能か
+         * @param [in] h 目標までの距離（正）
+         * @param [in] v0 目標方向の速度
+         */
+        static bool reachable(T h, T v0, T amax, T jmax)
+        {
+            if(v0<=0) return true;
+            if(std::isinf(jmax)) return h >= 0.5*v0*v0/amax;
+            T Tj = std::min(sqrt(v0/jmax), amax/jmax);
+            if(Tj==amax/jmax) return h >= 0.5*v0*(Tj + v0/amax);
+            return h >= Tj*v0;
+        }
+
+        /**
+         * @brief 初期状態から加速度を0に戻し、行き過ぎる場合は停止
+         * @return 移動方向(±1)
+         */
+        T start(T q0, T q1, T v0, T a0, T amax, T jmax)
+        {
+            this->nseg = 0;
+            this->k = 1;
+            this->t = 0;
+            this->p = q0;
+            this->v = v0;
+            this->a = a0;
+
+            // 加速度を0へ
+            if(!std::isinf(jmax) && this->a!=0)
+                this->push(std::abs(this->a)/jmax, this->a, (this->a>0) ? -jmax : jmax);
+            this->a = 0;
+
+            // 停止距離が足りなければ一旦停止
+            T s = (q1-this->p >= 0) ? 1 : -1;
+            if(!this->reachable(s*(q1-this->p), s*this->v, amax, jmax))
+            {
+                this->decel(0, amax, jmax);
+                s = -s;
+            }
+            return s;
+        }
+
+        /**
+         * @brief 計画の終了
+         * @return 所要時間
+         */
+        T finish(T q1)
+        {
+            this->duration = this->t;
+            this->p_end = q1;
+            return this->duration;
+        }
+
+        /**
+         * @brief 速度vmまで減速（加速度0で終了）
+         * @param [in] vm 終端速度（現在速度と同じ向きで小さい、0で停止）
+         */
+        void decel(T vm, T amax, T jmax)
+        {
+            T s = (this->v>vm) ? 1 : -1;
+            T vv = std::abs(this->v - vm);
+            if(std::isinf(jmax))
+            {
+                this->push(vv/amax, -s*amax, 0);
+            }
+            else
+            {
+                T Tj = (vv*jmax < amax*amax) ? sqrt(vv/jmax) : amax/jmax;
+                T Td = (vv*jmax < amax*amax) ? 2*Tj : Tj + vv/amax;
+                T al = jmax*Tj;
+                this->push(Tj, 0, -s*jmax);
+                this->push(Td-2*Tj, -s*al, 0);
+                this->push(Tj, -s*al, s*jmax);
+            }
+            this->v = vm;
+            this->a = 0;
+        }
+
+        /**
+         * @brief ダブルS速度軌道（終端速度0）
+         * @details L. Biagiotti, C. Melchiorri, "Trajectory Planning for Automatic Machines and Robots" 3.4節
+         * @param [in] q1 目標位置
+         * @param [in] s 移動方向(±1)
+         */
+        void double_s(T q1, T s, T vmax, T amax, T jmax)
+        {
+            T h = s*(q1 - this->p);
+            T v0 = s*this->v;
+            if(std::abs(h)<1e-12 && std::abs(v0)<1e-12) return;
+
+            bool scurve = !std::isinf(jmax);
+            T Tj0 = scurve ? amax/jmax : 0;
+            T Tj1, Ta, Tj2, Td, Tv;
+
+            // 最高速度に達する場合
+            if(scurve && (vmax-v0)*jmax < amax*amax) { Tj1 = sqrt((vmax-v0)/jmax); Ta = 2*Tj1; }
+            else                                     { Tj1 = Tj0; Ta = Tj1 + (vmax-v0)/amax; }
+            if(scurve && vmax*jmax < amax*amax)      { Tj2 = sqrt(vmax/jmax); Td = 2*Tj2; }
+            else                                     { Tj2 = Tj0; Td = Tj2 + vmax/amax; }
+            Tv = h/vmax - 0.5*Ta*(1+v0/vmax) - 0.5*Td;
+            T vlim = vmax;
+
+            if(Tv<=0)
+            {
+                // 最高速度に達しない場合（加速度上限を縮小しながら探索）
+                Tv = 0;
+                T al = amax;
+                for(int it=0; it<200; it++)
+                {
+                    T Tj = scurve ? al/jmax : 0;
+                    T D = al*al*al*al/(scurve ? jmax*jmax : INFINITY) + 2*v0*v0 + al*(4*h - 2*Tj*v0);
+                    Tj1 = Tj2 = Tj;
+                    Ta = (al*Tj - 2*v0 + sqrt(D))/(2*al);
+                    Td = (al*Tj + sqrt(D))/(2*al);
+                    if(Ta<0)
+                    {
+                        // 減速のみ
+                        Ta = 0; Tj1 = 0;
+                        Td = 2*h/v0;
+                        Tj2 = scurve ? (jmax*h - sqrt(jmax*(jmax*h*h - v0*v0*v0)))/(jmax*v0) : 0;
+                        break;
+                    }
+                    if(Td<0)
+                    {
+                        // 加速のみ（終端速度0では生じない）
+                        Td = 0; Tj2 = 0;
+                        Ta = 2*h/v0;
+                        Tj1 = scurve ? (jmax*h - sqrt(jmax*(jmax*h*h + v0*v0*v0)))/(jmax*v0) : 0;
+                        break;
+                    }
+                    if(!scurve || (Ta>=2*Tj && Td>=2*Tj)) break;
+                    al *= 0.95;
+                }
+                vlim = (Ta>0) ? v0 + (Ta-Tj1)*(scurve ? jmax*Tj1 : al) : v0;
+            }
+
+            // 区間の加速度
+            T aa = (Ta>0) ? (scurve ? jmax*Tj1 : (vlim-v0)/Ta) : 0;
+            T ad = (Td>0) ? (scurve ? jmax*Tj2 : vlim/Td) : 0;
+            T j = scurve ? jmax : 0;
+
+            this->push(Tj1, 0, s*j);
+            this->push(Ta-2*Tj1, s*aa, 0);
+            this->push(Tj1, s*aa, -s*j);
+            this->push(Tv, 0, 0);
+            this->push(Tj2, 0, -s*j);
+            this->push(Td-2*Tj2, -s*ad, 0);
+            this->push(Tj2, -s*ad, s*j);
+        }
+};
+
+/**
+ * @brief 多軸同期の関節軌道生成クラス
+ * @details 各軸の最短時間軌道を求め、最も遅い軸の所要時間に全軸を合わせる。
+ *          静止開始の軸は時間伸長（形状を保ったまま速度・加速度・躍度を縮小）、
+ *          移動中からの再計画では巡航速度（現在速度未満への減速を含む）・惰行時間の
+ *          二分探索（固定回数）で同期し、全軸が終了時刻に目標で停止する。
+ *          区間係数は計画時に一度だけ求め、評価は軸毎に多項式1回で確保は発生しない。
+ * @tparam N 軸数
+ */
+template <typename T, int N=Naxis>
+class joint_trajectory
+{
+    public:
+        joint_limit<T,N> lim;   ///< 速度・加速度制約
+        joint<T,N> jmax;        ///< 躍度上限（INFINITYで台形）
+        T t_start = 0;          ///< 計画開始時刻
+
+        /**
+         * @brief 生成
+         * @param [in] lim_ 制約（vmax, amaxを使用）
+         * @param [in] jmax_ 躍度上限（省略時は台形速度）
+         */
+        joint_trajectory(const joint_limit<T,N>& lim_, const joint<T,N>& jmax_=joint<T,N>()+INFINITY)
+        {
+            this->lim = lim_;
+            this->jmax = jmax_;
+            this->hint.fill(0);
+            this->plan(joint<T,N>(), joint<T,N>(), joint<T,N>(), joint<T,N>(), 0);
+        }
+
+        /**
+         * @brief 静止状態からの計画
+         * @param [in] q0 初期関節角
+         * @param [in] q1 目標関節角
+         * @param [in] t0 開始時刻
+         * @return 所要時間
+         */
+        T operator()(const joint<T,N>& q0, const joint<T,N>& q1, T t0=0)
+        {
+            return this->plan(q0, q1, joint<T,N>(), joint<T,N>(), t0);
+        }
+
+        /**
+         * @brief 移動中の目標変更
+         * @details 時刻tの状態（位置・速度・加速度）から新しい目標へ再計画する
+         * @param [in] t 変更時刻
+         * @param [in] q1 新しい目標関節角
+         * @return 時刻tからの所要時間
+         */
+        T retarget(T t, const joint<T,N>& q1)
+        {
+            joint<T,N> q, v, a;
+            this->eval(t, q, v, a);
+            return this->plan(q, q1, v, a, t);
+        }
+
+        /**
+         * @brief 終了時刻
+         */
+        T t_end() const
+        {
+            return this->t_start + this->T_sync;
+        }
+
+        /**
+         * @brief 軌道評価
+         * @param [in] t 時刻
+         * @param [out] q 関節角
+         * @param [out] v 関節速度
+         * @param [out] a 関節加速度
+         */
+        void eval(T t, joint<T,N>& q, joint<T,N>& v, joint<T,N>& a)
+        {
+            T tt = t - this->t_start;
+            for(int i=0; i<N; i++)
+                this->prof[i].eval(tt, q.val[i], v.val[i], a.val[i], this->hint[i]);
+        }
+
+        /**
+         * @brief 軌道の一括評価（軸毎の配列に出力）
+         * @param [in] t 時刻配列
+         * @param [in] num 要素数
+         * @param [out] q 関節角 q[軸][要素]
+         * @param [out] v 関節速度 v[軸][要素]（nullptrで省略）
+         * @param [out] a 関節加速度 a[軸][要素]（nullptrで省略）
+         */
+        void eval(const T t[], int num, T* const q[], T* const v[]=nullptr, T* const a[]=nullptr)
+        {
+            for(int i=0; i<N; i++)
+            {
+                T vv, aa;
+                for(int k=0; k<num; k++)
+                {
+                    this->prof[i].eval(t[k]-this->t_start, q[i][k], vv, aa, this->hint[i]);
+                    if(v) v[i][k] = vv;
+                    if(a) a[i][k] = aa;
+                }
+            }
+        }
+
+    private:
+        std::array<profile1d<T>, N> prof;   ///< 軸毎の軌道
+        std::array<int, N> hint;            ///< 区間探索の開始番号
+        T T_sync = 0;                       ///< 同期後の所要時間
+
+        T plan(const joint<T,N>& q0, const joint<T,N>& q1, const joint<T,N>& v0, const joint<T,N>& a0, T t0)
+        {
+            this->t_start = t0;
+            this->hint.fill(0);
+
+            // 軸毎の最短時間
+            T Tmax = 0;
+            for(int i=0; i<N; i++)
+            {
+                T Ti = this->prof[i].plan(q0.val[i], q1.val[i], v0.val[i], a0.val[i],
+                                          lim.vmax.val[i], lim.amax.val[i], jmax.val[i]);
+                Tmax = std::max(Tmax, Ti);
+            }
+
+            // 最も遅い軸に同期
+            for(int i=0; i<N; i++)
+            {
+                profile1d<T>& pf = this->prof[i];
+                if(pf.duration >= Tmax || pf.nseg==0) continue;
+                pf.fit(Tmax, q0.val[i], q1.val[i], v0.val[i], a0.val[i], lim.vmax.val[i], lim.amax.val[i], jmax.val[i]);
+            }
+            this->T_sync = Tmax;
+            return Tmax;
+        }
+};
+
+}
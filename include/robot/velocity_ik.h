@@ -0,0 +1,95 @@
+/**
+ * @file velocity_ik.h
+ * @brief 分解速度制御（速度レベル逆運動学）
+ */
+#pragma once
+#include <robot/jacobian.h>
+
+namespace kinematics
+{
+
+/**
+ * @brief 分解速度制御クラス
+ * @details 手先ツイストまたは姿勢偏差から減衰最小二乗で関節速度を求め、
+ *          速度制約と1周期後の角度制約でjoint::satにより飽和させる。
+ *          演算は軸数で決まる固定回数のループのみで構成され、確保は生成時のみ。
+ * @tparam N 軸数
+ */
+template <typename T, int N=Naxis>
+class velocity_ik
+{
+    public:
+        T dt;               ///< 制御周期[s]
+        T lambda;           ///< 減衰係数
+        T gain;             ///< 姿勢偏差フィードバックゲイン[1/s]
+        joint<T,N> qmin;    ///< 角度下限[rad]
+        joint<T,N> qmax;    ///< 角度上限[rad]
+        joint<T,N> vmax;    ///< 速度上限[rad/s]
+        jacobian<T> J;      ///< 直近周期のヤコビ行列
+
+        /**
+         * @brief 生成
+         * @param [in] dt_ 制御周期[s]
+         * @param [in] qmin_ 角度下限[rad]
+         * @param [in] qmax_ 角度上限[rad]
+         * @param [in] vmax_ 速度上限[rad/s]
+         * @param [in] lambda_ 減衰係数
+         * @param [in] gain_ 姿勢偏差フィードバックゲイン[1/s] 省略時1/dt_
+         * @param [in] rm ロボットモデル
+         */
+        velocity_ik(T dt_, joint<T,N> qmin_, joint<T,N> qmax_, joint<T,N> vmax_, T lambda_=0.01, T gain_=NAN, const robot_model<T,N>& rm=robot_model<T,N>())
+         : J(rm)
+        {
+            assert(dt_>0 && lambda_>0);
+            this->dt = dt_;
+            this->lambda = lambda_;
+            this->gain = std::isnan(gain_) ? 1.0/dt_ : gain_;
+            this->qmin = qmin_;
+            this->qmax = qmax_;
+            this->vmax = vmax_;
+        }
+
+        /**
+         * @brief 手先ツイストから関節速度生成
+         * @param [in] jnt 現在関節角
+         * @param [in] pa 同周期で計算済みのFK座標系(to_pose_array(jnt))
+         * @param [in] tw 手先ツイスト（基準座標系）
+         * @param [out] out_of_range 制約により飽和した軸
+         * @return 関節速度[rad/s]
+         */
+        template <typename C>
+        joint<T,N> operator()(joint<T,N> jnt, const C& pa, const twist<T>& tw, joint<T,N> *out_of_range=nullptr)
+        {
+            this->J(pa);
+            joint<T,N> qd;
+            this->J.dls(tw, this->lambda, &qd.val[0]);
+
+            // 速度制約と1周期後の角度制約の共通範囲
+            joint<T,N> lo, hi;
+            for(int i=0; i<N; i++)
+            {
+                T v = this->vmax[i];
+                lo[i] = std::min(std::max(-v, (this->qmin[i]-jnt[i])/this->dt), v);
+                hi[i] = std::max(std::min( v, (this->qmax[i]-jnt[i])/this->dt), -v);
+            }
+            return qd.sat(lo, hi, out_of_range);
+        }
+
+        /**
+         * @brief 目標手先姿勢から関節速度生成
+         * @param [in] jnt 現在関節角
+         * @param [in] pa 同周期で計算済みのFK座標系(to_pose_array(jnt))
+         * @param [in] target 目標手先姿勢（基準座標系）
+         * @param [in] ff フィードフォワードツイスト
+         * @param [out] out_of_range 制約により飽和した軸
+         * @return 関節速度[rad/s]
+         */
+        template <typename C>
+        joint<T,N> operator()(joint<T,N> jnt, const C& pa, const pose<T>& target, const twist<T>& ff=twist<T>(), joint<T,N> *out_of_range=nullptr)
+        {
+            twist<T> tw = ff + pose_error(target, pa.back())*this->gain;
+            return (*this)(jnt, pa, tw, out_of_range);
+        }
+};
+
+}
@@ -0,0 +1,46 @@
+/**
+ * @file bench_fk.cpp
+ * @brief 順運動学エンジンの比較（to_pose_array / robot_model / 指数積）
+ */
+#include <robot/poe.h>
+#include <chrono>
+using namespace kinematics;
+
+/**
+ * @brief 1回あたりの平均処理時間[ns]
+ */
+template <typename F>
+double bench(int n, F func)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    for(int k=0; k<n; k++) func(k);
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(t1-t0).count()/n;
+}
+
+int main()
+{
+    const int n = 200000;
+    std::vector<joint<double>> q(1024);
+    for(int k=0; k<(int)q.size(); k++)
+        for(int i=0; i<6; i++) q[k][i] = -3.0 + 6.0*((k*37+i*11)%1024)/1024.0;
+
+    robot_model<double> rm;
+    poe<double> fk;
+    jacobian<double> J;
+    double sum = 0;     // 最適化による削除防止
+
+    double t_pa = bench(n, [&](int k){ sum += to_pose_array(q[k&1023]).back().p.x; });
+    double t_rm = bench(n, [&](int k){ sum += to_pose_array(rm, q[k&1023])[6].p.x; });
+    double t_poe = bench(n, [&](int k){ sum += fk(q[k&1023]).p.x; });
+    double t_paJ = bench(n, [&](int k){ J(to_pose_array(rm, q[k&1023])); sum += J.v[0].x; });
+    double t_poeJ = bench(n, [&](int k){ fk(q[k&1023]); fk.jacobian_to(J); sum += J.v[0].x; });
+
+    printf("to_pose_array(joint)          : %8.1f ns\n", t_pa);
+    printf("to_pose_array(robot_model)    : %8.1f ns\n", t_rm);
+    printf("poe                           : %8.1f ns\n", t_poe);
+    printf("to_pose_array + jacobian      : %8.1f ns\n", t_paJ);
+    printf("poe + jacobian_to             : %8.1f ns\n", t_poeJ);
+    printf("(checksum %g)\n", sum);
+    return 0;
+}
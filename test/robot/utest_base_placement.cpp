@@ -0,0 +1,110 @@
+#include <gtest/gtest.h>
+#include <robot/base_placement.h>
+#include "utest_fixture.h"
+using namespace kinematics;
+
+/**
+ * @brief 既知のベースから届く作業姿勢（角度制約の内側から抽出）
+ */
+static std::vector<pose<double>> make_tasks(const robot_model<double>& rm, const joint_limit<double>& lim, const pose<double>& base, int num)
+{
+    std::vector<pose<double>> ret;
+    for(int k=0; k<num; k++)
+    {
+        joint<double> q;
+        for(int i=0; i<6; i++)
+        {
+            double c = (lim.qmin.val[i] + lim.qmax.val[i])/2, w = (lim.qmax.val[i] - lim.qmin.val[i])/2;
+            q.val[i] = c + 0.6*w*(2*counter_uniform(7, k, i) - 1);
+        }
+        ret.push_back(to_pose(rm, q, base));
+    }
+    return ret;
+}
+
+static aabb<double> search_region()
+{
+    aabb<double> ret;
+    ret.lo = vec3<double>(0.0, -0.8, 0);
+    ret.hi = vec3<double>(1.0,  0.2, 0);
+    return ret;
+}
+
+TEST(base_placement, Test1)
+{
+    robot_model<double> rm;
+    joint_limit<double> lim = arm_limits();
+    thread_pool pool(2);
+    const pose<double> truth(vec3<double>(0.5, -0.3, 0), vec4<double>(vec3<double>(0, 0, 1), 0.7));
+    std::vector<pose<double>> tasks = make_tasks(rm, lim, truth, 5000);
+
+    reach_map<double> map;
+    map.build(rm, lim, arm_region(), 0.05, 200000, &pool);
+
+    base_placement<double> bp(rm, lim, &map, &pool);
+    bp.region = search_region();
+    auto res = bp(tasks);
+    EXPECT_GT(bp.evaluated, 0);
+    EXPECT_GE(bp.ik_calls, (long)tasks.size());
+
+    // 第1軸が全周回転するため向きは被覆率に効かない（位置のみ比較）
+    EXPECT_GE(res.coverage, 0.99);
+    EXPECT_GE(res.estimate, 0.9);
+    EXPECT_LT((res.base.p - truth.p).nrm(), 0.1);
+    EXPECT_EQ((int)res.reached.size(), 5000);
+
+    // 到達した作業姿勢の解は目標に一致
+    for(int k=0; k<(int)tasks.size(); k+=50)
+    {
+        if(!res.reached[k]) continue;
+        fpose<double> P = to_pose(rm, res.q[k], res.base);
+        EXPECT_NEAR((P.p - tasks[k].p).nrm(), 0, 1e-3);
+        for(int i=0; i<6; i++)
+        {
+            EXPECT_GE(res.q[k].val[i], lim.qmin.val[i] - 1e-9);
+            EXPECT_LE(res.q[k].val[i], lim.qmax.val[i] + 1e-9);
+        }
+    }
+
+    // 遠いベースでは届かない
+    pose<double> far(vec3<double>(3, 0, 0), vec4<double>());
+    EXPECT_EQ(bp.estimate(far, tasks), 0);
+    EXPECT_EQ(bp.check(far, std::vector<pose<double>>(tasks.begin(), tasks.begin() + 20)), 0);
+}
+
+TEST(base_placement, Test2)
+{
+    // マップなし（逆運動学のみ）でも同じ設置位置付近を見つける
+    robot_model<double> rm;
+    joint_limit<double> lim = arm_limits();
+    thread_pool pool(2);
+    const pose<double> truth(vec3<double>(0.5, -0.3, 0), vec4<double>(vec3<double>(0, 0, 1), 0.7));
+    std::vector<pose<double>> tasks = make_tasks(rm, lim, truth, 40);
+
+    base_placement<double> bp(rm, lim, nullptr, &pool);
+    bp.region = search_region();
+    bp.grid = {{5, 5, 1, 4}};
+    bp.levels = 2;
+    bp.keep = 2;
+    bp.restarts = 2;
+    auto res = bp(tasks);
+    EXPECT_GE(res.coverage, 0.9);
+    EXPECT_EQ(res.coverage, res.estimate);
+
+    // 探索後に変更したツール・角度制約は次の判定に反映される
+    bp.tool = pose<double>(vec3<double>(0, 0, 0.3), vec4<double>());
+    bp.lim.qmax.val[1] = 0.2;
+    base_placement<double> bp2(rm, bp.lim, nullptr, &pool);
+    bp2.tool = bp.tool;
+    bp2.restarts = bp.restarts;
+    std::vector<char> r1, r2;
+    EXPECT_EQ(bp.check(res.base, tasks, &r1), bp2.check(res.base, tasks, &r2));
+    EXPECT_LT(bp.check(res.base, tasks), res.coverage);
+    EXPECT_EQ(r1, r2);
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
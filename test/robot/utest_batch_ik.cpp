@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+#include <robot/batch_ik.h>
+using namespace kinematics;
+
+TEST(thread_pool, Test1)
+{
+    thread_pool pool(4);
+    EXPECT_EQ(pool.size(), 4);
+
+    // 全要素がちょうど1回処理される
+    std::vector<int> cnt(10000, 0);
+    for(int rep=0; rep<3; rep++)
+    {
+        pool.parallel_for(cnt.size(), [&](int b, int e, int id)
+        {
+            EXPECT_TRUE(0<=id && id<4);
+            for(int k=b; k<e; k++) cnt[k]++;
+        }, 7);
+    }
+    for(int c : cnt) EXPECT_EQ(c, 3);
+}
+
+TEST(batch_ik, Test1)
+{
+    batch_ik<double> bik(4);
+    bik.seed = {0.1, -0.3, 0.6, 0.3, -0.5, 0.2};
+
+    // 初期値近傍の目標（最後は到達不能）
+    std::vector<joint<double>> jnt;
+    std::vector<pose<double>> target;
+    for(int k=0; k<100; k++)
+    {
+        double s = 0.002*k;
+        jnt.push_back(joint<double>({0.1+s, -0.3+s, 0.6-s, 0.3+s, -0.5+s, 0.2-s}));
+        target.push_back(to_pose(jnt.back()));
+    }
+    target.back().p = vec3<double>(3,0,0);
+
+    ik_buffer<double> out;
+    EXPECT_EQ(bik(target, out), 99);
+    EXPECT_EQ(out.size(), 100);
+    for(int k=0; k<99; k++)
+    {
+        EXPECT_EQ(out.status[k], IK_SUCCESS);
+        EXPECT_TRUE(out.get(k) == jnt[k] || pose_error(target[k], (pose<double>)to_pose(out.get(k))).nrm() < 1e-5);
+        EXPECT_EQ(out.flg1[k], FlgChk(out.get(k)).flg1.val);
+    }
+    EXPECT_NE(out.status[99], IK_SUCCESS);
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+#include <robot/bvh.h>
+#include <random>
+using namespace kinematics;
+
+TEST(bvh, Test1)
+{
+    // 線分と箱・三角形の距離（総当たりと比較）
+    std::mt19937 g(1);
+    std::uniform_real_distribution<double> U(-1, 1);
+    for(int n=0; n<200; n++)
+    {
+        vec3<double> p(2*U(g), 2*U(g), 2*U(g)), q(2*U(g), 2*U(g), 2*U(g));
+        vec3<double> h(0.2+std::abs(U(g)), 0.2+std::abs(U(g)), 0.2+std::abs(U(g)));
+        vec3<double> a(U(g), U(g), U(g)), b(U(g), U(g), U(g)), c(U(g), U(g), U(g));
+        double rb = INFINITY, rt = INFINITY;
+        for(int i=0; i<=2000; i++)
+        {
+            vec3<double> x = p + (q-p)*(i/2000.0);
+            vec3<double> y(std::min(std::max(x.x, -h.x), h.x), std::min(std::max(x.y, -h.y), h.y), std::min(std::max(x.z, -h.z), h.z));
+            rb = std::min(rb, (x-y)*(x-y));
+            vec3<double> z = x - closest_point_triangle(x, a, b, c);
+            rt = std::min(rt, z*z);
+        }
+        EXPECT_NEAR(segment_box_distance2(p, q-p, h), rb, 1e-5);
+        EXPECT_LE(segment_box_distance2(p, q-p, h), rb + 1e-12);
+        EXPECT_NEAR(segment_triangle_distance2(p, q, a, b, c), rt, 1e-5);
+        EXPECT_LE(segment_triangle_distance2(p, q, a, b, c), rt + 1e-12);
+    }
+}
+
+TEST(bvh, Test2)
+{
+    // 直方体2000個＋メッシュ：総当たりと一致、並列構築でも同じ結果
+    std::mt19937 g(2);
+    std::uniform_real_distribution<double> U(-1, 1);
+    bvh<double> env, env2;
+    for(int i=0; i<2000; i++)
+    {
+        pose<double> P(vec3<double>(3*U(g), 3*U(g), 3*U(g)), vec4<double>(vec3<double>(U(g), U(g), U(g)), 3*U(g)));
+        vec3<double> size(0.05+0.1*std::abs(U(g)), 0.05+0.1*std::abs(U(g)), 0.05+0.1*std::abs(U(g)));
+        EXPECT_EQ(env.add(P, size), i);
+        env2.add(P, size);
+    }
+    std::vector<vec3<double>> vtx = {{0,0,0}, {1,0,0}, {0,1,0}, {0,0,1}};
+    std::vector<int> tri = {0,2,1, 0,1,3, 0,3,2, 1,2,3};
+    pose<double> P(vec3<double>(0.5, -0.5, 0.2), vec4<double>());
+    EXPECT_EQ(env.add(vtx, tri, P), 2000);
+    env2.add(vtx, tri, P);
+    EXPECT_EQ(env.size(), 2004);
+
+    thread_pool pool(4);
+    env.build(&pool);
+    env2.leaf_size = 1;
+    env2.build();
+    EXPECT_EQ(env.prim.size(), 2004u);
+
+    for(int n=0; n<200; n++)
+    {
+        capsule<double> c{vec3<double>(3*U(g), 3*U(g), 3*U(g)), vec3<double>(3*U(g), 3*U(g), 3*U(g)), 0.05};
+        c.b = c.a + (c.b - c.a)*0.2;
+        double ref = INFINITY;
+        int rid = -1;
+        for(const auto& p : env.prim)
+        {
+            double d = sqrt(bvh<double>::distance2(p, c)) - c.r;
+            if(d < ref) { ref = d; rid = p.id; }
+        }
+        int id1, id2;
+        EXPECT_DOUBLE_EQ(env.distance(c, &id1), ref);
+        EXPECT_DOUBLE_EQ(env2.distance(c, &id2), ref);
+        if(ref > -c.r)
+        {
+            EXPECT_EQ(id1, rid);    // 貫通（距離0）は同率のため除く
+        }
+        EXPECT_EQ(env.collide(c), ref<=0);
+        EXPECT_EQ(env.collide(c, 0.1), ref<=0.1);
+        EXPECT_EQ(env2.collide(c, 0.1), ref<=0.1);
+    }
+}
+
+TEST(bvh, Test3)
+{
+    // ロボットのリンク形状と障害物
+    robot_model<double> rm;
+    self_collision<double> robot(rm, 0.04);
+    joint<double> q = {0, 0, 0, 0, 0, 0};
+    std::array<fpose<double>, 7> pa = to_pose_array(rm, q);
+
+    bvh<double> env;
+    env.add(pose<double>(vec3<double>(0, 0, -0.05), vec4<double>()), vec3<double>(1, 1, 0.1));    // 床
+    env.add(pose<double>(vec3<double>(0.3, 0, 0.6), vec4<double>()), vec3<double>(0.1, 0.5, 0.1));
+    env.build();
+
+    int link, id;
+    EXPECT_TRUE(env.collide(robot, pa, 0.0, &link, &id));      // ベースは床に接する
+    EXPECT_EQ(link, 0);
+    EXPECT_EQ(id, 0);
+
+    double d = env.distance(robot, pa, &link, &id);
+    EXPECT_LE(d, 0);
+
+    // 床を除くと腕と柱の距離
+    bvh<double> env2;
+    env2.add(pose<double>(vec3<double>(0.3, 0, 0.6), vec4<double>()), vec3<double>(0.1, 0.5, 0.1));
+    env2.build();
+    d = env2.distance(robot, pa, &link, &id);
+    EXPECT_GT(d, 0);
+    EXPECT_FALSE(env2.collide(robot, pa));
+    EXPECT_TRUE(env2.collide(robot, pa, d+1e-9));
+    joint<double> q2 = {0, 0.8, 0, 0, 0, 0};
+    EXPECT_TRUE(env2.collide(robot, to_pose_array(rm, q2)));
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+#include <robot/cartesian_path.h>
+using namespace kinematics;
+
+TEST(cartesian_path, Test1)
+{
+    // 直線・球面線形補間
+    pose<double> a(vec3<double>(0.3, 0, 0.5), vec4<double>(0, M_PI/2, 0));
+    pose<double> b(vec3<double>(0.3, 0.2, 0.4), vec4<double>(0.3, M_PI/2, 0.2));
+    pose<double> c(vec3<double>(0.4, 0.2, 0.4), vec4<double>(0.3, M_PI/2, 0.2));
+    cartesian_path<double> path;
+    double T = path({a, b, c}, 0.5, 1.0, 0.1);
+    EXPECT_EQ(path.seg.size(), 2u);
+    EXPECT_DOUBLE_EQ(T, path.duration());
+
+    EXPECT_LT(pose_error(a, path(0)).nrm(), 1e-12);
+    EXPECT_LT(pose_error(c, path(T)).nrm(), 1e-12);
+    EXPECT_LT(pose_error(c, path(T+1)).nrm(), 1e-12);
+
+    // 第1区間上では位置が線分上、姿勢は単位クォータニオン
+    pose<double> prev = path(0);
+    for(double t=0; t<=T; t+=1e-3)
+    {
+        pose<double> x = path(t);
+        EXPECT_NEAR(x.q.nrm(), 1.0, 1e-12);
+        EXPECT_LE((x.p-prev.p).nrm(), 0.5*1e-3+1e-12);
+        if(x.p.x < 0.3+1e-12)
+        {
+            vec3<double> d = x.p - a.p;
+            EXPECT_NEAR((d % (b.p-a.p)).nrm(), 0, 1e-12);
+        }
+        prev = x;
+    }
+}
+
+TEST(cartesian_path, Test2)
+{
+    // 逐次逆運動学（先行スレッドの有無で同じ結果）
+    numerical_ik<double> ik(posB(), alfaB());
+    joint<double> q0 = {0.3, 0.5, 0.8, 0.3, 0.6, 0.2};
+    pose<double> a = ik.forward(&q0.val[0]);
+    pose<double> b = a;
+    b.p = b.p + vec3<double>(-0.05, -0.03, 0.03);
+    b.q = b.q * vec4<double>(vec3<double>(0,0,1), 0.2);
+
+    joint<double> vmax = {3, 3, 3, 3, 3, 3};
+    joint_limit<double> lim(joint<double>()-M_PI, joint<double>()+M_PI, vmax);
+    cartesian_stream<double> s1(ik, lim, 1e-3, 8, true);
+    cartesian_stream<double> s2(ik, lim, 1e-3, 8, false);
+    s1.budget = s2.budget = 1.0;
+    int n = s1.start({a, b}, q0, 0.2, 1.0, 0.1);
+    EXPECT_EQ(s2.start({a, b}, q0, 0.2, 1.0, 0.1), n);
+
+    cartesian_stream<double>::tick t1, t2;
+    for(int k=0; k<n; k++)
+    {
+        STREAM_STATUS st;
+        while((st = s1.next(t1))==STREAM_UNDERRUN) std::this_thread::yield();
+        EXPECT_EQ(st, STREAM_OK);
+        EXPECT_EQ(s2.next(t2), STREAM_OK);
+        EXPECT_DOUBLE_EQ(t1.t, k*1e-3 < s1.path.duration() ? k*1e-3 : s1.path.duration());
+        for(int i=0; i<6; i++) EXPECT_EQ(t1.q[i], t2.q[i]);
+        EXPECT_LT(pose_error(t1.target, ik.forward(&t1.q.val[0])).nrm(), 1e-5);
+    }
+    EXPECT_EQ(s1.next(t1), STREAM_END);
+    EXPECT_EQ(s1.failure(), -1);
+    EXPECT_LT(pose_error(b, ik.forward(&t1.q.val[0])).nrm(), 1e-5);
+
+    // 到達不能な目標は先行量だけ前に検出
+    pose<double> c = a;
+    c.p = c.p + vec3<double>(5, 0, 0);
+    n = s2.start({a, c}, q0, 0.5, 1.0, 0.1);
+    int k = 0, found = -1;
+    STREAM_STATUS st;
+    while((st = s2.next(t2))==STREAM_OK)
+    {
+        if(found<0 && s2.failure()>=0) found = k;
+        k++;
+    }
+    EXPECT_NE(st, STREAM_END);
+    EXPECT_EQ(s2.failure(), k);
+    EXPECT_EQ(found, k-8);
+}
+
+TEST(cartesian_path, Test3)
+{
+    // 時間予算を超えても先行量の余裕の範囲で求解を続ける
+    numerical_ik<double> ik(posB(), alfaB());
+    joint<double> q0 = {0.3, 0.5, 0.8, 0.3, 0.6, 0.2};
+    pose<double> a = ik.forward(&q0.val[0]);
+    pose<double> b = a;
+    b.p = b.p + vec3<double>(-0.02, -0.01, 0.01);
+
+    joint<double> vmax = {3, 3, 3, 3, 3, 3};
+    joint_limit<double> lim(joint<double>()-M_PI, joint<double>()+M_PI, vmax);
+    cartesian_stream<double> s(ik, lim, 1e-3, 8, true);
+    s.budget = 0;
+    int n = s.start({a, b}, q0, 0.2, 1.0, 0.05);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    cartesian_stream<double>::tick t;
+    for(int k=0; k<n; k++)
+    {
+        STREAM_STATUS st;
+        while((st = s.next(t))==STREAM_UNDERRUN) std::this_thread::yield();
+        ASSERT_EQ(st, STREAM_OK);
+        EXPECT_LT(pose_error(t.target, ik.forward(&t.q.val[0])).nrm(), 1e-5);
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+    }
+    EXPECT_EQ(s.failure(), -1);
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,127 @@
+#include <gtest/gtest.h>
+#include <robot/ccd.h>
+#include <random>
+using namespace kinematics;
+
+static joint<double> lerp(const joint<double>& q0, const joint<double>& q1, double s)
+{
+    joint<double> ret;
+    for(int i=0; i<6; i++) ret.val[i] = q0.val[i] + (q1.val[i] - q0.val[i])*s;
+    return ret;
+}
+
+/**
+ * @brief 等間隔サンプリングによる判定（比較用）
+ * @param [out] dmin 最短距離
+ */
+static bool sampled(self_collision<double>& robot, const bvh<double>& env, const joint<double>& q0, const joint<double>& q1, int num, double *dmin)
+{
+    bool ret = false;
+    *dmin = INFINITY;
+    for(int i=0; i<num; i++)
+    {
+        joint<double> q = lerp(q0, q1, (double)i/std::max(num-1, 1));
+        std::array<fpose<double>, 7> pa = to_pose_array(robot.rm, q);
+        double ds, de = env.distance(robot, pa);
+        robot(pa, &ds);
+        *dmin = std::min(*dmin, std::min(ds, de));
+        if(std::min(ds, de) <= 0) ret = true;
+    }
+    return ret;
+}
+
+TEST(ccd, Test1)
+{
+    // 薄板を横切る区間（粗いサンプリングでは見逃す）
+    robot_model<double> rm;
+    self_collision<double> robot(rm, 0.02);
+    bvh<double> env;
+    env.add(pose<double>(vec3<double>(0.4*cos(0.3), 0.4*sin(0.3), 0.6), vec4<double>(vec3<double>(0, 0, 1), 0.3)), vec3<double>(0.3, 0.004, 0.1));
+    env.build();
+
+    joint<double> q0 = {-0.8, 0.5, 0.8, 0, 0.6, 0};
+    joint<double> q1 = { 0.8, 0.5, 0.8, 0, 0.6, 0};
+    double dmin;
+    EXPECT_FALSE(sampled(robot, env, q0, q1, 9, &dmin));
+    EXPECT_TRUE(sampled(robot, env, q0, q1, 1000, &dmin));
+
+    continuous_check<double> ccd(robot, &env);
+    double s = -1;
+    EXPECT_TRUE(ccd(q0, q1, &s));
+    EXPECT_GT(s, 0.5);
+    EXPECT_LT(s, 0.7);
+    EXPECT_LT(ccd.fk_count, 100);
+    int hit = 0;
+    sampled(robot, env, q0, lerp(q0, q1, s), 2, &dmin);
+    EXPECT_GT(dmin, 0);     // 検出位置は干渉の手前
+    EXPECT_LE(dmin, ccd.tol + 1e-9);
+
+    // 逆向き・経由点列
+    EXPECT_TRUE(ccd(q1, q0, &s));
+    std::vector<joint<double>> wp = {q0, joint<double>{-0.8, 0.2, 0.8, 0, 0.6, 0}, q1};
+    hit = ccd(&wp[0], wp.size());
+    EXPECT_EQ(hit, 1);
+
+    // 障害物から遠い区間は少ない回数
+    joint<double> q2 = {-0.8, 0.0, 0.3, 0, 0.6, 0};
+    joint<double> q3 = {-1.6, 0.0, 0.3, 0, 0.6, 0};
+    EXPECT_FALSE(ccd(q2, q3));
+    EXPECT_LT(ccd.fk_count, 10);
+}
+
+TEST(ccd, Test2)
+{
+    // 任意区間で密なサンプリングと矛盾しない（保守的）
+    robot_model<double> rm;
+    self_collision<double> robot(rm, 0.04);
+    bvh<double> env;
+    env.add(pose<double>(vec3<double>(0.45, 0, 0.3), vec4<double>()), vec3<double>(0.1, 0.4, 0.02));
+    env.add(pose<double>(vec3<double>(-0.2, 0.4, 0.5), vec4<double>(vec3<double>(1, 0, 0), 0.4)), vec3<double>(0.05, 0.05, 0.5));
+    env.build();
+    continuous_check<double> ccd(robot, &env);
+
+    for(int i=0; i<6; i++)
+        for(int k=0; k<=i; k++)
+            EXPECT_EQ(ccd.radius(i, k), 0);
+    EXPECT_GT(ccd.radius(0, 5), ccd.radius(3, 5));
+
+    std::mt19937 g(3);
+    std::uniform_real_distribution<double> U(-1, 1);
+    int nhit = 0, nfree = 0;
+    long fk = 0;
+    for(int n=0; n<100; n++)
+    {
+        joint<double> q0, q1;
+        for(int i=0; i<6; i++)
+        {
+            q0[i] = 1.5*U(g);
+            q1[i] = q0[i] + 0.8*U(g);
+        }
+        q0[1] = 0.3*U(g);   // 床のない環境で下向きに倒れすぎない範囲
+        q1[1] = 0.3*U(g);
+        double dmin;
+        if(sampled(robot, env, q0, q0, 1, &dmin)) continue;     // 始点が干渉
+
+        bool ref = sampled(robot, env, q0, q1, 2000, &dmin);
+        bool ret = ccd(q0, q1);
+        fk += ccd.fk_count;
+        if(ref)
+        {
+            EXPECT_TRUE(ret);
+        }
+        else if(ret)
+        {
+            EXPECT_LT(dmin, ccd.tol + 0.01);    // 接近による保守的な判定
+        }
+        (ret ? nhit : nfree)++;
+    }
+    EXPECT_GT(nhit, 5);
+    EXPECT_GT(nfree, 5);
+    EXPECT_LT(fk, 2000*(nhit + nfree)/10);
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,234 @@
+#include <gtest/gtest.h>
+#include <robot/dynamics.h>
+#include <robot/jacobian.h>
+using namespace kinematics;
+
+static double urand(int k, int i)
+{
+    uint64_t z = 0x9e3779b97f4a7c15ULL*(k*64 + i + 1);
+    z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27))*0x94d049bb133111ebULL;
+    return ((z ^ (z >> 31)) >> 11)*(1.0/9007199254740992.0)*2 - 1;
+}
+
+/**
+ * @brief 直動関節を含む3軸モデル
+ */
+static robot_model<double, 3> prismatic_model()
+{
+    std::vector<vec3<double>> pos = {vec3<double>(0, 0, 0.3), vec3<double>(0.1, 0, 0.2), vec3<double>(0, 0.05, 0.25)};
+    std::vector<vec3<double>> alfa = {vec3<double>(0, 0, 1), vec3<double>(1, 0, 0), vec3<double>(0, 1, 0)};
+    robot_model<double, 3> rm(pos, alfa, std::vector<JOINT_TYPE>{REVOLUTE, PRISMATIC, REVOLUTE});
+    std::vector<link_inertia<double>> in = {
+        link_inertia<double>(3.0, vec3<double>(0.02, 0, 0.05), 0.02, 0.03, 0.01, 0.001, 0, 0.002),
+        link_inertia<double>(2.0, vec3<double>(0.05, 0.01, 0.1), 0.01, 0.02, 0.015, 0, 0.001, 0),
+        link_inertia<double>(1.5, vec3<double>(0, 0.02, 0.12), 0.008, 0.006, 0.003, 0.0005, 0, 0.001)};
+    rm.set_inertia(in);
+    return rm;
+}
+
+/**
+ * @brief 位置エネルギー
+ */
+template <int N>
+static double potential(const robot_model<double,N>& rm, const joint<double,N>& q)
+{
+    auto pa = to_pose_array(rm, q);
+    double V = 0;
+    for(int i=0; i<N; i++) V -= rm.inertia[i].m*(rm.gravity*transform<double>(pa[i+1], rm.inertia[i].c));
+    return V;
+}
+
+/**
+ * @brief 慣性行列（逆動力学の列）
+ */
+template <int N>
+static void mass_matrix(const inverse_dynamics<double,N>& id, const joint<double,N>& q, double M[N][N])
+{
+    auto pa = to_pose_array(id.rm, q);
+    for(int j=0; j<N; j++)
+    {
+        joint<double,N> zero, e;
+        e.val[j] = 1;
+        joint<double,N> c = id(pa, zero, e, false);
+        for(int i=0; i<N; i++) M[i][j] = c.val[i];
+    }
+}
+
+template <int N>
+static double quad(double M[N][N], const joint<double,N>& x, const joint<double,N>& y)
+{
+    double s = 0;
+    for(int i=0; i<N; i++)
+        for(int j=0; j<N; j++) s += x.val[i]*M[i][j]*y.val[j];
+    return s;
+}
+
+/**
+ * @brief 運動エネルギー（順運動学の差分によるリンク速度、逆動力学と独立）
+ */
+template <int N>
+static double kinetic(const robot_model<double,N>& rm, const joint<double,N>& q, const joint<double,N>& qd)
+{
+    const double h = 1e-6;
+    joint<double,N> qp, qm;
+    for(int i=0; i<N; i++)
+    {
+        qp.val[i] = q.val[i] + h*qd.val[i];
+        qm.val[i] = q.val[i] - h*qd.val[i];
+    }
+    auto pp = to_pose_array(rm, qp), pm = to_pose_array(rm, qm), p0 = to_pose_array(rm, q);
+    double K = 0;
+    for(int i=0; i<N; i++)
+    {
+        const link_inertia<double>& in = rm.inertia[i];
+        vec3<double> v = (transform<double>(pp[i+1], in.c) - transform<double>(pm[i+1], in.c))*(0.5/h);
+        vec4<double> dq = pp[i+1].q*pm[i+1].q.conj();
+        vec3<double> w = rotvec(dq)*(0.5/h);
+        vec3<double> wl = rotate(p0[i+1].q.conj(), w);
+        K += 0.5*in.m*(v*v) + 0.5*(wl*in.mul(wl));
+    }
+    return K;
+}
+
+/**
+ * @brief ラグランジュの運動方程式との比較（慣性行列の数値微分）
+ */
+template <int N>
+static void check_lagrange(const robot_model<double,N>& rm, int seed)
+{
+    inverse_dynamics<double,N> id(rm);
+    const double h = 1e-6;
+    for(int k=0; k<10; k++)
+    {
+        joint<double,N> q, qd, qdd;
+        for(int i=0; i<N; i++)
+        {
+            q.val[i] = 2*urand(seed + k, i);
+            qd.val[i] = 2*urand(seed + k, i + 8);
+            qdd.val[i] = 5*urand(seed + k, i + 16);
+        }
+
+        double M[N][N], Mp[N][N], Mm[N][N];
+        mass_matrix(id, q, M);
+
+        // 対称・運動エネルギーと一致
+        for(int i=0; i<N; i++)
+            for(int j=0; j<N; j++) EXPECT_NEAR(M[i][j], M[j][i], 1e-12);
+        EXPECT_NEAR(0.5*quad<N>(M, qd, qd), kinetic(rm, q, qd), 1e-6);
+
+        // tau = M qdd + dM/dt qd - d(qd^T M qd / 2)/dq + dV/dq
+        joint<double,N> qp, qm;
+        for(int i=0; i<N; i++)
+        {
+            qp.val[i] = q.val[i] + h*qd.val[i];
+            qm.val[i] = q.val[i] - h*qd.val[i];
+        }
+        mass_matrix(id, qp, Mp);
+        mass_matrix(id, qm, Mm);
+        joint<double,N> tau = id(q, qd, qdd);
+        for(int i=0; i<N; i++)
+        {
+            double ref = 0;
+            for(int j=0; j<N; j++) ref += M[i][j]*qdd.val[j] + (Mp[i][j] - Mm[i][j])/(2*h)*qd.val[j];
+            joint<double,N> a = q, b = q;
+            a.val[i] += h;
+            b.val[i] -= h;
+            double Ma[N][N], Mb[N][N];
+            mass_matrix(id, a, Ma);
+            mass_matrix(id, b, Mb);
+            ref -= 0.5*(quad<N>(Ma, qd, qd) - quad<N>(Mb, qd, qd))/(2*h);
+            ref += (potential(rm, a) - potential(rm, b))/(2*h);
+            EXPECT_NEAR(tau.val[i], ref, 1e-5*(1 + std::abs(ref)));
+        }
+    }
+}
+
+TEST(dynamics, Test1)
+{
+    // 標準アーム・直動関節を含むモデルでラグランジュ方程式と一致
+    check_lagrange(robot_model<double>(), 0);
+    check_lagrange(prismatic_model(), 100);
+
+    // 静止時は重力補償トルクのみ、質量0のモデルでは0
+    inverse_dynamics<double> id;
+    joint<double> q = {0.3, 0.2, 0.4, 0.2, 0.8, 0}, zero;
+    auto pa = to_pose_array(id.rm, q);
+    joint<double> g = id.gravity(pa), tau = id(q, zero, zero);
+    for(int i=0; i<6; i++) EXPECT_EQ(g.val[i], tau.val[i]);
+    EXPECT_NEAR(g.val[0], 0, 1e-12);                // 第1軸は鉛直
+    EXPECT_GT(std::abs(g.val[1]), 1);
+
+    // 手先に追加した質量による重力補償トルクの差は J^T m g
+    robot_model<double> rm2 = id.rm;
+    link_inertia<double>& l6 = rm2.inertia[5];
+    l6.c = l6.c*(l6.m/(l6.m + 1.0));     // 第6軸原点に1kgを追加した重心
+    l6.m += 1.0;
+    joint<double> g2 = inverse_dynamics<double>(rm2).gravity(pa);
+    jacobian<double> jac(id.rm);
+    jac(pa, pa[6].p);
+    for(int i=0; i<6; i++) EXPECT_NEAR(g2.val[i] - g.val[i], -(jac.v[i]*rm2.gravity)*1.0, 1e-9);
+
+    robot_model<double,3> rm3(std::vector<vec3<double>>(3, vec3<double>(0, 0, 0.1)), std::vector<vec3<double>>(3, vec3<double>(0, 1, 0)));
+    joint<double,3> t3 = inverse_dynamics<double,3>(rm3)(joint<double,3>{0.1, 0.2, 0.3}, joint<double,3>{1, 1, 1}, joint<double,3>{1, 1, 1});
+    for(int i=0; i<3; i++) EXPECT_EQ(t3.val[i], 0);
+}
+
+TEST(dynamics, Test2)
+{
+    // 一括計算・トルク制約判定
+    inverse_dynamics<double> id;
+    const int num = 2000;
+    std::vector<double> buf(7*6*num);
+    double *q[6], *qd[6], *qdd[6], *tau[6];
+    for(int i=0; i<6; i++)
+    {
+        q[i] = &buf[i*num];
+        qd[i] = &buf[(6+i)*num];
+        qdd[i] = &buf[(12+i)*num];
+        tau[i] = &buf[(18+i)*num];
+    }
+    for(int k=0; k<num; k++)
+    {
+        double t = 2.0*k/num;
+        for(int i=0; i<6; i++)
+        {
+            q[i][k] = sin(t*(i+1));
+            qd[i][k] = (i+1)*cos(t*(i+1));
+            qdd[i][k] = -(i+1)*(i+1)*sin(t*(i+1));
+        }
+    }
+    EXPECT_EQ(id.batch(q, qd, qdd, num, tau), -1);
+    double peak = 0;
+    int expect = -1;
+    for(int k=0; k<num; k++)
+    {
+        joint<double> x, v, a;
+        for(int i=0; i<6; i++) { x.val[i] = q[i][k]; v.val[i] = qd[i][k]; a.val[i] = qdd[i][k]; }
+        joint<double> t = id(x, v, a);
+        for(int i=0; i<6; i++) EXPECT_EQ(tau[i][k], t.val[i]);
+        peak = std::max(peak, std::abs(t.val[1]));
+    }
+    joint_limit<double> lim;
+    lim.tmax.val[1] = 0.9*peak;
+    for(int k=0; k<num && expect<0; k++) if(std::abs(tau[1][k]) > lim.tmax.val[1]) expect = k;
+
+    std::vector<unsigned int> out(num), out2(num, 0);
+    EXPECT_EQ(id.batch(q, qd, qdd, num, nullptr, &lim, &out[0]), expect);
+    thread_pool pool(3);
+    EXPECT_EQ(id.batch(q, qd, qdd, num, nullptr, &lim, nullptr, &pool), expect);
+    lim.check_tau(tau, num, &out2[0]);
+    for(int k=0; k<num; k++) EXPECT_EQ(out[k], out2[k]);
+    EXPECT_EQ(out[expect], 2u);
+
+    // 計算済みFK座標系からの計算は順運動学を含む計算と一致
+    joint<double> x = {0.3, 0.2, 0.4, 0.2, 0.8, 0}, v = {1, -1, 0.5, 2, -2, 3}, a = {3, 2, -1, 5, 4, -6};
+    joint<double> t1 = id(x, v, a), t2 = id(to_pose_array(id.rm, x), v, a);
+    for(int i=0; i<6; i++) EXPECT_EQ(t1.val[i], t2.val[i]);
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
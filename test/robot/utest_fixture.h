@@ -0,0 +1,81 @@
+/**
+ * @file utest_fixture.h
+ * @brief 計画・到達性のテストで共通の角度制約と干渉判定
+ */
+#pragma once
+#include <robot/joint_limit.h>
+#include <robot/bvh.h>
+#include <robot/geometry.h>
+
+namespace kinematics
+{
+
+/**
+ * @brief 標準アームの角度制約（qminB/qmaxB、速度・加速度は制約なし）
+ */
+inline joint_limit<double> arm_limits()
+{
+    return robot_model<double>().lim;
+}
+
+/**
+ * @brief 標準アームの作業範囲を覆う到達可能性マップの範囲
+ */
+inline aabb<double> arm_region()
+{
+    aabb<double> ret;
+    ret.lo = vec3<double>(-0.8, -0.8, -0.4);
+    ret.hi = vec3<double>( 0.8,  0.8,  1.2);
+    return ret;
+}
+
+/**
+ * @brief ワーカー毎の干渉判定（自己干渉・始点と終点の間の壁）
+ */
+struct wall_checker
+{
+    std::vector<self_collision<double>> robot;
+    bvh<double> env;
+
+    wall_checker(int n)
+    {
+        robot_model<double> rm;
+        this->robot.assign(n, self_collision<double>(rm, 0.03));
+        // 始点・終点の間の壁（上を越えるか脇を回る）
+        this->env.add(pose<double>(vec3<double>(0.32, 0, 0.5), vec4<double>()), vec3<double>(0.05, 0.08, 0.3));
+        this->env.build();
+    }
+
+    bool operator()(const joint<double>& q, int worker)
+    {
+        self_collision<double>& r = this->robot[worker];
+        std::array<fpose<double>, 7> pa = to_pose_array(r.rm, q);
+        return !r(pa) && !this->env.collide(r, pa);
+    }
+
+    /**
+     * @brief 経路の全区間を細かく判定
+     * @details 計画は分解能毎の点で判定するため、点の間のかすめる程度の侵入（1mm未満）は許す
+     * @param [in] path 経路
+     * @param [in] div 区間毎の分割数
+     */
+    bool dense(const std::vector<joint<double>>& path, int div=50)
+    {
+        for(size_t n=0; n+1<path.size(); n++)
+        {
+            for(int k=0; k<=div; k++)
+            {
+                joint<double> q;
+                for(int i=0; i<6; i++) q.val[i] = path[n].val[i] + (path[n+1].val[i] - path[n].val[i])*k/(double)div;
+                self_collision<double>& r = this->robot[0];
+                std::array<fpose<double>, 7> pa = to_pose_array(r.rm, q);
+                double ds;
+                r(pa, &ds);
+                if(std::min(ds, this->env.distance(r, pa)) < -1e-3) return false;
+            }
+        }
+        return true;
+    }
+};
+
+}
@@ -0,0 +1,45 @@
+#include <gtest/gtest.h>
+#include <robot/ik_select.h>
+using namespace kinematics;
+
+TEST(ik_select, Test1)
+{
+    joint<double> qmin = {-2*M_PI,-2,-2,-2*M_PI,-2,-2*M_PI};
+    joint<double> qmax = { 2*M_PI, 2, 2, 2*M_PI, 2, 2*M_PI};
+    ik_select<double> sel(qmin, qmax);
+
+    joint<double> cand[4] = {
+        { 0.1, 0.2, 0.3, 0.4,  0.5, 0.6},
+        { 0.1, 0.2, 0.3, 0.4, -0.5, 0.6},
+        { 0.1, 2.5, 0.3, 0.4,  0.5, 0.6},   // 角度制約外
+        { NAN, 0.2, 0.3, 0.4,  0.5, 0.6},   // 無効解
+    };
+    joint<double> out;
+
+    // 現在角に最も近い回転数へ展開
+    joint<double> cur = {0.1, 0.2, 0.3, 0.4-2*M_PI, 0.5, 0.6+2*M_PI-0.1};
+    EXPECT_EQ(sel(cand, 4, cur, out), 0);
+    EXPECT_TRUE(out == joint<double>({0.1, 0.2, 0.3, 0.4-2*M_PI, 0.5, 0.6}));     // 軸6は制約内で最も近い回転数
+
+    // 形態指定
+    SFLG1 flg1 = FlgChk(cand[1]).flg1;
+    EXPECT_EQ(sel(cand, 4, cur, out, &flg1), 1);
+    EXPECT_EQ(FlgChk(out).flg1.val, flg1.val);
+
+    // 回転数指定
+    SFLG2 flg2;
+    flg2.SET(5, -1);
+    EXPECT_EQ(sel(cand, 4, cur, out, nullptr, &flg2), 0);
+    EXPECT_TRUE(out == joint<double>({0.1, 0.2, 0.3, 0.4, 0.5, 0.6-2*M_PI}));
+    EXPECT_EQ(FlgChk(out).flg2.val, flg2.val);
+
+    // 該当なし
+    flg2.SET(1, 1);
+    EXPECT_EQ(sel(cand, 4, cur, out, nullptr, &flg2), -1);
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,147 @@
+#include <gtest/gtest.h>
+#include <robot/interval.h>
+#include <random>
+using namespace kinematics;
+
+TEST(interval, Test1)
+{
+    // 区間演算（サンプリングを包含）
+    std::mt19937 g(1);
+    std::uniform_real_distribution<double> U(-4, 4);
+    for(int n=0; n<500; n++)
+    {
+        double a = U(g), b = a + std::abs(U(g));
+        interval<double> x(a, b), y(-0.5, 0.3);
+        interval<double> s = sin(x), c = cos(x), p = x*y, d = x - y;
+        EXPECT_LE(s.hi, 1);
+        EXPECT_GE(c.lo, -1);
+        for(int i=0; i<=100; i++)
+        {
+            double v = std::min(a + (b-a)*i/100, b);
+            EXPECT_TRUE(s.contains(std::sin(v)));
+            EXPECT_TRUE(c.contains(std::cos(v)));
+            EXPECT_TRUE(p.contains(v*0.3) && p.contains(v*-0.5));
+            EXPECT_TRUE(d.contains(v-0.3) && d.contains(v+0.5));
+        }
+    }
+    interval<double> s = sin(interval<double>(0.1, 0.2));
+    EXPECT_DOUBLE_EQ(s.lo, std::sin(0.1));
+    EXPECT_DOUBLE_EQ(s.hi, std::sin(0.2));
+    s = sin(interval<double>(1, 2));
+    EXPECT_EQ(s.hi, 1);
+    EXPECT_DOUBLE_EQ(s.lo, std::sin(1.0));
+    s = cos(interval<double>(-0.1, 7));
+    EXPECT_EQ(s.lo, -1);
+    EXPECT_EQ(s.hi, 1);
+
+    // vec3の要素型
+    vec3<interval<double>> v(interval<double>(1, 2), 0.0, interval<double>(-1, 1));
+    vec3<interval<double>> w = v*2.0 + vec3<interval<double>>(1, 1, 1);
+    EXPECT_DOUBLE_EQ(w.x.lo, 3);
+    EXPECT_DOUBLE_EQ(w.x.hi, 5);
+    EXPECT_LE(w.x.lo, 3);   // 外側への丸め
+    EXPECT_GE(w.x.hi, 5);
+    interval<double> dot = v*v;
+    EXPECT_NEAR(dot.lo, 0, 1e-12);
+    EXPECT_DOUBLE_EQ(dot.hi, 5);
+}
+
+TEST(interval, Test2)
+{
+    // 幅0の区間は点の順運動学と一致
+    robot_model<double> rm;
+    joint<double> q = {0.3, -0.5, 1.2, 0.4, -0.7, 2.0};
+    pose<double> base(vec3<double>(0.1, 0.2, 0.3), vec4<double>(vec3<double>(1, 1, 0), 0.5));
+    std::array<fpose<double>, 7> pa = to_pose_array(rm, q, base);
+    std::array<interval_frame<double>, 7> fr = to_interval_frames(rm, q, q, base);
+    for(int k=0; k<7; k++)
+    {
+        EXPECT_NEAR(fr[k].p.x.lo, pa[k].p.x, 1e-12);
+        EXPECT_NEAR(fr[k].p.y.hi, pa[k].p.y, 1e-12);
+        EXPECT_NEAR(fr[k].p.z.mid(), pa[k].p.z, 1e-12);
+        for(int r=0; r<3; r++)
+        {
+            vec3<double> e;
+            (&e.x)[r] = 1;
+            vec3<double> col = rotate(pa[k].q, e);
+            EXPECT_NEAR(fr[k].R[0][r].lo, col.x, 1e-12);
+            EXPECT_NEAR(fr[k].R[1][r].hi, col.y, 1e-12);
+            EXPECT_NEAR(fr[k].R[2][r].mid(), col.z, 1e-12);
+        }
+    }
+}
+
+TEST(interval, Test3)
+{
+    // リンクの包含箱は範囲内の全姿勢の形状を含み、範囲が狭いほど小さい
+    robot_model<double> rm;
+    self_collision<double> robot(rm, 0.04);
+    std::mt19937 g(2);
+    std::uniform_real_distribution<double> U(-2, 2), R(0, 1);
+    double vol[2] = {0, 0};
+    for(int n=0; n<100; n++)
+    {
+        joint<double> lo, hi;
+        double w = (n%2) ? 0.02 : 0.4;
+        for(int i=0; i<6; i++)
+        {
+            lo[i] = U(g);
+            hi[i] = lo[i] + w*R(g);
+        }
+        std::array<aabb<double>, 7> box = link_bounds(robot, lo, hi);
+        EXPECT_GT(box[0].hi.x, box[0].lo.x);
+        EXPECT_GT(box[6].lo.x, box[6].hi.x);    // 形状なし
+        for(int m=0; m<50; m++)
+        {
+            joint<double> q;
+            for(int i=0; i<6; i++) q[i] = lo[i] + (hi[i]-lo[i])*R(g);
+            std::array<fpose<double>, 7> pa = to_pose_array(rm, q);
+            for(int k=0; k<6; k++)
+            {
+                for(const auto& c : robot.shapes(k))
+                {
+                    aabb<double> b = bounds(capsule<double>{transform<double>(pa[k], c.a), transform<double>(pa[k], c.b), c.r});
+                    EXPECT_LE(box[k].lo.x, b.lo.x + 1e-12);
+                    EXPECT_LE(box[k].lo.y, b.lo.y + 1e-12);
+                    EXPECT_LE(box[k].lo.z, b.lo.z + 1e-12);
+                    EXPECT_GE(box[k].hi.x, b.hi.x - 1e-12);
+                    EXPECT_GE(box[k].hi.y, b.hi.y - 1e-12);
+                    EXPECT_GE(box[k].hi.z, b.hi.z - 1e-12);
+                }
+            }
+        }
+        vec3<double> e = box[5].hi - box[5].lo;
+        vol[n%2] += e.x*e.y*e.z;
+    }
+    EXPECT_LT(vol[1], 0.2*vol[0]);
+}
+
+TEST(interval, Test4)
+{
+    // 関節空間の箱単位の干渉除外
+    robot_model<double> rm;
+    self_collision<double> robot(rm, 0.04);
+    bvh<double> env;
+    env.add(pose<double>(vec3<double>(0.5, 0, 0.3), vec4<double>()), vec3<double>(0.1, 0.4, 0.6));
+    env.build();
+
+    joint<double> lo = {2.5, -0.2, 0.3, -0.2, -0.2, -0.2};      // 後方
+    joint<double> hi = {3.0,  0.2, 0.7,  0.2,  0.2,  0.2};
+    std::array<aabb<double>, 7> box = link_bounds(robot, lo, hi);
+    for(int k=0; k<7; k++) EXPECT_FALSE(env.overlap(box[k]));
+
+    joint<double> lo2 = {-0.2, 0.6, 0.3, -0.2, -0.2, -0.2};    // 前方に倒す
+    joint<double> hi2 = { 0.2, 1.0, 0.7,  0.2,  0.2,  0.2};
+    std::array<aabb<double>, 7> box2 = link_bounds(robot, lo2, hi2);
+    bool any = false;
+    for(int k=0; k<7; k++) any |= env.overlap(box2[k]);
+    EXPECT_TRUE(any);
+    joint<double> q = {0, 0.8, 0.5, 0, 0, 0};
+    EXPECT_TRUE(env.collide(robot, to_pose_array(rm, q)));
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,126 @@
+#include <gtest/gtest.h>
+#include <robot/robot.h>
+using namespace kinematics;
+
+TEST(joint_limit, Test1)
+{
+    joint<double> qmin = {-1,-1,-1,-1,-1,-1};
+    joint<double> qmax = { 1, 2, 1, 2, 1, 2};
+    joint<double> vmax = { 1, 1, 1, 1, 1, 1};
+    joint<double> amax = { 5, 5, 5, 5, 5, 5};
+    joint_limit<double> lim(qmin, qmax, vmax, amax);
+
+    // 単体判定
+    joint<double> q = {0, 1.5, 1.5, 0, -2, 0};
+    EXPECT_EQ(lim.check(q), 0b010100u);
+    unsigned int mask;
+    EXPECT_TRUE(LimChk(q, lim, &mask));
+    EXPECT_EQ(mask, 0b010100u);
+    EXPECT_FALSE(LimChk(joint<double>(), lim));
+
+    joint<double> v = {0, 0, 0, 0, 0, -1.5};
+    joint<double> a = {6, 0, 0, 0, 0, 0};
+    EXPECT_EQ(lim.check(joint<double>(), v, a), 0b100001u);
+
+    // 一括判定・飽和（SoA）
+    const int N = 100;
+    std::vector<std::vector<double>> soa(6, std::vector<double>(N));
+    std::vector<joint<double>> jnt(N);
+    for(int k=0; k<N; k++)
+        for(int i=0; i<6; i++)
+            jnt[k][i] = soa[i][k] = -3.0 + 6.0*((k*7+i*3)%N)/N;
+
+    double *qp[6];
+    for(int i=0; i<6; i++) qp[i] = &soa[i][0];
+    std::vector<unsigned int> m(N), ms(N);
+    lim.check(qp, N, &m[0]);
+    lim.sat(qp, N, &ms[0]);
+    for(int k=0; k<N; k++)
+    {
+        joint<double> out_of_range;
+        joint<double> ref = jnt[k].sat(qmin, qmax, &out_of_range);
+        unsigned int mref = 0;
+        for(int i=0; i<6; i++) if(out_of_range[i]) mref |= 1u<<i;
+        EXPECT_EQ(m[k], lim.check(jnt[k]));
+        EXPECT_EQ(ms[k], mref);
+        for(int i=0; i<6; i++) EXPECT_EQ(soa[i][k], ref[i]);
+    }
+
+    // 速度・加速度の一括判定は論理和
+    lim.check_vel(qp, N, &m[0]);
+    lim.check_acc(qp, N, &m[0]);
+    for(int k=0; k<N; k++)
+    {
+        joint<double> s;
+        for(int i=0; i<6; i++) s[i] = soa[i][k];
+        EXPECT_EQ(m[k], lim.check(jnt[k]) | lim.check(joint<double>(), s, s));
+    }
+}
+
+TEST(joint_limit, Test2)
+{
+    // NaNは制約外（飽和せずNaNのまま）
+    joint<double> qmin = {-1,-1,-1,-1,-1,-1};
+    joint<double> qmax = { 1, 1, 1, 1, 1, 1};
+    joint<double> vmax = { 1, 1, 1, 1, 1, 1};
+    joint_limit<double> lim(qmin, qmax, vmax);
+    joint<double> q = {0, NAN, 0, 0, 0, 0};
+    EXPECT_EQ(lim.check(q), 0b000010u);
+    EXPECT_EQ(lim.check(joint<double>(), q, joint<double>()), 0b000010u);
+    EXPECT_TRUE(LimChk(q, lim));
+    EXPECT_FALSE(q.in_range(qmin, qmax));
+    joint<double> out_of_range;
+    joint<double> s = q.sat(qmin, qmax, &out_of_range);
+    EXPECT_TRUE(std::isnan(s[1]));
+    EXPECT_EQ(out_of_range[1], 1);
+    EXPECT_EQ(out_of_range[0], 0);
+
+    double x[6][2] = {{0, 0}, {NAN, 0.5}, {0, -NAN}, {0, 0}, {0, 0}, {2, 0}};
+    double *qp[6];
+    for(int i=0; i<6; i++) qp[i] = x[i];
+    unsigned int m[2];
+    lim.check(qp, 2, m);
+    EXPECT_EQ(m[0], 0b100010u);
+    EXPECT_EQ(m[1], 0b000100u);
+    lim.check_vel(qp, 2, m);
+    EXPECT_EQ(m[0], 0b100010u);
+    lim.sat(qp, 2, m);
+    EXPECT_EQ(m[0], 0b100010u);
+    EXPECT_EQ(m[1], 0b000100u);
+    EXPECT_TRUE(std::isnan(x[1][0]));
+    EXPECT_TRUE(std::isnan(x[2][1]));
+    EXPECT_EQ(x[5][0], 1);
+}
+
+TEST(joint_limit, Test3)
+{
+    // ロボットモデルの制約テーブル（標準アームはqminB/qmaxB）
+    robot_model<double> rm;
+    joint<double> q = {0, 0, 0, 0, 0, 0};
+    EXPECT_FALSE(LimChk(q));
+    EXPECT_FALSE(LimChk(rm, q));
+    q[2] = 2.6;
+    q[4] = -2.1;
+    EXPECT_TRUE(LimChk(q));
+    unsigned int mask;
+    EXPECT_TRUE(LimChk(rm, q, &mask));
+    EXPECT_EQ(mask, 0b010100u);
+    q[2] = q[4] = 0;
+    q[0] = -4.0;
+    EXPECT_TRUE(LimChk(q));
+
+    // 軸数を指定したモデルは制約なしから設定
+    robot_model<double,7> rm7(std::vector<vec3<double>>(7), std::vector<vec3<double>>(7, vec3<double>(0,0,1)));
+    joint<double,7> q7;
+    q7[6] = 10;
+    EXPECT_FALSE(LimChk(rm7, q7));
+    rm7.set_limit(std::vector<double>(7, -1), std::vector<double>(7, 1));
+    EXPECT_TRUE(LimChk(rm7, q7, &mask));
+    EXPECT_EQ(mask, 1u<<6);
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+#include <robot/numerical_ik.h>
+using namespace kinematics;
+
+TEST(numerical_ik, Test1)
+{
+    // 6軸アーム
+    numerical_ik<double> ik(posB(), alfaB());
+    double q0[6] = {0.1, -0.4, 0.7, 0.3, -0.5, 0.2};
+    double q1[6] = {0.3, -0.2, 0.5, 0.5, -0.3, 0.4};
+    pose<double> target = ik.forward(q1);
+
+    // 前回解からのウォームスタート
+    double q[6];
+    std::copy(q0, q0+6, q);
+    EXPECT_EQ(ik(target, q, 0.1), IK_SUCCESS);
+    EXPECT_LE(ik.err, 1e-6);
+    EXPECT_LT(pose_error(target, ik.forward(q)).nrm(), 1e-5);
+
+    // 期限切れでは初期値（最良解）を返す
+    std::copy(q0, q0+6, q);
+    EXPECT_EQ(ik(target, q, numerical_ik<double>::clock::now()), IK_TIMEOUT);
+    for(int i=0; i<6; i++) EXPECT_EQ(q[i], q0[i]);
+}
+
+TEST(numerical_ik, Test2)
+{
+    // 7軸冗長リンク + ツール、角度制約と重み付き
+    std::vector<vec3<double>> pos = posB();
+    std::vector<vec3<double>> alfa = alfaB();
+    pos.insert(pos.begin()+3, vec3<double>(0,0,0.1));
+    alfa.insert(alfa.begin()+3, vec3<double>(1,0,0));
+    pose<double> tool(vec3<double>(0,0,0.1), vec4<double>(0,M_PI/2,0));
+    numerical_ik<double> ik(pos, alfa, pose<double>(), tool);
+    ik.set_limit(std::vector<double>(7,-1.0), std::vector<double>(7,1.0));
+    ik.wgt[0] = 0.1;
+
+    double q1[7] = {0.2, -0.3, 0.4, 0.2, 0.6, -0.4, 0.5};
+    pose<double> target = ik.forward(q1);
+    double q[7] = {0};
+    EXPECT_EQ(ik(target, q, 0.1), IK_SUCCESS);
+    EXPECT_LT(pose_error(target, ik.forward(q)).nrm(), 1e-5);
+    for(int i=0; i<7; i++) EXPECT_LE(std::abs(q[i]), 1.0);
+
+    // 到達不能（最良解を出力）
+    target.p = vec3<double>(2,0,0);
+    EXPECT_EQ(ik(target, q, 0.1), IK_NOT_CONVERGED);
+    EXPECT_GT(ik.err, 0.5);
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include <robot/path_smoother.h>
+#include <robot/rrt.h>
+#include <robot/topp.h>
+#include <random>
+#include "utest_fixture.h"
+using namespace kinematics;
+
+/**
+ * @brief 速度・加速度制約を含む角度制約
+ */
+static joint_limit<double> limits()
+{
+    joint_limit<double> ret = arm_limits();
+    ret.vmax.val.fill(2.0);
+    ret.amax.val.fill(5.0);
+    return ret;
+}
+
+/**
+ * @brief 折れ線の所要時間（角で停止するため区間毎に静止から静止）
+ */
+static double polyline_time(topp<double>& tp, const std::vector<joint<double>>& path)
+{
+    double ret = 0;
+    for(size_t k=0; k+1<path.size(); k++)
+    {
+        std::vector<joint<double>> seg(21);
+        for(int m=0; m<=20; m++)
+            for(int i=0; i<6; i++) seg[m].val[i] = path[k].val[i] + (path[k+1].val[i] - path[k].val[i])*m/20.0;
+        ret += tp(seg);
+    }
+    return ret;
+}
+
+TEST(path_smoother, Test1)
+{
+    // 障害物のない折れ線は直線に近づく
+    path_smoother<double> ps([](const joint<double>&, int){ return true; });
+    std::vector<joint<double>> path;
+    for(int k=0; k<=10; k++)
+    {
+        joint<double> q;
+        for(int i=0; i<6; i++) q.val[i] = 0.1*k + ((k%2) ? 0.2 : -0.2)*(i%2 ? 1 : -1)*(k>0 && k<10);
+        path.push_back(q);
+    }
+    joint<double> q0 = path.front(), q1 = path.back();
+    double len0 = path_smoother<double>::length(path);
+    ps.shortcut(path);
+    double len1 = path_smoother<double>::length(path);
+    double direct = path_smoother<double>::length(std::vector<joint<double>>{q0, q1});
+    EXPECT_GT(ps.applied, 0);
+    EXPECT_LT(len1, len0);
+    EXPECT_DOUBLE_EQ(ps.length_before, len0);
+    EXPECT_DOUBLE_EQ(ps.length_after, len1);
+    EXPECT_LT(ps.time_after, ps.time_before);
+    EXPECT_LT(len1, 1.05*direct);
+    EXPECT_EQ(kd_tree<double>::dist2(path.front(), q0), 0);
+    EXPECT_EQ(kd_tree<double>::dist2(path.back(), q1), 0);
+
+    // 平滑化は分解能毎の点列で端点を通る
+    ASSERT_TRUE(ps.smooth(path));
+    EXPECT_EQ(kd_tree<double>::dist2(path.front(), q0), 0);
+    EXPECT_EQ(kd_tree<double>::dist2(path.back(), q1), 0);
+    for(size_t k=0; k+1<path.size(); k++)
+        for(int i=0; i<6; i++)
+            EXPECT_LE(std::abs(path[k+1].val[i] - path[k].val[i]), ps.resolution + 1e-12);
+
+    // 全て無効な判定では平滑化しない
+    std::vector<joint<double>> zig = {q0, joint<double>{0.5, 0, 0, 0, 0, 0}, q1}, org = zig;
+    path_smoother<double> ng([](const joint<double>&, int){ return false; });
+    EXPECT_FALSE(ng.smooth(zig));
+    EXPECT_EQ(zig.size(), org.size());
+}
+
+TEST(path_smoother, Test2)
+{
+    // RRTの経路の後処理（経路長・所要時間）
+    thread_pool pool(2);
+    wall_checker chk(pool.size());
+    rrt_connect<double> rrt(limits(), std::ref(chk), &pool);
+    path_smoother<double> ps(std::ref(chk), &pool);
+    topp<double> tp(limits());
+
+    joint<double> q0 = {-0.9, 0.6, 0.6, 0, 0.6, 0};
+    joint<double> q1 = { 0.9, 0.6, 0.6, 0, 0.6, 0};
+    double len0 = 0, len1 = 0, t0 = 0, t1 = 0;
+    const int num = 10;
+    for(int n=0; n<num; n++)
+    {
+        std::vector<joint<double>> path;
+        ASSERT_EQ(rrt(q0, q1, path), PLAN_SUCCESS);
+        len0 += path_smoother<double>::length(path);
+        t0 += polyline_time(tp, path);
+
+        EXPECT_TRUE(ps(path));
+        len1 += path_smoother<double>::length(path);
+        EXPECT_DOUBLE_EQ(ps.length_after, path_smoother<double>::length(path));
+        EXPECT_LT(ps.length_after, ps.length_before);
+        EXPECT_LT(ps.time_after, ps.time_before);
+        double t = tp(path);
+        EXPECT_FALSE(std::isnan(t));
+        t1 += t;
+
+        EXPECT_EQ(kd_tree<double>::dist2(path.front(), q0), 0);
+        EXPECT_EQ(kd_tree<double>::dist2(path.back(), q1), 0);
+        EXPECT_TRUE(chk.dense(path, 20));
+    }
+    EXPECT_LT(len1, 0.8*len0);
+    EXPECT_LT(t1, t0);
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
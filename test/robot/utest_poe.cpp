@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+#include <robot/poe.h>
+using namespace kinematics;
+
+TEST(poe, Test1)
+{
+    // 標準アーム: to_pose_arrayと一致
+    poe<double> fk;
+    jacobian<double> J1, J2;
+    for(int k=0; k<50; k++)
+    {
+        joint<double> q;
+        for(int i=0; i<6; i++) q[i] = -3.0 + 6.0*((k*37+i*11)%50)/50.0;
+        pose<double> end = fk(q);
+        std::vector<fpose<double>> pa = to_pose_array(q);
+        for(int i=0; i<=6; i++)
+        {
+            pose<double> f = fk.frame(i);
+            EXPECT_TRUE(f.p == pa[i].p);
+            EXPECT_TRUE(f.q.eq(pa[i].q));
+        }
+        EXPECT_TRUE(end.p == pa[6].p);
+
+        // ヤコビ行列の共有
+        fk.jacobian_to(J1);
+        J2(pa);
+        for(int i=0; i<6; i++)
+        {
+            EXPECT_TRUE(J1.v[i] == J2.v[i]);
+            EXPECT_TRUE(J1.w[i] == J2.w[i]);
+        }
+    }
+}
+
+TEST(poe, Test2)
+{
+    // 直動軸付き7軸とベース姿勢
+    std::vector<vec3<double>> pos = posB();
+    std::vector<vec3<double>> alfa = alfaB();
+    pos.insert(pos.begin(), vec3<double>(0.1,0,0));
+    alfa.insert(alfa.begin(), vec3<double>(0,1,0));
+    std::vector<JOINT_TYPE> type(7, REVOLUTE);
+    type[0] = PRISMATIC;
+    robot_model<double,7> rm(pos, alfa, type);
+    pose<double> posI(vec3<double>(1,2,3), vec4<double>(0.1,0.2,0.3));
+
+    poe<double,7> fk(rm, posI);
+    joint<double,7> q = {0.4, 0.1, -0.4, 0.7, 0.3, -0.5, 0.2};
+    pose<double> end = fk(q);
+    std::array<fpose<double>, 8> pa = to_pose_array(rm, q, posI);
+    EXPECT_TRUE(end.p == pa[7].p);
+    EXPECT_TRUE(end.q.eq(pa[7].q));
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include <robot/reach_shard.h>
+#include <sys/stat.h>
+#include "utest_fixture.h"
+using namespace kinematics;
+
+static void expect_same(const reach_map<double>& a, const reach_map<double>& b)
+{
+    ASSERT_TRUE(a.same_grid(b));
+    EXPECT_EQ(a.samples, b.samples);
+    EXPECT_EQ(a.first, b.first);
+    EXPECT_EQ(a.config, b.config);
+    for(int k=0; k<a.nz; k++)
+        for(int j=0; j<a.ny; j++)
+            for(int i=0; i<a.nx; i++)
+                EXPECT_EQ(memcmp(&a.at(i, j, k), &b.at(i, j, k), sizeof(reach_cell)), 0);
+}
+
+TEST(reach_shard, Test1)
+{
+    // 担当範囲は[0,total)を重なりなく覆う
+    for(uint64_t total : {0ULL, 1ULL, 7ULL, 1000ULL, 1000003ULL})
+        for(int count : {1, 3, 16})
+        {
+            uint64_t end = 0;
+            for(int i=0; i<count; i++)
+            {
+                uint64_t first, num;
+                shard_range(total, count, i, first, num);
+                EXPECT_EQ(first, end);
+                EXPECT_LE(num, total/count + 1);
+                end = first + num;
+            }
+            EXPECT_EQ(end, total);
+        }
+    EXPECT_EQ(shard_path("/tmp/reach", 3, 16), "/tmp/reach.00003-of-00016.krmp");
+}
+
+TEST(reach_shard, Test2)
+{
+    // 分割集計して統合すると一括の集計と一致
+    robot_model<double> rm;
+    joint_limit<double> lim = arm_limits();
+    const uint64_t total = 30000;
+    reach_map<double> whole;
+    whole.build(rm, lim, arm_region(), 0.1, total);
+
+    std::string prefix = testing::TempDir() + "reach_shard_test";
+    std::vector<std::string> paths;
+    for(int i=2; i>=0; i--)
+    {
+        paths.push_back(shard_path(prefix, i, 3));
+        ASSERT_TRUE(run_shard(rm, lim, arm_region(), 0.1, 4, total, 3, i, paths.back()));
+    }
+    reach_map<double> merged;
+    EXPECT_EQ(merge_shards(paths, merged, total), MERGE_SUCCESS);
+    expect_same(merged, whole);
+
+    // 完成済みの分割は再集計しない（書き直せば一時ファイルからの名前変更でinodeが変わる）
+    struct stat st0, st1;
+    ASSERT_EQ(stat(paths[2].c_str(), &st0), 0);
+    EXPECT_TRUE(run_shard(rm, lim, arm_region(), 0.1, 4, total, 3, 0, paths[2]));
+    ASSERT_EQ(stat(paths[2].c_str(), &st1), 0);
+    EXPECT_EQ(st0.st_ino, st1.st_ino);
+    EXPECT_EQ(st0.st_mtime, st1.st_mtime);
+
+    // 欠け・重なり・読み込み失敗
+    std::string bad;
+    reach_map<double> m;
+    EXPECT_EQ(merge_shards(std::vector<std::string>{paths[0], paths[1]}, m, total), MERGE_GAP);
+    EXPECT_EQ(merge_shards(std::vector<std::string>{paths[0], paths[2]}, m), MERGE_GAP);
+    EXPECT_EQ(merge_shards(std::vector<std::string>{paths[1], paths[2]}, m), MERGE_SUCCESS);
+    EXPECT_EQ(merge_shards(std::vector<std::string>{paths[0], paths[1], paths[2], paths[1]}, m, total), MERGE_OVERLAP);
+    EXPECT_EQ(merge_shards(std::vector<std::string>{paths[0], prefix + ".missing"}, m, total, &bad), MERGE_READ_ERROR);
+    EXPECT_EQ(bad, prefix + ".missing");
+
+    // 条件・格子の異なる部分マップは統合しない
+    std::string other = prefix + ".other.krmp";
+    ASSERT_TRUE(run_shard(rm, lim, arm_region(), 0.1, 4, total, 3, 1, other, nullptr, 2));
+    EXPECT_EQ(merge_shards(std::vector<std::string>{paths[0], other, paths[2]}, m, total, &bad), MERGE_CONFIG_MISMATCH);
+    EXPECT_EQ(bad, other);
+    ASSERT_TRUE(run_shard(rm, lim, arm_region(), 0.2, 4, total, 3, 1, other));
+    EXPECT_EQ(merge_shards(std::vector<std::string>{paths[0], other, paths[2]}, m, total), MERGE_GRID_MISMATCH);
+
+    for(const auto& p : paths) remove(p.c_str());
+    remove(other.c_str());
+}
+
+TEST(reach_shard, Test3)
+{
+    // 子プロセスでの分割集計
+    robot_model<double> rm;
+    joint_limit<double> lim = arm_limits();
+    const uint64_t total = 40000;
+    reach_map<double> whole;
+    whole.build(rm, lim, arm_region(), 0.1, total, nullptr, 5);
+
+    // 呼び出し側の子プロセスの終了状態は奪わない
+    pid_t own = fork();
+    ASSERT_GE(own, 0);
+    if(own==0) _exit(7);
+
+    std::string prefix = testing::TempDir() + "reach_local_test";
+    reach_map<double> merged;
+    ASSERT_TRUE(run_local(rm, lim, arm_region(), 0.1, 4, total, 5, prefix, 2, 1, merged, 5));
+    expect_same(merged, whole);
+    int status;
+    ASSERT_EQ(waitpid(own, &status, 0), own);
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 7);
+    for(int i=0; i<5; i++) remove(shard_path(prefix, i, 5).c_str());
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+#include <robot/reachability.h>
+#include "utest_fixture.h"
+using namespace kinematics;
+
+TEST(reachability, Test1)
+{
+    robot_model<double> rm;
+    joint_limit<double> lim = arm_limits();
+    thread_pool pool(2);
+    reach_map<double> map;
+    const int num = 200000;
+    map.build(rm, lim, arm_region(), 0.05, num, &pool);
+    EXPECT_EQ(map.samples, (uint64_t)num);
+    EXPECT_EQ(map.bins(), 32);
+
+    // サンプル数の合計（全て範囲内）
+    uint64_t total = 0;
+    for(int k=0; k<map.nz; k++)
+        for(int j=0; j<map.ny; j++)
+            for(int i=0; i<map.nx; i++) total += map.at(i, j, k).count;
+    EXPECT_EQ(total, (uint64_t)num);
+
+    // 抽出した姿勢は到達可能
+    for(int k=0; k<100; k++)
+    {
+        joint<double> q;
+        for(int i=0; i<6; i++) q.val[i] = lim.qmin.val[i] + (lim.qmax.val[i] - lim.qmin.val[i])*counter_uniform(1, k, i);
+        fpose<double> P = to_pose(rm, q);
+        EXPECT_TRUE(map.reachable(P));
+        EXPECT_GT(map.score(P.p), 0);
+    }
+
+    // 届かない位置・範囲外
+    EXPECT_EQ(map.score(vec3<double>(0.75, 0.75, 1.15)), 0);
+    EXPECT_EQ(map.at(vec3<double>(2, 0, 0)), nullptr);
+    EXPECT_EQ(map.manipulability(vec3<double>(2, 0, 0)), 0);
+
+    // 可操作度は特異姿勢の近くで小さい
+    jacobian<double> jac(rm);
+    jac(to_pose_array(rm, joint<double>{0.3, 0.2, 0.4, 0, 0, 0}));     // 手首特異
+    EXPECT_NEAR(jac.manipulability(), 0, 1e-9);
+    jac(to_pose_array(rm, joint<double>{0.3, 0.2, 0.4, 0.2, 0.8, 0}));
+    double w = jac.manipulability();
+    EXPECT_GT(w, 1e-4);
+    double A[6][6];
+    jac.JWJt(A);
+    // det(J J^T) を部分ピボットのLU分解で求めて比較
+    double det = 1;
+    for(int c=0; c<6; c++)
+    {
+        int p = c;
+        for(int r=c+1; r<6; r++) if(std::abs(A[r][c]) > std::abs(A[p][c])) p = r;
+        if(p!=c) { for(int k=0; k<6; k++) std::swap(A[c][k], A[p][k]); det = -det; }
+        det *= A[c][c];
+        for(int r=c+1; r<6; r++)
+        {
+            double f = A[r][c]/A[c][c];
+            for(int k=c; k<6; k++) A[r][k] -= f*A[c][k];
+        }
+    }
+    EXPECT_NEAR(w, sqrt(det), 1e-9);
+}
+
+TEST(reachability, Test2)
+{
+    // 分担によらず同じ結果・分けて集計して統合
+    robot_model<double> rm;
+    joint_limit<double> lim = arm_limits();
+    thread_pool pool(3);
+    reach_map<double> a, b, c;
+    a.build(rm, lim, arm_region(), 0.1, 20000);
+    b.build(rm, lim, arm_region(), 0.1, 20000, &pool);
+    c.resize(arm_region(), 0.1);
+    c.accumulate(rm, lim, 0, 5000);
+    reach_map<double> d;
+    d.resize(arm_region(), 0.1);
+    d.accumulate(rm, lim, 5000, 15000, &pool);
+    EXPECT_TRUE(c.merge(d));
+    EXPECT_EQ(c.samples, 20000u);
+    for(int k=0; k<a.nz; k++)
+        for(int j=0; j<a.ny; j++)
+            for(int i=0; i<a.nx; i++)
+            {
+                const reach_cell &x = a.at(i, j, k), &y = b.at(i, j, k), &z = c.at(i, j, k);
+                EXPECT_EQ(x.mask, y.mask);
+                EXPECT_EQ(x.count, y.count);
+                EXPECT_EQ(x.manip, y.manip);
+                EXPECT_EQ(x.mask, z.mask);
+                EXPECT_EQ(x.count, z.count);
+                EXPECT_EQ(x.manip, z.manip);
+            }
+
+    // 格子の異なるマップは統合しない
+    reach_map<double> e;
+    e.resize(arm_region(), 0.05);
+    EXPECT_FALSE(c.merge(e));
+
+    // 続けて集計しても条件が同じなら指紋を保ち、異なる種・ツールを混ぜると0
+    reach_map<double> f;
+    f.resize(arm_region(), 0.1);
+    f.accumulate(rm, lim, 0, 1000);
+    f.accumulate(rm, lim, 1000, 1000);
+    EXPECT_EQ(f.config, reach_fingerprint(rm, lim, pose<double>(), 1));
+    f.accumulate(rm, lim, 2000, 1000, nullptr, 2);
+    EXPECT_EQ(f.config, 0u);
+    reach_map<double> g;
+    g.resize(arm_region(), 0.1);
+    g.accumulate(rm, lim, 0, 1000);
+    g.accumulate(rm, lim, 1000, 1000, nullptr, 1, pose<double>(vec3<double>(0, 0, 0.1), vec4<double>()));
+    EXPECT_EQ(g.config, 0u);
+}
+
+TEST(reachability, Test3)
+{
+    // 保存・mmap読み込み
+    robot_model<double> rm;
+    reach_map<double> map;
+    map.build(rm, arm_limits(), arm_region(), 0.05, 50000);
+    std::string path = testing::TempDir() + "reach_test.bin";
+    ASSERT_TRUE(map.save(path));
+
+    reach_map<double> m;
+    ASSERT_TRUE(m.load(path));
+    EXPECT_TRUE(m.mapped());
+    EXPECT_TRUE(m.same_grid(map));
+    EXPECT_EQ(m.samples, map.samples);
+    for(int k=0; k<map.nz; k++)
+        for(int j=0; j<map.ny; j++)
+            for(int i=0; i<map.nx; i++)
+                EXPECT_EQ(memcmp(&m.at(i, j, k), &map.at(i, j, k), sizeof(reach_cell)), 0);
+
+    // 読み込んだマップの検索
+    for(int k=0; k<1000; k++)
+    {
+        vec3<double> p(1.6*counter_uniform(2, k, 0) - 0.8, 1.6*counter_uniform(2, k, 1) - 0.8, 1.6*counter_uniform(2, k, 2) - 0.4);
+        EXPECT_EQ(m.score(p), map.score(p));
+    }
+
+    // 読み込んだマップへの集計は複製してから
+    EXPECT_TRUE(m.merge(map));
+    EXPECT_FALSE(m.mapped());
+    EXPECT_EQ(m.samples, 2*map.samples);
+
+    // 不正なファイル
+    FILE *fp = fopen(path.c_str(), "r+b");
+    fwrite("XXXX", 1, 4, fp);
+    fclose(fp);
+    EXPECT_FALSE(m.load(path));
+    EXPECT_TRUE(m.empty());
+    remove(path.c_str());
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
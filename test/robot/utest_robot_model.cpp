@@ -0,0 +1,114 @@
+#include <gtest/gtest.h>
+#include <robot/velocity_ik.h>
+#include <robot/pose_array.h>
+using namespace kinematics;
+
+TEST(robot_model, Test1)
+{
+    // 標準アーム(6軸)はpose_arrayと一致
+    robot_model<double> arm;
+    joint<double> q = {0.1, -0.4, 0.7, 0.3, -0.5, 0.2};
+    std::array<fpose<double>, 7> pa = to_pose_array(arm, q);
+    pose_array<double> ref(posB(), alfaB(), &q.val[0]);
+    for(int i=0; i<7; i++) EXPECT_TRUE(pa[i] == ref[i]);
+    EXPECT_EQ(pa[6].flg1.val, FlgChk(q).flg1.val);
+}
+
+TEST(robot_model, Test2)
+{
+    // 7軸アーム（第3軸に冗長軸を追加）
+    std::vector<vec3<double>> pos = posB();
+    std::vector<vec3<double>> alfa = alfaB();
+    pos.insert(pos.begin()+3, vec3<double>(0,0,0.1));
+    alfa.insert(alfa.begin()+3, vec3<double>(1,0,0));
+    robot_model<double,7> arm7(pos, alfa);
+
+    joint<double,7> q = {0.1, -0.4, 0.7, 0.2, 0.3, -0.5, 7.0};
+    std::array<fpose<double>, 8> pa = to_pose_array(arm7, q);
+    pose_array<double> ref(pos, alfa, &q.val[0]);
+    for(int i=0; i<8; i++) EXPECT_TRUE(pa[i] == ref[i]);
+    EXPECT_EQ(pa[7].flg2.GET(6), 1);
+    EXPECT_EQ(pa[7].flg1.val, 0);
+
+    // 数値微分とヤコビ行列の比較
+    jacobian<double> J(arm7);
+    J(pa);
+    for(int i=0; i<7; i++)
+    {
+        joint<double,7> qp = q;
+        qp[i] += 1e-6;
+        twist<double> d = pose_error((pose<double>)to_pose(arm7, qp), (pose<double>)pa[7])*1e6;
+        EXPECT_LT((d.v-J.v[i]).nrm() + (d.w-J.w[i]).nrm(), 1e-4);
+    }
+}
+
+TEST(robot_model, Test3)
+{
+    // 6+1軸（直動走行軸＋標準アーム）
+    std::vector<vec3<double>> pos = posB();
+    std::vector<vec3<double>> alfa = alfaB();
+    pos.insert(pos.begin(), vec3<double>(0,0,0));
+    alfa.insert(alfa.begin(), vec3<double>(2,0,0));
+    std::vector<JOINT_TYPE> type(7, REVOLUTE);
+    type[0] = PRISMATIC;
+    robot_model<double,7> track(pos, alfa, type);
+
+    joint<double,7> q = {0.5, 0.1, -0.4, 0.7, 0.3, -0.5, 0.2};
+    joint<double> qa = {0.1, -0.4, 0.7, 0.3, -0.5, 0.2};
+    fpose<double> p = to_pose(track, q);
+    fpose<double> pa = to_pose(qa);
+    EXPECT_TRUE(p.p == pa.p + vec3<double>(0.5,0,0));
+    EXPECT_TRUE(p.q == pa.q);
+
+    // 走行軸の列は並進のみ
+    jacobian<double> J(track);
+    J(to_pose_array(track, q));
+    EXPECT_TRUE(J.v[0] == vec3<double>(1,0,0));
+    EXPECT_TRUE(J.w[0] == vec3<double>(0,0,0));
+
+    // 7軸での分解速度制御
+    joint<double,7> qmin, qmax, vmax;
+    qmin = qmin - 3;    qmax = qmax + 3;    vmax = vmax + 2;
+    velocity_ik<double,7> ik(0.001, qmin, qmax, vmax, 1e-3, 50, track);
+    pose<double> target = to_pose(track, joint<double,7>({0.6, 0.2, -0.3, 0.6, 0.4, -0.4, 0.3}));
+    for(int k=0; k<1000; k++)
+        q = q + ik(q, to_pose_array(track, q), target)*ik.dt;
+    EXPECT_LT(pose_error(target, (pose<double>)to_pose(track, q)).nrm(), 1e-6);
+}
+
+TEST(robot_model, Test4)
+{
+    // 走行軸はπを超えても回転数0（範囲外にならない）
+    std::vector<vec3<double>> pos = posB();
+    std::vector<vec3<double>> alfa = alfaB();
+    pos.insert(pos.begin(), vec3<double>(0,0,0));
+    alfa.insert(alfa.begin(), vec3<double>(1,0,0));
+    std::vector<JOINT_TYPE> type(7, REVOLUTE);
+    type[0] = PRISMATIC;
+    robot_model<double,7> track(pos, alfa, type);
+    joint<double,7> q = {30.0, 0.1, -0.4, 0.7, 0.3, -0.5, 4.0};
+    fpose<double> p = to_pose(track, q);
+    EXPECT_EQ(p.flg2.GET(0), 0);
+    EXPECT_EQ(p.flg2.GET(6), 1);
+    q[0] = 4.0;
+    EXPECT_EQ(FlgChk(track, q).flg2.GET(0), 0);
+
+    // 標準アーム以外の6軸モデルは形態フラグなし
+    robot_model<double> arm;
+    EXPECT_TRUE(arm.standard());
+    EXPECT_TRUE(robot_model<double>(posB(), alfaB()).standard());
+    joint<double> qa = {0.1, -0.4, 0.7, 0.3, -0.5, 0.2};
+    ASSERT_NE(to_pose(arm, qa).flg1.val, 0u);
+    robot_model<double> other = arm;
+    other.pos[2] = vec3<double>(0, -0.0367, 0.4);
+    EXPECT_FALSE(other.standard());
+    fpose<double> po = to_pose(other, qa);
+    EXPECT_EQ(po.flg1.val, 0u);
+    EXPECT_EQ(po.flg2.val, to_pose(arm, qa).flg2.val);
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include <robot/rrt.h>
+#include <random>
+#include "utest_fixture.h"
+using namespace kinematics;
+
+TEST(kdtree, Test1)
+{
+    // 総当たりとの比較（直線上の連続挿入を含む）
+    std::mt19937 g(1);
+    std::uniform_real_distribution<double> U(-1, 1);
+    kd_tree<double> kd;
+    std::vector<joint<double>> pts;
+    for(int n=0; n<3000; n++)
+    {
+        joint<double> q;
+        for(int i=0; i<6; i++) q.val[i] = (n<500) ? 0.001*n : U(g);
+        EXPECT_EQ(kd.insert(q), n);
+        pts.push_back(q);
+    }
+    EXPECT_EQ(kd.size(), 3000);
+    for(int n=0; n<200; n++)
+    {
+        joint<double> q;
+        for(int i=0; i<6; i++) q.val[i] = 1.2*U(g);
+        int best = 0;
+        for(int k=1; k<(int)pts.size(); k++)
+            if(kd_tree<double>::dist2(pts[k], q) < kd_tree<double>::dist2(pts[best], q)) best = k;
+        double d2;
+        EXPECT_EQ(kd.nearest(q, &d2), best);
+        EXPECT_DOUBLE_EQ(d2, kd_tree<double>::dist2(pts[best], q));
+
+        std::vector<int> in;
+        kd.radius(q, 0.8, in);
+        int cnt = 0;
+        for(const auto& p : pts) if(kd_tree<double>::dist2(p, q) <= 0.64) cnt++;
+        EXPECT_EQ((int)in.size(), cnt);
+    }
+}
+
+TEST(rrt, Test1)
+{
+    thread_pool pool(2);
+    wall_checker chk(pool.size());
+    rrt_connect<double> rrt(arm_limits(), std::ref(chk), &pool);
+
+    joint<double> q0 = {-0.9, 0.6, 0.6, 0, 0.6, 0};
+    joint<double> q1 = { 0.9, 0.6, 0.6, 0, 0.6, 0};
+    ASSERT_TRUE(chk(q0, 0));
+    ASSERT_TRUE(chk(q1, 0));
+
+    // 直線では壁に当たる
+    int m;
+    EXPECT_LE(rrt.check_segment(q0, q1, m), m);
+
+    std::vector<joint<double>> path;
+    int ok = 0;
+    for(int n=0; n<20; n++)
+    {
+        if(rrt(q0, q1, path)!=PLAN_SUCCESS) continue;
+        ok++;
+        EXPECT_EQ(kd_tree<double>::dist2(path.front(), q0), 0);
+        EXPECT_EQ(kd_tree<double>::dist2(path.back(), q1), 0);
+        EXPECT_TRUE(chk.dense(path));
+    }
+    EXPECT_EQ(ok, 20);
+
+    // 無効な始点・終点
+    joint<double> qx = q0;
+    qx.val[1] = 2.0;
+    EXPECT_EQ(rrt(qx, q1, path), PLAN_INVALID_START);
+    EXPECT_EQ(rrt(q0, qx, path), PLAN_INVALID_GOAL);
+    EXPECT_TRUE(path.empty());
+}
+
+TEST(rrt, Test2)
+{
+    // 多回転軸の終点の回転数
+    wall_checker chk(1);
+    joint_limit<double> lim = arm_limits();
+    lim.qmin.val[0] = -3*M_PI;
+    lim.qmax.val[0] =  3*M_PI;
+    rrt_connect<double> rrt(lim, std::ref(chk));
+
+    joint<double> q0 = {-0.9, 0.6, 0.6, 0, 0.6, 0};
+    joint<double> q1 = { 0.9, 0.6, 0.6, 0, 0.6, 0};
+    std::vector<joint<double>> path;
+
+    // 軸0を+1回転した終点（4bit符号付き）
+    SFLG2 flg2;
+    flg2.val = 1;
+    ASSERT_EQ(rrt(q0, q1, path, &flg2), PLAN_SUCCESS);
+    EXPECT_NEAR(path.back().val[0], 0.9 + 2*M_PI, 1e-12);
+    EXPECT_TRUE(chk.dense(path));
+
+    // -1回転
+    flg2.val = 0xf;
+    ASSERT_EQ(rrt(q0, q1, path, &flg2), PLAN_SUCCESS);
+    EXPECT_NEAR(path.back().val[0], 0.9 - 2*M_PI, 1e-12);
+
+    // 角度制約外の回転数
+    flg2.val = 2;
+    EXPECT_EQ(rrt(q0, q1, path, &flg2), PLAN_INVALID_GOAL);
+
+    // 回転数を問わない（いずれかの回転違いへ到達）
+    rrt.any_turn = true;
+    ASSERT_EQ(rrt(q0, q1, path), PLAN_SUCCESS);
+    double d = path.back().val[0] - 0.9;
+    EXPECT_NEAR(d - 2*M_PI*round(d/(2*M_PI)), 0, 1e-12);
+    for(int i=1; i<6; i++) EXPECT_DOUBLE_EQ(path.back().val[i], q1.val[i]);
+    EXPECT_TRUE(chk.dense(path));
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
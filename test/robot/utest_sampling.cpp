@@ -0,0 +1,173 @@
+#include <gtest/gtest.h>
+#include <robot/sampling.h>
+#include <random>
+#include <algorithm>
+using namespace kinematics;
+
+/**
+ * @brief 回転の距離（四元数の内積の絶対値から求める回転角）
+ */
+static double angle(const vec4<double>& a, const vec4<double>& b)
+{
+    double d = std::abs(a.x*b.x + a.y*b.y + a.z*b.z + a.w*b.w);
+    return 2*acos(std::min(d, 1.0));
+}
+
+/**
+ * @brief 最近傍の回転角の最小・最大
+ */
+static void spacing(const std::vector<vec4<double>>& q, double& lo, double& hi)
+{
+    lo = INFINITY;
+    hi = 0;
+    for(size_t i=0; i<q.size(); i++)
+    {
+        double best = INFINITY;
+        for(size_t j=0; j<q.size(); j++)
+            if(i!=j) best = std::min(best, angle(q[i], q[j]));
+        lo = std::min(lo, best);
+        hi = std::max(hi, best);
+    }
+}
+
+TEST(sampling, Test1)
+{
+    // HEALPixの画素中心（等面積：帯毎のz・画素数）
+    for(int nside : {1, 2, 4, 8})
+    {
+        int npix = 12*nside*nside;
+        double zsum = 0, prev = 2;
+        for(int p=0; p<npix; p++)
+        {
+            double z, phi;
+            healpix_center(nside, p, z, phi);
+            EXPECT_LE(z, prev + 1e-12);     // 北から南へ
+            EXPECT_GE(phi, 0);
+            EXPECT_LT(phi, 2*M_PI);
+            prev = z;
+            zsum += z;
+        }
+        EXPECT_NEAR(zsum, 0, 1e-9);         // 南北対称
+    }
+
+    // 回転の格子
+    for(int level=0; level<=2; level++)
+    {
+        so3_grid<double> grid(level);
+        ASSERT_EQ(grid.size(), 72 << (3*level));
+        std::vector<vec4<double>> q;
+        for(int64_t i=0; i<grid.size(); i++)
+        {
+            q.push_back(grid[i]);
+            EXPECT_NEAR(q.back().x*q.back().x + q.back().y*q.back().y + q.back().z*q.back().z + q.back().w*q.back().w, 1, 1e-12);
+            EXPECT_GE(q.back().w, 0);
+        }
+        if(level>1) continue;
+        double lo, hi;
+        spacing(q, lo, hi);
+        EXPECT_GT(lo, 0);               // 重複なし
+        EXPECT_LT(hi/lo, 2.5);          // 間隔がそろう
+        EXPECT_LE(hi, M_PI/3/(1 << level) + 1e-9);   // 最大間隔は60度から細分化毎に半分
+
+        // オイラー角の一様格子は極付近で密（最近傍の間隔の比が大きい）
+        if(level==1)
+        {
+            std::vector<vec4<double>> e;
+            int n = 8;      // 8*16*16点
+            for(int a=0; a<n; a++)
+                for(int b=0; b<2*n; b++)
+                    for(int c=0; c<2*n; c++)
+                        e.push_back(vec4<double>(2*M_PI*(c+0.5)/(2*n), M_PI*(a+0.5)/n - M_PI/2, 2*M_PI*(b+0.5)/(2*n)));
+            double elo, ehi;
+            spacing(e, elo, ehi);
+            EXPECT_GT(ehi/elo, 2*hi/lo);
+        }
+    }
+
+    // 軸毎の配列への出力
+    so3_grid<double> grid(1);
+    std::vector<double> buf(4*100);
+    double *q[4] = {&buf[0], &buf[100], &buf[200], &buf[300]};
+    grid.generate(200, 100, q);
+    for(int k=0; k<100; k++)
+    {
+        vec4<double> r = grid[200+k];
+        EXPECT_EQ(q[0][k], r.x);
+        EXPECT_EQ(q[3][k], r.w);
+    }
+}
+
+TEST(sampling, Test2)
+{
+    // Sobol列の1次元射影は先頭2^m点で2^m区間に1点ずつ
+    sobol6 sb;
+    EXPECT_EQ(sb(0, 0), 0);
+    EXPECT_EQ(sb(1, 0), 0.5);
+    EXPECT_EQ(sb(2, 1), 0.75);      // 2進の番号順（Gray符号順ではない）
+    EXPECT_EQ(sb(3, 1), 0.25);
+    for(int d=0; d<sobol6::dims; d++)
+    {
+        for(int m : {4, 8})
+        {
+            std::vector<int> cnt(1<<m, 0);
+            for(uint32_t i=0; i<(1u<<m); i++) cnt[(int)(sb(i, d)*(1<<m))]++;
+            for(int c : cnt) EXPECT_EQ(c, 1);
+        }
+    }
+    // 2次元射影 (t,m,2)-ネット：先頭2^m点は 2^a x 2^(m-a) の箱に高々2^t点
+    for(int d0=0; d0<sobol6::dims; d0++)
+        for(int d1=d0+1; d1<sobol6::dims; d1++)
+        {
+            const int m = 8;
+            int worst = 0;
+            for(int a=0; a<=m; a++)
+            {
+                std::vector<int> cnt(1<<m, 0);
+                for(uint32_t i=0; i<(1u<<m); i++)
+                    cnt[((int)(sb(i, d0)*(1<<a)) << (m-a)) + (int)(sb(i, d1)*(1<<(m-a)))]++;
+                for(int c : cnt) worst = std::max(worst, c);
+            }
+            EXPECT_LE(worst, 8);
+        }
+
+    // SE(3)：範囲内・一様な回転（z軸の2次モーメント 1/3）
+    aabb<double> box;
+    box.lo = vec3<double>(-0.5, 0, 0.2);
+    box.hi = vec3<double>( 0.5, 1, 0.4);
+    se3_sobol<double> seq(box), seq2(box, 7);
+    const int n = 4096;
+    double m2 = 0, mz = 0;
+    int differ = 0;
+    for(int i=0; i<n; i++)
+    {
+        pose<double> P = seq[i];
+        EXPECT_TRUE(P.p.x>=box.lo.x && P.p.x<box.hi.x && P.p.y>=box.lo.y && P.p.y<box.hi.y && P.p.z>=box.lo.z && P.p.z<box.hi.z);
+        EXPECT_NEAR(P.q.x*P.q.x + P.q.y*P.q.y + P.q.z*P.q.z + P.q.w*P.q.w, 1, 1e-12);
+        vec3<double> z = rotate(P.q, vec3<double>(0, 0, 1));
+        m2 += z.z*z.z;
+        mz += z.z;
+        if(seq2[i].p.x != P.p.x) differ++;
+    }
+    EXPECT_NEAR(m2/n, 1.0/3, 0.01);
+    EXPECT_NEAR(mz/n, 0, 0.01);
+    EXPECT_GT(differ, n/2);
+
+    // 軸毎の配列・番号指定
+    std::vector<double> buf(7*64);
+    double *out[7];
+    for(int d=0; d<7; d++) out[d] = &buf[64*d];
+    seq.generate(1000, 64, out);
+    for(int k=0; k<64; k++)
+    {
+        pose<double> P = seq[1000+k];
+        EXPECT_EQ(out[0][k], P.p.x);
+        EXPECT_EQ(out[2][k], P.p.z);
+        EXPECT_EQ(out[6][k], P.q.w);
+    }
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
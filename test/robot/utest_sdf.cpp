@@ -0,0 +1,184 @@
+#include <gtest/gtest.h>
+#include <robot/sdf.h>
+#include <random>
+using namespace kinematics;
+
+TEST(sdf, Test1)
+{
+    // 直方体の符号付き距離（厳密解と格子間隔程度で一致、並列構築でも同じ）
+    bvh<double> env;
+    env.add(pose<double>(vec3<double>(0.2, 0, 0), vec4<double>(vec3<double>(0, 0, 1), 0.5)), vec3<double>(0.4, 0.2, 0.3));
+    env.add(pose<double>(vec3<double>(-0.4, 0.3, 0.1), vec4<double>()), vec3<double>(0.1, 0.1, 0.6));
+    env.build();
+
+    aabb<double> region;
+    region.grow(vec3<double>(-1, -1, -1));
+    region.grow(vec3<double>(1, 1, 1));
+    const double res = 0.02;
+    sdf<double> f, f2;
+    thread_pool pool(4);
+    f.build(env, region, res, &pool);
+    f2.build(env, region, res);
+    EXPECT_EQ(f.nx, 101);
+    EXPECT_EQ(f.ny, 101);
+    EXPECT_EQ(f.nz, 101);
+    for(int k=0; k<f.nz; k+=7)
+        for(int j=0; j<f.ny; j+=5)
+            for(int i=0; i<f.nx; i+=3)
+                ASSERT_EQ(f.at(i, j, k), f2.at(i, j, k));
+
+    std::mt19937 g(1);
+    std::uniform_real_distribution<double> U(-0.9, 0.9);
+    for(int n=0; n<2000; n++)
+    {
+        vec3<double> p(U(g), U(g), U(g));
+        double ref = env.distance(capsule<double>{p, p, 0});
+        double d = f.distance(p);
+        if(ref > 0)
+        {
+            EXPECT_NEAR(d, ref, 1.5*res);
+        }
+        else
+        {
+            EXPECT_LT(d, 0.5*res);
+        }
+    }
+    EXPECT_LT(f.distance(vec3<double>(0.2, 0, 0)), -0.08);
+    EXPECT_NEAR(f.distance(vec3<double>(-0.4, 0.3, 0.6)), 0.2, 1.5*res);
+
+    // 勾配は補間値の差分と一致し、遠方では障害物から離れる向き
+    for(int n=0; n<200; n++)
+    {
+        vec3<double> p(U(g), U(g), U(g)), grad;
+        double d = f.distance(p, &grad);
+        const double e = 1e-6;
+        vec3<double> fd((f.distance(p + vec3<double>(e, 0, 0)) - f.distance(p - vec3<double>(e, 0, 0)))/(2*e),
+                        (f.distance(p + vec3<double>(0, e, 0)) - f.distance(p - vec3<double>(0, e, 0)))/(2*e),
+                        (f.distance(p + vec3<double>(0, 0, e)) - f.distance(p - vec3<double>(0, 0, e)))/(2*e));
+        EXPECT_NEAR(grad.x, fd.x, 1e-3);
+        EXPECT_NEAR(grad.y, fd.y, 1e-3);
+        EXPECT_NEAR(grad.z, fd.z, 1e-3);
+        if(d > 0.1)
+        {
+            // 厳密な距離の差分方向
+            const double h = 0.01;
+            vec3<double> rg((env.distance(capsule<double>{p + vec3<double>(h, 0, 0), p + vec3<double>(h, 0, 0), 0}) - env.distance(capsule<double>{p - vec3<double>(h, 0, 0), p - vec3<double>(h, 0, 0), 0}))/(2*h),
+                            (env.distance(capsule<double>{p + vec3<double>(0, h, 0), p + vec3<double>(0, h, 0), 0}) - env.distance(capsule<double>{p - vec3<double>(0, h, 0), p - vec3<double>(0, h, 0), 0}))/(2*h),
+                            (env.distance(capsule<double>{p + vec3<double>(0, 0, h), p + vec3<double>(0, 0, h), 0}) - env.distance(capsule<double>{p - vec3<double>(0, 0, h), p - vec3<double>(0, 0, h), 0}))/(2*h));
+            EXPECT_GT(grad*rg, 0.5);   // 2つの障害物から等距離の付近を含む
+        }
+    }
+
+    // 範囲外は格子端の値と格子範囲までの距離の2乗和の平方根（範囲内の障害物への距離の下限）
+    double de = f.distance(vec3<double>(1, 0, 0));
+    EXPECT_NEAR(f.distance(vec3<double>(1.5, 0, 0)), sqrt(de*de + 0.25), 1e-9);
+    for(int n=0; n<200; n++)
+    {
+        vec3<double> p(3*U(g), 3*U(g), 3*U(g)), grad;
+        if(std::abs(p.x)<1 && std::abs(p.y)<1 && std::abs(p.z)<1) continue;
+        double d = f.distance(p, &grad);
+        EXPECT_LT(d, env.distance(capsule<double>{p, p, 0}) + 0.5*res);
+        const double e = 1e-6;
+        vec3<double> fd((f.distance(p + vec3<double>(e, 0, 0)) - f.distance(p - vec3<double>(e, 0, 0)))/(2*e),
+                        (f.distance(p + vec3<double>(0, e, 0)) - f.distance(p - vec3<double>(0, e, 0)))/(2*e),
+                        (f.distance(p + vec3<double>(0, 0, e)) - f.distance(p - vec3<double>(0, 0, e)))/(2*e));
+        EXPECT_NEAR(grad.x, fd.x, 1e-3);
+        EXPECT_NEAR(grad.y, fd.y, 1e-3);
+        EXPECT_NEAR(grad.z, fd.z, 1e-3);
+    }
+}
+
+TEST(sdf, Test2)
+{
+    // 保存とmmap読み込み
+    bvh<double> env;
+    env.add(pose<double>(vec3<double>(0, 0, 0.3), vec4<double>()), vec3<double>(0.2, 0.2, 0.2));
+    std::vector<vec3<double>> vtx = {{0,0,0}, {1,0,0}, {0,1,0}};
+    std::vector<int> tri = {0, 1, 2};
+    env.add(vtx, tri, pose<double>(vec3<double>(-0.5, -0.5, -0.2), vec4<double>()));
+    env.build();
+
+    aabb<double> region;
+    region.grow(vec3<double>(-0.6, -0.6, -0.4));
+    region.grow(vec3<double>(0.6, 0.5, 0.6));
+    sdf<double> f;
+    f.build(env, region, 0.03);
+    EXPECT_FALSE(f.mapped());
+    EXPECT_LT(std::abs(f.distance(vec3<double>(-0.3, -0.3, -0.2))), 0.03);    // 三角形は面
+    EXPECT_NEAR(f.distance(vec3<double>(-0.3, -0.3, 0)), 0.2, 0.045);
+
+    std::string path = "/tmp/utest_sdf.bin";
+    ASSERT_TRUE(f.save(path));
+    sdf<double> f2;
+    ASSERT_TRUE(f2.load(path));
+    EXPECT_TRUE(f2.mapped());
+    EXPECT_EQ(f2.nx, f.nx);
+    EXPECT_EQ(f2.ny, f.ny);
+    EXPECT_EQ(f2.nz, f.nz);
+    EXPECT_EQ(f2.res, f.res);
+    for(int k=0; k<f.nz; k++)
+        for(int j=0; j<f.ny; j++)
+            for(int i=0; i<f.nx; i++)
+                ASSERT_EQ(f2.at(i, j, k), f.at(i, j, k));
+    vec3<double> p(0.1, -0.2, 0.05), g1, g2;
+    EXPECT_EQ(f2.distance(p, &g2), f.distance(p, &g1));
+    EXPECT_EQ(g2.x, g1.x);
+
+    // 形式不一致
+    FILE *fp = fopen(path.c_str(), "r+b");
+    ASSERT_TRUE(fp != nullptr);
+    fputc('X', fp);
+    fclose(fp);
+    EXPECT_FALSE(f2.load(path));
+    EXPECT_TRUE(f2.empty());
+    EXPECT_FALSE(f2.load("/tmp/utest_sdf_none.bin"));
+    remove(path.c_str());
+}
+
+TEST(sdf, Test3)
+{
+    // リンクの球とのクリアランス（BVHのカプセル距離と比較）
+    robot_model<double> rm;
+    self_collision<double> robot(rm, 0.04);
+    std::vector<link_sphere<double>> ls = link_spheres(robot, 0.03);
+    EXPECT_GT(ls.size(), 6u);
+
+    bvh<double> env;
+    env.add(pose<double>(vec3<double>(0.35, 0, 0.5), vec4<double>()), vec3<double>(0.1, 0.6, 0.1));
+    env.add(pose<double>(vec3<double>(-0.3, 0.3, 0.4), vec4<double>()), vec3<double>(0.2, 0.2, 0.8));
+    env.build();
+    aabb<double> region;
+    region.grow(vec3<double>(-1, -1, -0.2));
+    region.grow(vec3<double>(1, 1, 1.2));
+    const double res = 0.01;
+    sdf<double> f;
+    thread_pool pool(4);
+    f.build(env, region, res, &pool);
+
+    const double dr = sqrt(0.04*0.04 + 0.015*0.015) - 0.04;   // 球の半径増分
+    std::vector<double> out(ls.size());
+    std::vector<vec3<double>> grad(ls.size());
+    for(int n=0; n<50; n++)
+    {
+        joint<double> q;
+        for(int i=0; i<6; i++) q[i] = 1.2*sin(1.3*n + 0.7*i);
+        std::array<fpose<double>, 7> pa = to_pose_array(rm, q);
+        double ref = env.distance(robot, pa);
+        int idx = -1;
+        double d = f.distance(ls, pa, &out[0], &grad[0], &idx);
+        EXPECT_DOUBLE_EQ(d, out[idx]);
+        EXPECT_DOUBLE_EQ(d, f.distance(ls, pa));
+        if(ref > 2*res)
+        {
+            EXPECT_LE(d, ref + 1.5*res);
+            EXPECT_GE(d, ref - dr - 1.5*res);
+            EXPECT_NEAR(grad[idx].nrm(), 1.0, 0.2);
+        }
+    }
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
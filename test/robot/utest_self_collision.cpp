@@ -0,0 +1,143 @@
+#include <gtest/gtest.h>
+#include <robot/self_collision.h>
+using namespace kinematics;
+
+/**
+ * @brief 線分上の点の総当たりによる距離の2乗
+ */
+static double brute(vec3<double> p1, vec3<double> q1, vec3<double> p2, vec3<double> q2)
+{
+    double ret = INFINITY;
+    for(int i=0; i<=200; i++)
+        for(int j=0; j<=200; j++)
+        {
+            vec3<double> d = (p1 + (q1-p1)*(i/200.0)) - (p2 + (q2-p2)*(j/200.0));
+            ret = std::min(ret, d*d);
+        }
+    return ret;
+}
+
+TEST(self_collision, Test1)
+{
+    // 線分間距離（一般・平行・退化）
+    vec3<double> p[][4] = {
+        {{0,0,0}, {1,0,0}, {0.5,1,0.2}, {0.5,-1,0.7}},
+        {{0,0,0}, {1,0,0}, {0.3,0.5,0}, {2,0.5,0}},
+        {{0,0,0}, {1,0,0}, {2,1,0}, {2,1,0}},
+        {{0,0,0}, {0,0,0}, {-1,-1,1}, {1,1,1}},
+        {{0,0,0}, {1,1,1}, {1.2,1.3,0.9}, {3,2,1}},
+    };
+    for(auto& s : p)
+    {
+        double a, b;
+        double d2 = segment_distance2(s[0], s[1], s[2], s[3], &a, &b);
+        EXPECT_NEAR(d2, brute(s[0], s[1], s[2], s[3]), 1e-4);
+        vec3<double> d = (s[0] + (s[1]-s[0])*a) - (s[2] + (s[3]-s[2])*b);
+        EXPECT_NEAR(d*d, d2, 1e-12);
+        EXPECT_NEAR(segment_distance2(s[2], s[3], s[0], s[1]), d2, 1e-12);
+    }
+}
+
+TEST(self_collision, Test2)
+{
+    // 標準アーム：関節間カプセル
+    robot_model<double> rm;
+    self_collision<double> sc(rm, 0.03);
+    for(auto& pr : sc.pair_list()) EXPECT_GT(pr.second-pr.first, 1);
+
+    joint<double> q0 = {0, 0, 0, 0, 0, 0};
+    double d;
+    EXPECT_FALSE(sc(q0, &d));
+    EXPECT_GT(d, 0);
+
+    // 総当たりの距離と一致
+    joint<double> q1 = {0.3, 1.5, 2.6, 0.4, 1.0, 0};
+    std::array<fpose<double>, 7> pa = to_pose_array(rm, q1);
+    double ref = INFINITY;
+    for(int i=0; i<6; i++)
+        for(int j=i+2; j<6; j++)
+        {
+            if(sc.allowed(i, j)) continue;
+            capsule<double> a{pa[i].p, transform<double>(pa[i], rm.pos[i]), 0.03};
+            capsule<double> b{pa[j].p, transform<double>(pa[j], rm.pos[j]), 0.03};
+            ref = std::min(ref, distance(a, b));
+        }
+    bool hit = sc(q1, &d);
+    EXPECT_NEAR(d, ref, 1e-12);
+    EXPECT_EQ(hit, ref<=0);
+    EXPECT_EQ(sc(pa), ref<=0);
+
+    // 肘を折り畳むと手首がベース側へ干渉
+    joint<double> q2 = {0, 1.2, 2.9, 0, 2.0, 0};
+    EXPECT_TRUE(sc(q2));
+    std::pair<int,int> h = sc.hit();
+    EXPECT_FALSE(sc.allowed(h.first, h.second));
+    sc.allow(h.first, h.second);
+    sc.build();
+    EXPECT_EQ(sc.hit().first, -1);
+
+    // 工具の球を追加
+    sc.add(6, vec3<double>(0,0,0.1), 0.05);
+    sc.build();
+    EXPECT_FALSE(sc(q0));
+}
+
+TEST(self_collision, Test3)
+{
+    // 一括判定（並列）は単体判定と一致
+    robot_model<double> rm;
+    self_collision<double> sc(rm, 0.04);
+    const int n = 500;
+    std::vector<joint<double>> q(n);
+    for(int k=0; k<n; k++)
+        for(int i=0; i<6; i++) q[k][i] = 3.0*sin(1.7*k + 2.3*i);
+
+    std::vector<unsigned char> out(n), out2(n);
+    std::vector<double> dist(n);
+    thread_pool pool(4);
+    int m = sc(&q[0], n, &out[0], &dist[0], &pool);
+    EXPECT_EQ(sc(&q[0], n, &out2[0]), m);
+    EXPECT_GT(m, 0);
+    EXPECT_LT(m, n);
+    for(int k=0; k<n; k++)
+    {
+        double d;
+        EXPECT_EQ(out[k], sc(q[k], &d));
+        EXPECT_EQ(out2[k], out[k]);
+        EXPECT_EQ(dist[k], d);
+    }
+}
+
+TEST(self_collision, Test4)
+{
+    // 一括判定の後に形状を追加して再生成しても作業領域が追従する
+    robot_model<double> rm;
+    self_collision<double> sc(rm, 0.04);
+    const int n = 100;
+    std::vector<joint<double>> q(n);
+    for(int k=0; k<n; k++)
+        for(int i=0; i<6; i++) q[k][i] = 3.0*sin(1.3*k + 0.7*i);
+
+    std::vector<unsigned char> out(n);
+    thread_pool pool(4);
+    sc(&q[0], n, &out[0], nullptr, &pool);
+
+    for(int k=0; k<6; k++) sc.add(k, vec3<double>(), 0.06);
+    sc.add(6, vec3<double>(0,0,0.1), 0.05);
+    sc.build();
+
+    std::vector<double> dist(n);
+    sc(&q[0], n, &out[0], &dist[0], &pool);
+    for(int k=0; k<n; k++)
+    {
+        double d;
+        EXPECT_EQ(out[k], sc(q[k], &d));
+        EXPECT_EQ(dist[k], d);
+    }
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -1,5 +1,5 @@
 #include <gtest/gtest.h>
-#include <robot/sflg.h>
+#include <robot/robot.h>
 using namespace kinematics;
 
 TEST(sflg1, Test1)
@@ -28,6 +28,79 @@ TEST(sflg1, Test1)
         sflg2.SET(i, -4+i);
         std::cerr << sflg2 << std::endl;
     }
+    for(int i=0; i<8; i++) EXPECT_EQ(sflg2.GET(i), -4+i);
+
+    // 符号化・復号
+    int n[8] = {-7,-1,0,1,7,3,-3,2};
+    int m[8];
+    decode_flg2(encode_flg2(n, 8), m, 8);
+    for(int i=0; i<8; i++) EXPECT_EQ(m[i], n[i]);
+}
+
+/**
+ * @brief 回転数の逐次計算（閉形式との比較用）
+ */
+static int turn_count_loop(double q)
+{
+    int flg = 0;
+    double Lmin = M_PI;
+    while(std::abs(q) > Lmin)
+    {
+        flg = (q>0) ? (flg+1) : (flg-1);
+        Lmin += 2.0*M_PI;
+    }
+    return flg;
+}
+
+TEST(FlgChk, Test1)
+{
+    // 閉形式の回転数
+    for(double q=-9.0*M_PI+0.01; q<9.0*M_PI; q+=0.05)
+        EXPECT_EQ(turn_count(q), turn_count_loop(q));
+
+    // 一括生成（関節配列、SoA）と単体生成の一致
+    const int N = 200;
+    std::vector<joint<double>> jnt(N);
+    std::vector<std::vector<double>> soa(Naxis, std::vector<double>(N));
+    for(int k=0; k<N; k++)
+    {
+        for(int i=0; i<Naxis; i++)
+        {
+            jnt[k][i] = -12.0 + 24.0*((k*7+i*13)%N)/N;
+            soa[i][k] = jnt[k][i];
+        }
+    }
+    const double *q[Naxis];
+    for(int i=0; i<Naxis; i++) q[i] = &soa[i][0];
+
+    std::vector<unsigned int> f1(N), f2(N), g1(N), g2(N);
+    FlgChk(&jnt[0], N, &f1[0], &f2[0]);
+    FlgChk(q, N, &g1[0], &g2[0]);
+
+    std::vector<signed char> turn(Naxis*N);
+    signed char *t[Naxis];
+    for(int i=0; i<Naxis; i++) t[i] = &turn[i*N];
+    decode_flg2(&f2[0], N, t, Naxis);
+
+    for(int k=0; k<N; k++)
+    {
+        SFLG flg = FlgChk(jnt[k]);
+        EXPECT_EQ(f1[k], flg.flg1.val);
+        EXPECT_EQ(f2[k], flg.flg2.val);
+        EXPECT_EQ(g1[k], flg.flg1.val);
+        EXPECT_EQ(g2[k], flg.flg2.val);
+        for(int i=0; i<Naxis; i++)
+            EXPECT_EQ(t[i][k], turn_count_loop(jnt[k][i]));
+    }
+
+#ifndef NDEBUG
+    // 回転数の範囲外は一括生成でも単体生成と同様に停止
+    jnt[N/2][3] = 15.0*M_PI;
+    soa[3][N/2] = 15.0*M_PI;
+    EXPECT_DEATH(FlgChk(jnt[N/2]), "out of range");
+    EXPECT_DEATH(FlgChk(&jnt[0], N, &f1[0], &f2[0]), "out of range");
+    EXPECT_DEATH(FlgChk(q, N, &g1[0], &g2[0]), "out of range");
+#endif
 }
 
 
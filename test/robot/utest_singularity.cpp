@@ -0,0 +1,194 @@
+#include <gtest/gtest.h>
+#include <robot/singularity.h>
+using namespace kinematics;
+
+static joint<double> random_joint(int k)
+{
+    joint<double> q;
+    for(int i=0; i<6; i++) q.val[i] = (2.0*((k*7919 + i*104729) % 1000)/1000 - 1)*2.5;
+    return q;
+}
+
+/**
+ * @brief 条件数（べき乗法と逆べき乗法、姿勢行をL倍）
+ */
+static double cond_ref(const robot_model<double>& rm, const joint<double>& q, double L)
+{
+    jacobian<double> jac(rm);
+    jac(to_pose_array(rm, q));
+    for(int i=0; i<6; i++) jac.w[i] = jac.w[i]*L;
+    double A[6][6];
+    jac.JWJt(A);
+    double x[6] = {1, 0.3, -0.2, 0.5, 0.1, -0.7}, lmax = 0;
+    for(int it=0; it<2000; it++)
+    {
+        double y[6] = {0, 0, 0, 0, 0, 0}, n = 0;
+        for(int r=0; r<6; r++) for(int c=0; c<6; c++) y[r] += A[r][c]*x[c];
+        for(int r=0; r<6; r++) n += y[r]*y[r];
+        n = sqrt(n);
+        for(int r=0; r<6; r++) x[r] = y[r]/n;
+        lmax = n;
+    }
+    double z[6] = {1, 0.3, -0.2, 0.5, 0.1, -0.7}, lmin = 0;
+    for(int it=0; it<2000; it++)
+    {
+        double B[6][6];
+        memcpy(B, A, sizeof(B));
+        double n = 0;
+        EXPECT_TRUE(chol6(B, z));
+        for(int r=0; r<6; r++) n += z[r]*z[r];
+        n = sqrt(n);
+        for(int r=0; r<6; r++) z[r] /= n;
+        lmin = 1/n;
+    }
+    return sqrt(lmax/lmin);
+}
+
+TEST(singularity, Test1)
+{
+    // 可操作度・条件数は直接計算と一致、列の再利用は一括計算と一致
+    robot_model<double> rm;
+    singularity_monitor<double> mon(rm);
+    jacobian<double> jac(rm);
+    for(int k=0; k<50; k++)
+    {
+        joint<double> q = random_joint(k);
+        auto pa = to_pose_array(rm, q);
+        const singularity_state<double>& s = mon(pa);
+        jac(pa);
+        EXPECT_NEAR(s.manip, jac.manipulability(), 1e-12);
+        if(k<10)
+        {
+            EXPECT_NEAR(s.cond/cond_ref(rm, q, mon.length), 1, 1e-6);
+        }
+
+        // 手首のみ動かす
+        for(int i=3; i<6; i++) q.val[i] += 0.01;
+        auto pb = to_pose_array(rm, q);
+        singularity_state<double> a = mon(pb);
+        EXPECT_EQ(mon.reused, 3);
+        singularity_monitor<double> fresh(rm);
+        singularity_state<double> b = fresh(pb);
+        EXPECT_EQ(fresh.reused, 0);
+        EXPECT_NEAR(a.manip, b.manip, 1e-12);
+        EXPECT_NEAR(a.cond/b.cond, 1, 1e-9);
+        EXPECT_EQ(a.wrist, b.wrist);
+        EXPECT_EQ(a.elbow, b.elbow);
+        EXPECT_EQ(a.shoulder, b.shoulder);
+        EXPECT_EQ(a.flags, b.flags);
+
+        // 変化なしでは全列を再利用
+        mon(pb);
+        EXPECT_EQ(mon.reused, 6);
+    }
+}
+
+TEST(singularity, Test2)
+{
+    // 距離が0の姿勢は特異（可操作度0）
+    robot_model<double> rm;
+    singularity_monitor<double> mon(rm);
+    jacobian<double> jac(rm);
+    auto manip = [&](const joint<double>& q) { jac(to_pose_array(rm, q)); return jac.manipulability(); };
+    double ref = manip(joint<double>{0.3, 0.2, 0.4, 0.2, 0.8, 0});
+
+    // 手首
+    joint<double> q = {0.3, 0.2, 0.4, 0.2, 0, 0.1};
+    const singularity_state<double>& s = mon(to_pose_array(rm, q));
+    EXPECT_NEAR(s.wrist, 0, 1e-12);
+    EXPECT_TRUE(s.flags & SING_WRIST);
+    EXPECT_TRUE(s.flags & SING_CONDITION);
+    q.val[4] = 0.8;
+    mon(to_pose_array(rm, q));
+    EXPECT_NEAR(s.wrist, sin(0.8), 1e-12);
+    EXPECT_EQ(s.flags, (unsigned)SING_NONE);
+
+    // 肘（第3軸を走査して距離最小の姿勢）
+    double best = INFINITY;
+    joint<double> qb;
+    for(int k=0; k<=20000; k++)
+    {
+        q = joint<double>{0.3, 0.2, -M_PI + 2*M_PI*k/20000, 0.2, 0.8, 0};
+        double d = mon(to_pose_array(rm, q)).elbow;
+        if(d<best) { best = d; qb = q; }
+    }
+    EXPECT_LT(best, 1e-3);
+    EXPECT_LT(manip(qb), 1e-3*ref);
+    EXPECT_TRUE(mon(to_pose_array(rm, qb)).flags & SING_ELBOW);
+
+    // 肩（第2軸を走査）
+    best = INFINITY;
+    for(int k=0; k<=20000; k++)
+    {
+        q = joint<double>{0.3, -M_PI + 2*M_PI*k/20000, 1.2, 0.2, 0.8, 0};
+        double d = mon(to_pose_array(rm, q)).shoulder;
+        if(d<best) { best = d; qb = q; }
+    }
+    EXPECT_LT(best, 1e-3);
+    EXPECT_LT(manip(qb), 1e-3*ref);
+    EXPECT_TRUE(mon(to_pose_array(rm, qb)).flags & SING_SHOULDER);
+}
+
+TEST(singularity, Test3)
+{
+    // 予測と外挿
+    robot_model<double> rm;
+    singularity_monitor<double> mon(rm);
+    const int num = 100;
+    std::vector<joint<double>> traj(num);
+    for(int k=0; k<num; k++) traj[k] = joint<double>{0.3, 0.2, 0.4, 0.2, 1.0 - 1.5*k/(num-1), 0};
+    int expect = -1;
+    for(int k=0; k<num && expect<0; k++) if(std::abs(sin(traj[k].val[4])) < mon.warn_wrist) expect = k;
+    std::vector<singularity_state<double>> out(num);
+    EXPECT_EQ(mon.forecast(rm, &traj[0], num, &out[0]), expect);
+    EXPECT_EQ(mon.forecast(rm, &traj[0], num), expect);
+    EXPECT_EQ(mon.forecast(rm, &traj[0], expect), -1);
+    EXPECT_TRUE(out[expect].flags & SING_WRIST);
+
+    // 近づく間は残り周期数を外挿（予測より前の監視結果は変えない）
+    mon.reset();
+    for(int k=0; k<num; k++)
+    {
+        const singularity_state<double>& s = mon(to_pose_array(rm, traj[k]));
+        if(k==0)
+        {
+            EXPECT_EQ(s.eta, INFINITY);
+        }
+        else if(k<expect)
+        {
+            EXPECT_GT(s.eta, 0);
+            EXPECT_LT(s.eta, 2*(expect - k) + 5);
+        }
+        else if(s.flags)
+        {
+            EXPECT_EQ(s.eta, 0);
+        }
+    }
+}
+
+TEST(singularity, Test4)
+{
+    // 生成直後の予測（未初期化の領域に生成しても監視結果と一致）
+    // 第1関節を基準原点に置き、q0=0で最初の座標系が単位姿勢と一致する場合
+    robot_model<double> rm;
+    rm.pos[0] = vec3<double>();
+    alignas(singularity_monitor<double>) unsigned char buf[sizeof(singularity_monitor<double>)];
+    void *(*volatile fill)(void*, int, size_t) = memset;    // 生成前の書き込みを最適化で消さない
+    fill(buf, 0x41, sizeof(buf));
+    singularity_monitor<double> *mon = new(buf) singularity_monitor<double>(rm);
+    singularity_monitor<double> ref(rm);
+    joint<double> q = {0, 0.3, 0.5, 0, 0.8, 0};
+    singularity_state<double> s;
+    mon->forecast(rm, &q, 1, &s);
+    const singularity_state<double>& r = ref(to_pose_array(rm, q));
+    EXPECT_NEAR(s.manip, r.manip, 1e-12);
+    EXPECT_NEAR(s.cond, r.cond, 1e-9*r.cond);
+    EXPECT_EQ(s.flags, r.flags);
+    mon->~singularity_monitor<double>();
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <robot/spline.h>
+using namespace kinematics;
+
+TEST(spline, Test1)
+{
+    // 3次スプライン補間：経由点通過・C2連続・端点速度
+    const int n = 8;
+    double t[n] = {0, 0.3, 0.5, 1.0, 1.2, 1.9, 2.0, 2.6};
+    joint<double> q[n];
+    for(int i=0; i<n; i++)
+        for(int j=0; j<6; j++) q[i][j] = sin(1.3*t[i] + j) + 0.1*j*t[i];
+    joint<double> v0 = {0.1, 0, 0, 0, 0, -0.2};
+
+    joint_spline<double> sp;
+    sp.interpolate(t, q, n, v0);
+    EXPECT_EQ(sp.size(), n-1);
+    EXPECT_EQ(joint_spline<double>::Np % joint_spline<double>::W, 0);
+
+    joint<double> x, v, a, x1, v1, a1;
+    for(int i=0; i<n; i++)
+    {
+        sp.eval(t[i], x, v, a);
+        for(int j=0; j<6; j++) EXPECT_NEAR(x[j], q[i][j], 1e-12);
+        if(i==0 || i==n-1)
+        {
+            joint<double> vend = (i==0) ? v0 : joint<double>();
+            for(int j=0; j<6; j++) EXPECT_NEAR(v[j], vend[j], 1e-12);
+            continue;
+        }
+
+        sp.eval(t[i]-1e-9, x1, v1, a1);
+        for(int j=0; j<6; j++)
+        {
+            EXPECT_NEAR(v1[j], v[j], 1e-6);
+            EXPECT_NEAR(a1[j], a[j], 1e-6);
+        }
+    }
+
+    // 範囲外は端点で静止
+    sp.eval(10, x, v, a);
+    for(int j=0; j<6; j++)
+    {
+        EXPECT_NEAR(x[j], q[n-1][j], 1e-12);
+        EXPECT_EQ(v[j], 0);
+        EXPECT_EQ(a[j], 0);
+    }
+}
+
+TEST(spline, Test2)
+{
+    // 一様3次Bスプライン：基底関数による直接評価と一致
+    const int n = 20;
+    std::vector<joint<double>> p(n);
+    for(int i=0; i<n; i++)
+        for(int j=0; j<6; j++) p[i][j] = cos(0.7*i + 0.3*j);
+
+    joint_spline<double> sp;
+    sp.bspline(1.0, 0.1, &p[0], n);
+    EXPECT_EQ(sp.size(), n-3);
+    EXPECT_DOUBLE_EQ(sp.t_end(), 1.0 + 0.1*(n-3));
+
+    for(int k=0; k<=200; k++)
+    {
+        double t = sp.t_begin() + (sp.t_end()-sp.t_begin())*k/200;
+        int i = std::min((int)((t-1.0)/0.1), n-4);
+        double u = (t - 1.0)/0.1 - i;
+        double B[4] = {(1-u)*(1-u)*(1-u)/6, (3*u*u*u - 6*u*u + 4)/6, (-3*u*u*u + 3*u*u + 3*u + 1)/6, u*u*u/6};
+        joint<double> ref = p[i]*B[0] + p[i+1]*B[1] + p[i+2]*B[2] + p[i+3]*B[3];
+        joint<double> x = sp(t);
+        for(int j=0; j<6; j++) EXPECT_NEAR(x[j], ref[j], 1e-12);
+    }
+
+    // 一括評価（SoA）は単体評価と一致（時刻は非単調）
+    const int M = 97;
+    std::vector<double> t(M);
+    for(int k=0; k<M; k++) t[k] = 0.9 + 1.9*((k*37)%M)/M;
+    std::vector<std::vector<double>> bq(6, std::vector<double>(M)), bv(bq), ba(bq);
+    double *pq[6], *pv[6], *pa[6];
+    for(int j=0; j<6; j++) { pq[j] = &bq[j][0]; pv[j] = &bv[j][0]; pa[j] = &ba[j][0]; }
+    sp.eval(&t[0], M, pq, pv, pa);
+    for(int k=0; k<M; k++)
+    {
+        joint<double> x, v, a;
+        sp.eval(t[k], x, v, a);
+        for(int j=0; j<6; j++)
+        {
+            EXPECT_EQ(bq[j][k], x[j]);
+            EXPECT_EQ(bv[j][k], v[j]);
+            EXPECT_EQ(ba[j][k], a[j]);
+        }
+    }
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include <robot/topp.h>
+#include <robot/trajectory.h>
+using namespace kinematics;
+
+TEST(topp, Test1)
+{
+    // 直線経路は律速軸の台形速度と一致
+    joint<double> vmax = {1, 2, 1, 2, 1, 2};
+    joint<double> amax = {4, 4, 8, 8, 4, 4};
+    joint_limit<double> lim(joint<double>()-10, joint<double>()+10, vmax, amax);
+    topp<double> op(lim);
+
+    joint<double> q1 = {1, -0.5, 2, 0.1, 0, -3};
+    const int n = 2001;
+    std::vector<joint<double>> wp(n);
+    for(int i=0; i<n; i++) wp[i] = q1*(double(i)/(n-1));
+    double T = op(wp);
+
+    double L = 0, vs = INFINITY, as = INFINITY;
+    for(int j=0; j<6; j++) L += q1[j]*q1[j];
+    L = sqrt(L);
+    for(int j=0; j<6; j++)
+    {
+        double d = std::abs(q1[j])/L;
+        if(d==0) continue;
+        vs = std::min(vs, vmax[j]/d);
+        as = std::min(as, amax[j]/d);
+    }
+    profile1d<double> ref;
+    EXPECT_NEAR(T, ref.plan(0, L, 0, 0, vs, as), 2e-3*T);
+    EXPECT_NEAR(op.s[n-1], L, 1e-9);
+    EXPECT_EQ(op.sd[0], 0);
+    EXPECT_EQ(op.sd[n-1], 0);
+}
+
+TEST(topp, Test2)
+{
+    // 曲線経路と折り返し：速度・加速度制約を満たす
+    joint<double> vmax = {1, 2, 1, 2, 1, 2};
+    joint<double> amax = {4, 4, 8, 8, 4, 4};
+    joint_limit<double> lim(joint<double>()-10, joint<double>()+10, vmax, amax);
+    topp<double> op(lim);
+
+    const int n = 1000;
+    std::vector<joint<double>> wp(n);
+    for(int i=0; i<n; i++)
+    {
+        double r = 2*M_PI*i/(n-1);
+        wp[i] = {sin(r), 0.5*cos(2*r), 0.3*r, sin(3*r), 0, -0.2*r};
+    }
+    wp.push_back(wp[n-1]);                  // 重複点
+    for(int i=n-2; i>=n/2; i--) wp.push_back(wp[i]);    // 折り返し
+
+    double T = op(wp);
+    ASSERT_TRUE(std::isfinite(T));
+    EXPECT_GT(T, 0);
+    for(int i=0; i<wp.size(); i++)
+    {
+        EXPECT_GE(op.t[i], op.t[std::max(i-1, 0)]);
+        joint<double> v = op.velocity(i);
+        joint<double> a = op.acceleration(i);
+        for(int j=0; j<6; j++)
+        {
+            EXPECT_LE(std::abs(v[j]), vmax[j]*(1+1e-9));
+            EXPECT_LE(std::abs(a[j]), amax[j]*(1+1e-6)+1e-9);
+        }
+    }
+    double sdmax = *std::max_element(op.sd.begin(), op.sd.begin()+wp.size());
+    EXPECT_LT(op.sd[n-1], 0.2*sdmax);           // 折り返しで減速（格子幅相当）
+    EXPECT_EQ(op.sd[n-1], op.sd[n]);
+
+    // 作業領域を再利用して短い経路
+    std::vector<joint<double>> wp2(wp.begin(), wp.begin()+n);
+    double T2 = op(wp2);
+    EXPECT_LT(T2, T);
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
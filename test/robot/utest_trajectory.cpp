@@ -0,0 +1,189 @@
+#include <gtest/gtest.h>
+#include <robot/trajectory.h>
+#include <random>
+using namespace kinematics;
+
+/**
+ * @brief 軌道を刻みdtで走査し、制約と連続性を確認
+ * @return 終端時刻での関節角
+ */
+static joint<double> sweep(joint_trajectory<double>& tr, double t0, double t1, const joint<double>& jmax)
+{
+    const double dt = 1e-4;
+    const double eps = 1e-6;
+    joint<double> q0, v0, a0, q, v, a;
+    tr.eval(t0, q0, v0, a0);
+    for(double t=t0+dt; t<=t1+dt; t+=dt)
+    {
+        tr.eval(t, q, v, a);
+        for(int i=0; i<6; i++)
+        {
+            EXPECT_LE(std::abs(v[i]), tr.lim.vmax[i]+eps);
+            EXPECT_LE(std::abs(a[i]), tr.lim.amax[i]+eps);
+            // 速度の積分と位置が一致
+            EXPECT_NEAR(q[i]-q0[i], 0.5*(v[i]+v0[i])*dt, 1e-6);
+            // S字では加速度が連続（躍度上限内）
+            if(!std::isinf(jmax.val[i]))
+            {
+                EXPECT_LE(std::abs(a[i]-a0[i]), jmax.val[i]*dt+eps);
+            }
+        }
+        q0 = q; v0 = v; a0 = a;
+    }
+    return q;
+}
+
+/**
+ * @brief 全軸が終了時刻に目標で停止し、それより前には停止していないことを確認
+ */
+static void expect_arrival(joint_trajectory<double>& tr, const joint<double>& q1)
+{
+    joint<double> q, v, a;
+    tr.eval(tr.t_end(), q, v, a);
+    for(int i=0; i<6; i++)
+    {
+        EXPECT_NEAR(q[i], q1.val[i], 1e-9) << i;
+        EXPECT_NEAR(v[i], 0, 1e-9) << i;
+    }
+    tr.eval(tr.t_end()-1e-3, q, v, a);
+    for(int i=0; i<6; i++) EXPECT_FALSE(q[i]==q1.val[i] && v[i]==0) << i;
+}
+
+TEST(trajectory, Test1)
+{
+    // 台形速度：最も遅い軸に同期
+    joint<double> vmax = {1, 2, 1, 2, 1, 2};
+    joint<double> amax = {4, 4, 8, 8, 4, 4};
+    joint<double> jinf = joint<double>()+INFINITY;
+    joint_trajectory<double> tr(joint_limit<double>(joint<double>()-10, joint<double>()+10, vmax, amax));
+
+    joint<double> q0 = {0, 0, 0, 0, 0, 0};
+    joint<double> q1 = {1, -0.5, 2, 0.1, 0, -3};
+    double T = tr(q0, q1, 0.5);
+    EXPECT_DOUBLE_EQ(tr.t_end(), 0.5+T);
+    EXPECT_NEAR(T, 2.0/1 + 1.0/8, 1e-9);   // 3軸目が律速
+
+    joint<double> q = sweep(tr, 0.5, tr.t_end(), jinf);
+    for(int i=0; i<6; i++) EXPECT_NEAR(q[i], q1[i], 1e-9);
+
+    // 全軸が同時に到着
+    joint<double> v, a;
+    tr.eval(tr.t_end()-0.01, q, v, a);
+    for(int i=0; i<6; i++)
+    {
+        if(q1[i]==0) continue;
+        EXPECT_GT(std::abs(v[i]), 0);
+    }
+}
+
+TEST(trajectory, Test2)
+{
+    // S字速度と移動中の目標変更
+    joint<double> vmax = {1, 2, 1, 2, 1, 2};
+    joint<double> amax = {4, 4, 8, 8, 4, 4};
+    joint<double> jmax = {20, 40, 40, 80, 20, 20};
+    joint_trajectory<double> tr(joint_limit<double>(joint<double>()-10, joint<double>()+10, vmax, amax), jmax);
+
+    joint<double> q0 = {0, 0, 0, 0, 0, 0};
+    joint<double> q1 = {1, -0.5, 2, 0.1, 0, -3};
+    tr(q0, q1);
+    joint<double> q = sweep(tr, 0, tr.t_end(), jmax);
+    for(int i=0; i<6; i++) EXPECT_NEAR(q[i], q1[i], 1e-9);
+
+    // 加速中に変更（逆方向・行き過ぎを含む）
+    tr(q0, q1);
+    double tr0 = 0.3;
+    joint<double> qa, va, aa, qb, vb, ab;
+    tr.eval(tr0, qa, va, aa);
+    joint<double> q2 = {-1, 0.5, qa[2]+0.01, 0.1, 0.2, -1};
+    tr.retarget(tr0, q2);
+    tr.eval(tr0, qb, vb, ab);
+    for(int i=0; i<6; i++)
+    {
+        EXPECT_NEAR(qa[i], qb[i], 1e-12);
+        EXPECT_NEAR(va[i], vb[i], 1e-12);
+        EXPECT_NEAR(aa[i], ab[i], 1e-12);
+    }
+    q = sweep(tr, tr0, tr.t_end(), jmax);
+    for(int i=0; i<6; i++) EXPECT_NEAR(q[i], q2[i], 1e-6);
+    expect_arrival(tr, q2);
+
+    // 一括評価（SoA）
+    const int N = 50;
+    std::vector<double> t(N);
+    std::vector<std::vector<double>> bq(6, std::vector<double>(N)), bv(bq), ba(bq);
+    double *pq[6], *pv[6], *pa[6];
+    for(int i=0; i<6; i++) { pq[i] = &bq[i][0]; pv[i] = &bv[i][0]; pa[i] = &ba[i][0]; }
+    for(int k=0; k<N; k++) t[k] = tr0 + (tr.t_end()-tr0)*k/(N-1);
+    tr.eval(&t[0], N, pq, pv, pa);
+    for(int k=0; k<N; k++)
+    {
+        joint<double> v, a;
+        tr.eval(t[k], q, v, a);
+        for(int i=0; i<6; i++)
+        {
+            EXPECT_EQ(bq[i][k], q[i]);
+            EXPECT_EQ(bv[i][k], v[i]);
+            EXPECT_EQ(ba[i][k], a[i]);
+        }
+    }
+}
+
+TEST(trajectory, Test3)
+{
+    // 移動中の目標変更でも全軸が終了時刻に同時に到着（台形・S字）
+    joint<double> vmax = {1, 2, 1, 2, 1, 2};
+    joint<double> amax = {4, 4, 8, 8, 4, 4};
+    joint<double> jmax = {20, 40, 40, 80, 20, 20};
+    joint_limit<double> lim(joint<double>()-10, joint<double>()+10, vmax, amax);
+    std::mt19937 g(5);
+    std::uniform_real_distribution<double> U(-3, 3), R(0, 1);
+    for(int mode=0; mode<2; mode++)
+    {
+        joint<double> jm = mode ? jmax : joint<double>()+INFINITY;
+        joint_trajectory<double> tr(lim, jm);
+        for(int n=0; n<200; n++)
+        {
+            joint<double> q0, q1, q2;
+            for(int i=0; i<6; i++) { q0.val[i] = U(g); q1.val[i] = U(g); q2.val[i] = U(g); }
+            tr(q0, q1);
+            double t1 = tr.t_end()*R(g);
+            tr.retarget(t1, q2);
+            expect_arrival(tr, q2);
+            if(n<5)
+            {
+                joint<double> q = sweep(tr, t1, tr.t_end(), jm);
+                for(int i=0; i<6; i++) EXPECT_NEAR(q[i], q2[i], 1e-6);
+            }
+        }
+    }
+
+    // 停止距離(0.225)をわずかに超える目標へ向かう1軸（減速では足りず惰行・停止を経る）
+    profile1d<double> pf;
+    for(double q1 : {0.2251, 0.235, 0.425})
+        for(double dT : {0.01, 0.1, 1.0, 5.0})
+        {
+            double Tmin = pf.plan(0, q1, 1, 0, 1, 4, 20);
+            EXPECT_NEAR(pf.fit(Tmin+dT, 0, q1, 1, 0, 1, 4, 20), Tmin+dT, 1e-9);
+            double p0, v0, a0, p, v, a;
+            int hint = 0;
+            pf.eval(0, p0, v0, a0, hint);
+            for(double t=1e-4; t<Tmin+dT; t+=1e-4)
+            {
+                pf.eval(t, p, v, a, hint);
+                EXPECT_LE(std::abs(v), 1+1e-9);
+                EXPECT_LE(std::abs(a), 4+1e-9);
+                EXPECT_LE(std::abs(a-a0), 20*1e-4+1e-9);
+                EXPECT_LE(p, q1+1e-12);
+                p0 = p; v0 = v; a0 = a;
+            }
+            pf.eval(Tmin+dT, p, v, a, hint);
+            EXPECT_NEAR(p, q1, 1e-12);
+        }
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+#include <robot/velocity_ik.h>
+using namespace kinematics;
+
+TEST(jacobian, Test1)
+{
+    // 数値微分との比較
+    joint<double> q = {0.1, -0.4, 0.7, 0.3, -0.5, 0.2};
+    std::vector<fpose<double>> pa = to_pose_array(q);
+    jacobian<double> J;
+    J(pa);
+
+    double h = 1e-6;
+    for(int i=0; i<6; i++)
+    {
+        joint<double> qp = q;
+        qp[i] += h;
+        pose<double> p0 = pa.back();
+        pose<double> p1 = to_pose(qp);
+        twist<double> d = pose_error(p1, p0)*(1.0/h);
+        EXPECT_NEAR(d.v.x, J.v[i].x, 1e-5);
+        EXPECT_NEAR(d.v.y, J.v[i].y, 1e-5);
+        EXPECT_NEAR(d.v.z, J.v[i].z, 1e-5);
+        EXPECT_NEAR(d.w.x, J.w[i].x, 1e-5);
+        EXPECT_NEAR(d.w.y, J.w[i].y, 1e-5);
+        EXPECT_NEAR(d.w.z, J.w[i].z, 1e-5);
+    }
+}
+
+TEST(velocity_ik, Test1)
+{
+    joint<double> qmin = {-3,-3,-3,-3,-3,-3};
+    joint<double> qmax = { 3, 3, 3, 3, 3, 3};
+    joint<double> vmax = { 2, 2, 2, 2, 2, 2};
+    velocity_ik<double> ik(0.001, qmin, qmax, vmax, 1e-3, 50);
+
+    // 目標姿勢へ収束
+    joint<double> q = {0.1, -0.4, 0.7, 0.3, -0.5, 0.2};
+    pose<double> target = to_pose(joint<double>({0.2, -0.3, 0.6, 0.4, -0.4, 0.3}));
+    for(int k=0; k<1000; k++)
+    {
+        std::vector<fpose<double>> pa = to_pose_array(q);
+        q = q + ik(q, pa, target)*ik.dt;
+    }
+    EXPECT_LT(pose_error(target, (pose<double>)to_pose(q)).nrm(), 1e-6);
+
+    // 速度・角度制約による飽和
+    joint<double> out_of_range;
+    q = {0.1, -0.4, 0.7, 0.3, -0.5, 2.9995};
+    std::vector<fpose<double>> pa = to_pose_array(q);
+    twist<double> tw(vec3<double>(0,0,0), pa.back().q.Trans(vec3<double>(0,0,10)));
+    joint<double> qd = ik(q, pa, tw, &out_of_range);
+    EXPECT_NEAR(qd[5], 0.5, 1e-9);
+    EXPECT_EQ(out_of_range[5], 1);
+    for(int i=0; i<6; i++) EXPECT_LE(std::abs(qd[i]), 2.0);
+}
+
+// Run all the tests that were declared with TEST()
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}